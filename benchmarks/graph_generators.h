@@ -0,0 +1,174 @@
+#ifndef GRAPH_GENERATORS_H_INCLUDED
+#define GRAPH_GENERATORS_H_INCLUDED
+
+/*****************************************************************************
+  Random graphs with community structure for the benchmarks, as arrays of end
+  points that can be passed to create_graph_from_edges.
+
+  The generators use their own random stream (splitmix64), rather than igraph
+  or <random>, so that the same seed gives the same graph on every platform
+  and benchmark results can be compared between machines.
+
+  - sbm_edges: stochastic block model with communities of equal size, in
+    which each edge lies within a community with probability p_within.
+  - rmat_edges: R-MAT graph on 2^scale nodes (Chakrabarti et al.), with the
+    usual skewed probabilities (0.57, 0.19, 0.19, 0.05), which has a
+    heavy-tailed degree distribution and only weak community structure.
+  - lfr_edges: LFR-style benchmark graph (Lancichinetti et al.), with power
+    law distributed degrees and community sizes, in which a fraction mu of
+    the edges of each node leaves its community. Stubs are matched uniformly
+    at random within and between communities, without the rewiring steps of
+    the reference implementation, so that multi-edges and self-loops remain.
+*****************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+struct EdgeList
+{
+  size_t n;
+  vector<size_t> from;
+  vector<size_t> to;
+};
+
+class BenchmarkRng
+{
+  public:
+    BenchmarkRng(uint64_t seed) : _state(seed) {};
+
+    inline uint64_t next()
+    {
+      uint64_t z = (this->_state += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+    };
+
+    // Uniform in [0, n)
+    inline size_t index(size_t n) { return this->next() % n; };
+
+    // Uniform in [0, 1)
+    inline double unif01() { return (this->next() >> 11) * (1.0/9007199254740992.0); };
+
+    // Power law with the given exponent, truncated to [min, max]
+    inline size_t power_law(double exponent, size_t min, size_t max)
+    {
+      double a = std::pow((double)min, 1.0 - exponent);
+      double b = std::pow((double)max + 1, 1.0 - exponent);
+      double x = std::pow(a + (b - a)*this->unif01(), 1.0/(1.0 - exponent));
+      return std::min(max, std::max(min, (size_t)x));
+    };
+
+  private:
+    uint64_t _state;
+};
+
+static inline EdgeList sbm_edges(size_t n, size_t community_size, size_t avg_degree, double p_within, uint64_t seed)
+{
+  BenchmarkRng rng(seed);
+  EdgeList edges;
+  edges.n = n;
+  size_t m = n*avg_degree/2;
+  edges.from.resize(m);
+  edges.to.resize(m);
+  for (size_t e = 0; e < m; e++)
+  {
+    size_t v = rng.index(n);
+    size_t u;
+    if (rng.unif01() < p_within)
+    {
+      size_t start = v - v % community_size;
+      size_t end = std::min(n, start + community_size);
+      u = start + rng.index(end - start);
+    }
+    else
+      u = rng.index(n);
+    edges.from[e] = v;
+    edges.to[e] = u;
+  }
+  return edges;
+}
+
+static inline EdgeList rmat_edges(size_t scale, size_t edge_factor, uint64_t seed)
+{
+  const double a = 0.57, b = 0.19, c = 0.19;
+  BenchmarkRng rng(seed);
+  EdgeList edges;
+  edges.n = (size_t)1 << scale;
+  size_t m = edges.n*edge_factor;
+  edges.from.reserve(m);
+  edges.to.reserve(m);
+  while (edges.from.size() < m)
+  {
+    size_t v = 0, u = 0;
+    for (size_t bit = 0; bit < scale; bit++)
+    {
+      double r = rng.unif01();
+      v <<= 1;
+      u <<= 1;
+      if (r < a) {}
+      else if (r < a + b) u |= 1;
+      else if (r < a + b + c) v |= 1;
+      else { v |= 1; u |= 1; }
+    }
+    if (v == u)
+      continue;
+    edges.from.push_back(v);
+    edges.to.push_back(u);
+  }
+  return edges;
+}
+
+static inline EdgeList lfr_edges(size_t n, size_t min_degree, size_t max_degree,
+                                 size_t min_community, size_t max_community,
+                                 double mu, uint64_t seed)
+{
+  const double degree_exponent = 2.5;
+  const double community_exponent = 1.5;
+  BenchmarkRng rng(seed);
+
+  // Communities of power law sizes, covering all nodes in order
+  vector<size_t> community_start(1, 0);
+  while (community_start.back() < n)
+    community_start.push_back(std::min(n, community_start.back() + rng.power_law(community_exponent, min_community, max_community)));
+
+  // Split the stubs of every node into internal and external stubs
+  vector<size_t> external_stubs;
+  vector<size_t> internal_stubs;
+  EdgeList edges;
+  edges.n = n;
+  for (size_t comm = 0; comm + 1 < community_start.size(); comm++)
+  {
+    internal_stubs.clear();
+    for (size_t v = community_start[comm]; v < community_start[comm + 1]; v++)
+    {
+      size_t degree = rng.power_law(degree_exponent, min_degree, max_degree);
+      size_t n_external = (size_t)std::floor(mu*degree + rng.unif01());
+      for (size_t stub = 0; stub < degree; stub++)
+        (stub < n_external ? external_stubs : internal_stubs).push_back(v);
+    }
+    // Match the internal stubs uniformly at random
+    for (size_t idx = internal_stubs.size(); idx > 1; idx--)
+      std::swap(internal_stubs[idx - 1], internal_stubs[rng.index(idx)]);
+    for (size_t idx = 0; idx + 1 < internal_stubs.size(); idx += 2)
+    {
+      edges.from.push_back(internal_stubs[idx]);
+      edges.to.push_back(internal_stubs[idx + 1]);
+    }
+  }
+
+  // Match the external stubs uniformly at random over the whole graph
+  for (size_t idx = external_stubs.size(); idx > 1; idx--)
+    std::swap(external_stubs[idx - 1], external_stubs[rng.index(idx)]);
+  for (size_t idx = 0; idx + 1 < external_stubs.size(); idx += 2)
+  {
+    edges.from.push_back(external_stubs[idx]);
+    edges.to.push_back(external_stubs[idx + 1]);
+  }
+  return edges;
+}
+
+#endif // GRAPH_GENERATORS_H_INCLUDED
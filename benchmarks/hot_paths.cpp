@@ -0,0 +1,734 @@
+/*****************************************************************************
+  Google Benchmark suite of the hot paths of the optimisation, to compare
+  performance between revisions: constructing a Graph (from edges or from a
+  GraphFile), visiting neighbours, finding the neighbouring communities,
+  diff_move for every type of partition and diff_moves of BatchDiffMove,
+  move_nodes (specialised and with compact indices), merge_nodes,
+  is_locally_optimal, collapse_graph, a full iteration of
+  optimise_partition, optimise_changed_nodes and optimise_ensemble.
+
+  Every benchmark runs on SBM, R-MAT and LFR-style graphs (see
+  graph_generators.h) of 2^12, 2^15 and 2^18 nodes with a fixed seed, so that
+  results of different runs can be compared. Where the extension has its own
+  implementation, the argument impl selects libleidenalg (0) or the extension
+  (1). Build with
+
+    python setup.py build_benchmarks
+
+  which compiles against the same dependencies as the extension and Google
+  Benchmark, and run as
+
+    build/benchmarks/hot_paths --benchmark_out=hot_paths.json --benchmark_out_format=json
+
+  which writes the results as JSON, for example for comparing two runs with
+  compare.py of Google Benchmark. Use --benchmark_filter to select
+  benchmarks, e.g. --benchmark_filter=BM_DiffMove.
+*****************************************************************************/
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#include <igraph/igraph.h>
+#include <libleidenalg/GraphHelper.h>
+#include <libleidenalg/CPMVertexPartition.h>
+#include <libleidenalg/ModularityVertexPartition.h>
+#include <libleidenalg/RBConfigurationVertexPartition.h>
+#include <libleidenalg/RBERVertexPartition.h>
+#include <libleidenalg/SignificanceVertexPartition.h>
+#include <libleidenalg/SurpriseVertexPartition.h>
+
+#include "BatchDiffMove.h"
+#include "CSRGraph.h"
+#include "CollapseGraph.h"
+#include "ExtendedOptimiser.h"
+#include "GraphFile.h"
+#include "NativeGraph.h"
+#include "SparseAccumulator.h"
+
+#include "graph_generators.h"
+
+enum GraphType { SBM, RMAT, LFR };
+static const char* GRAPH_NAMES[] = {"SBM", "R-MAT", "LFR"};
+static const uint64_t SEED = 42;
+
+/*****************************************************************************
+  Graphs are generated once per type and size, and kept for all benchmarks.
+*****************************************************************************/
+class GraphCache
+{
+  public:
+    ~GraphCache()
+    {
+      for (auto& entry : this->graphs)
+        delete_native_graph(entry.second);
+      for (auto& entry : this->weighted_graphs)
+        delete_native_graph(entry.second);
+    };
+
+    EdgeList const& edges(int64_t type, int64_t n)
+    {
+      std::pair<int64_t, int64_t> key(type, n);
+      auto it = this->edge_lists.find(key);
+      if (it != this->edge_lists.end())
+        return it->second;
+
+      EdgeList edges;
+      if (type == SBM)
+        edges = sbm_edges(n, 100, 20, 0.8, SEED);
+      else if (type == RMAT)
+      {
+        size_t scale = 0;
+        while (((int64_t)1 << scale) < n)
+          scale++;
+        edges = rmat_edges(scale, 8, SEED);
+      }
+      else
+        edges = lfr_edges(n, 5, 50, 20, 200, 0.3, SEED);
+      return this->edge_lists[key] = edges;
+    };
+
+    Graph* graph(int64_t type, int64_t n)
+    {
+      std::pair<int64_t, int64_t> key(type, n);
+      auto it = this->graphs.find(key);
+      if (it != this->graphs.end())
+        return it->second;
+
+      EdgeList const& edges = this->edges(type, n);
+      vector<double> none;
+      return this->graphs[key] = create_graph_from_edges(edges.n, edges.from, edges.to, none, none, false, false);
+    };
+
+    // Membership after moving nodes once from singletons, as on the first level
+    vector<size_t> const& moved_membership(int64_t type, int64_t n)
+    {
+      std::pair<int64_t, int64_t> key(type, n);
+      auto it = this->memberships.find(key);
+      if (it != this->memberships.end())
+        return it->second;
+
+      Graph* graph = this->graph(type, n);
+      ModularityVertexPartition partition(graph);
+      ExtendedOptimiser optimiser;
+      optimiser.set_rng_seed(SEED);
+      optimiser.use_queue = true;
+      optimiser.move_nodes(&partition, vector<bool>(graph->vcount(), false), Optimiser::ALL_NEIGH_COMMS, false);
+      return this->memberships[key] = partition.get_membership();
+    };
+
+    // Membership after optimising from singletons until no further improvement
+    vector<size_t> const& optimised_membership(int64_t type, int64_t n)
+    {
+      std::pair<int64_t, int64_t> key(type, n);
+      auto it = this->optimised_memberships.find(key);
+      if (it != this->optimised_memberships.end())
+        return it->second;
+
+      Graph* graph = this->graph(type, n);
+      ModularityVertexPartition partition(graph);
+      ExtendedOptimiser optimiser;
+      optimiser.set_rng_seed(SEED);
+      optimiser.use_queue = true;
+      vector<bool> is_membership_fixed(graph->vcount(), false);
+      while (optimiser.optimise_partition(&partition, is_membership_fixed) > 0) {}
+      return this->optimised_memberships[key] = partition.get_membership();
+    };
+
+    // The same edges with random integer weights in [1, 10]
+    Graph* weighted_graph(int64_t type, int64_t n)
+    {
+      std::pair<int64_t, int64_t> key(type, n);
+      auto it = this->weighted_graphs.find(key);
+      if (it != this->weighted_graphs.end())
+        return it->second;
+
+      EdgeList const& edges = this->edges(type, n);
+      BenchmarkRng rng(SEED);
+      vector<double> weights(edges.from.size());
+      for (size_t e = 0; e < weights.size(); e++)
+        weights[e] = 1 + rng.index(10);
+      vector<double> none;
+      return this->weighted_graphs[key] = create_graph_from_edges(edges.n, edges.from, edges.to, weights, none, false, false);
+    };
+
+  private:
+    std::map<std::pair<int64_t, int64_t>, EdgeList> edge_lists;
+    std::map<std::pair<int64_t, int64_t>, Graph*> graphs;
+    std::map<std::pair<int64_t, int64_t>, Graph*> weighted_graphs;
+    std::map<std::pair<int64_t, int64_t>, vector<size_t> > memberships;
+    std::map<std::pair<int64_t, int64_t>, vector<size_t> > optimised_memberships;
+};
+
+static GraphCache cache;
+
+// Random membership with on average 100 nodes per community
+static vector<size_t> random_membership(size_t n)
+{
+  BenchmarkRng rng(SEED);
+  vector<size_t> membership(n);
+  for (size_t v = 0; v < n; v++)
+    membership[v] = rng.index(std::max((size_t)1, n/100));
+  return membership;
+}
+
+static void graph_args(benchmark::internal::Benchmark* b)
+{
+  b->ArgsProduct({{SBM, RMAT, LFR}, {1 << 12, 1 << 15, 1 << 18}})->ArgNames({"graph", "n"});
+}
+
+static void graph_impl_args(benchmark::internal::Benchmark* b)
+{
+  b->ArgsProduct({{SBM, RMAT, LFR}, {1 << 12, 1 << 15, 1 << 18}, {0, 1}})->ArgNames({"graph", "n", "impl"});
+}
+
+static void graph_threads_args(benchmark::internal::Benchmark* b)
+{
+  b->ArgsProduct({{SBM, RMAT, LFR}, {1 << 12, 1 << 15, 1 << 18}, {1, 2, 4, 8}})->ArgNames({"graph", "n", "threads"});
+}
+
+// Random order in which to visit the nodes
+static vector<size_t> random_order(size_t n)
+{
+  BenchmarkRng rng(SEED);
+  vector<size_t> order(n);
+  for (size_t v = 0; v < n; v++)
+    order[v] = v;
+  for (size_t idx = n; idx > 1; idx--)
+    std::swap(order[idx - 1], order[rng.index(idx)]);
+  return order;
+}
+
+static void BM_GraphConstruction(benchmark::State& state)
+{
+  EdgeList const& edges = cache.edges(state.range(0), state.range(1));
+  vector<double> none;
+  for (auto _ : state)
+  {
+    Graph* graph = create_graph_from_edges(edges.n, edges.from, edges.to, none, none, false, false);
+    benchmark::DoNotOptimize(graph);
+    delete_native_graph(graph);
+  }
+  state.SetItemsProcessed(state.iterations()*edges.from.size());
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_GraphConstruction)->Apply(graph_args)->Unit(benchmark::kMillisecond);
+
+/*****************************************************************************
+  Creating the graph from a file written by GraphFile::write, including
+  mapping the file, to compare with BM_GraphConstruction.
+*****************************************************************************/
+static void BM_GraphFile(benchmark::State& state)
+{
+  string path = "hot_paths_" + std::to_string(state.range(0)) + "_" + std::to_string(state.range(1)) + ".bin";
+  GraphFile::write(cache.graph(state.range(0), state.range(1)), path);
+  size_t bytes = 0;
+  for (auto _ : state)
+  {
+    GraphFile file(path);
+    Graph* graph = file.create_graph();
+    benchmark::DoNotOptimize(graph);
+    delete_native_graph(graph);
+    bytes = file.size();
+  }
+  std::remove(path.c_str());
+  state.counters["bytes"] = bytes;
+  state.SetItemsProcessed(state.iterations()*cache.graph(state.range(0), state.range(1))->ecount());
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_GraphFile)->Apply(graph_args)->Unit(benchmark::kMillisecond);
+
+/*****************************************************************************
+  Visiting the neighbours of all nodes in random order, summing the edge
+  weights, using get_neighbour_edges (impl 0) or by building a CSRGraph and
+  visiting its neighbours (impl 1).
+*****************************************************************************/
+static void BM_Neighbours(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  vector<size_t> order = random_order(graph->vcount());
+  size_t bytes = 0;
+  for (auto _ : state)
+  {
+    double total = 0.0;
+    if (state.range(2) == 0)
+    {
+      for (size_t v : order)
+        for (size_t e : graph->get_neighbour_edges(v, IGRAPH_ALL))
+          total += graph->edge_weight(e);
+    }
+    else
+    {
+      CSRGraph csr(graph, IGRAPH_ALL);
+      for (size_t v : order)
+        for (CSRGraph::Neighbour const& neighbour : csr.neighbours(v))
+          total += neighbour.weight;
+      bytes = csr.memory_usage();
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  if (state.range(2) == 1)
+    state.counters["bytes"] = bytes;
+  state.SetItemsProcessed(state.iterations()*order.size());
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_Neighbours)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+
+/*****************************************************************************
+  Finding the neighbouring communities and the weight to each of them for all
+  nodes in random order, for a random partition, using the caches of the
+  partition (impl 0) or by building a CSRGraph and using
+  NeighbourCommunities (impl 1).
+*****************************************************************************/
+static void BM_NeighbourCommunities(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  size_t n = graph->vcount();
+  ModularityVertexPartition partition(graph, random_membership(n));
+  vector<size_t> order = random_order(n);
+  for (auto _ : state)
+  {
+    double total = 0.0;
+    if (state.range(2) == 0)
+    {
+      for (size_t v : order)
+        for (size_t comm : partition.get_neigh_comms(v, IGRAPH_ALL))
+          total += partition.weight_to_comm(v, comm);
+    }
+    else
+    {
+      CSRGraph csr(graph, IGRAPH_ALL);
+      NeighbourCommunities neighbours(partition.n_communities(), csr.max_degree(), false);
+      for (size_t v : order)
+      {
+        neighbours.compute(v, partition.get_membership(), csr, csr);
+        for (size_t comm : neighbours.comms())
+          total += neighbours.weight_to_comm(comm);
+      }
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations()*n);
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_NeighbourCommunities)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+
+/*****************************************************************************
+  diff_move of moving random nodes to the community of a random neighbour,
+  for a random partition. The partition is not changed.
+*****************************************************************************/
+template <class Partition>
+static void BM_DiffMove(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  size_t n = graph->vcount();
+  Partition partition(graph, random_membership(n));
+
+  const size_t n_moves = 4096;
+  BenchmarkRng rng(SEED);
+  vector<size_t> nodes, comms;
+  while (nodes.size() < n_moves)
+  {
+    size_t v = rng.index(n);
+    vector<size_t> const& neighbours = graph->get_neighbours(v, IGRAPH_ALL);
+    if (neighbours.empty())
+      continue;
+    nodes.push_back(v);
+    comms.push_back(partition.membership(neighbours[rng.index(neighbours.size())]));
+  }
+
+  for (auto _ : state)
+  {
+    double total = 0.0;
+    for (size_t idx = 0; idx < n_moves; idx++)
+      total += partition.diff_move(nodes[idx], comms[idx]);
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetItemsProcessed(state.iterations()*n_moves);
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK_TEMPLATE(BM_DiffMove, CPMVertexPartition)->Apply(graph_args);
+BENCHMARK_TEMPLATE(BM_DiffMove, ModularityVertexPartition)->Apply(graph_args);
+BENCHMARK_TEMPLATE(BM_DiffMove, RBConfigurationVertexPartition)->Apply(graph_args);
+BENCHMARK_TEMPLATE(BM_DiffMove, RBERVertexPartition)->Apply(graph_args);
+BENCHMARK_TEMPLATE(BM_DiffMove, SignificanceVertexPartition)->Apply(graph_args);
+BENCHMARK_TEMPLATE(BM_DiffMove, SurpriseVertexPartition)->Apply(graph_args);
+
+/*****************************************************************************
+  The difference in quality of moving random nodes to every community of a
+  random partition, using diff_move for each community (impl 0) or diff_moves
+  of BatchDiffMove for all communities at once (impl 1). The label shows the
+  kernel used for linear quality functions.
+*****************************************************************************/
+template <class Partition>
+static void BM_BatchDiffMove(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  size_t n = graph->vcount();
+  Partition partition(graph, random_membership(n));
+  CSRGraph csr(graph, IGRAPH_ALL);
+
+  size_t n_communities = partition.n_communities();
+  vector<size_t> comms(n_communities);
+  for (size_t c = 0; c < n_communities; c++)
+    comms[c] = c;
+  vector<double> diffs(n_communities);
+
+  const size_t n_nodes = 64;
+  BenchmarkRng rng(SEED);
+  vector<size_t> nodes(n_nodes);
+  for (size_t idx = 0; idx < n_nodes; idx++)
+    nodes[idx] = rng.index(n);
+
+  NeighbourCommunities neighbours(n_communities, csr.max_degree(), false);
+  BatchDiffMove* batch_diff_move = BatchDiffMove::create(&partition);
+  batch_diff_move->reserve(n_communities);
+  for (auto _ : state)
+  {
+    for (size_t v : nodes)
+    {
+      if (state.range(2) == 0)
+      {
+        for (size_t c = 0; c < n_communities; c++)
+          diffs[c] = partition.diff_move(v, c);
+      }
+      else
+      {
+        neighbours.compute(v, partition.get_membership(), csr, csr);
+        batch_diff_move->diff_moves(v, neighbours, comms.data(), n_communities, diffs.data());
+      }
+      benchmark::DoNotOptimize(diffs.data());
+    }
+  }
+  delete batch_diff_move;
+  state.SetItemsProcessed(state.iterations()*n_nodes*n_communities);
+  state.SetLabel(string(GRAPH_NAMES[state.range(0)]) + ", " + linear_diff_kernel_isa());
+}
+BENCHMARK_TEMPLATE(BM_BatchDiffMove, CPMVertexPartition)->Apply(graph_impl_args);
+BENCHMARK_TEMPLATE(BM_BatchDiffMove, ModularityVertexPartition)->Apply(graph_impl_args);
+BENCHMARK_TEMPLATE(BM_BatchDiffMove, RBConfigurationVertexPartition)->Apply(graph_impl_args);
+BENCHMARK_TEMPLATE(BM_BatchDiffMove, RBERVertexPartition)->Apply(graph_impl_args);
+
+/*****************************************************************************
+  move_nodes from singletons, using libleidenalg (impl 0) or the queue-based
+  move_nodes of the extension (impl 1).
+*****************************************************************************/
+static void BM_MoveNodes(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  size_t n = graph->vcount();
+  vector<bool> is_membership_fixed(n, false);
+  ExtendedOptimiser optimiser;
+  optimiser.use_queue = (state.range(2) == 1);
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    ModularityVertexPartition partition(graph);
+    optimiser.set_rng_seed(SEED);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(optimiser.move_nodes(&partition, is_membership_fixed, Optimiser::ALL_NEIGH_COMMS, false));
+  }
+  state.SetItemsProcessed(state.iterations()*n);
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_MoveNodes)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+
+/*****************************************************************************
+  The queue-based move_nodes from singletons, calling diff_move through the
+  partition (impl 0) or using the version specialised for the type of
+  partition (impl 1).
+*****************************************************************************/
+template <class Partition>
+static void BM_SpecialisedMoveNodes(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  size_t n = graph->vcount();
+  vector<bool> is_membership_fixed(n, false);
+  ExtendedOptimiser optimiser;
+  optimiser.use_queue = true;
+  optimiser.specialise_diff_move = (state.range(2) == 1);
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    Partition partition(graph);
+    optimiser.set_rng_seed(SEED);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(optimiser.move_nodes(&partition, is_membership_fixed, Optimiser::ALL_NEIGH_COMMS, false));
+  }
+  state.SetItemsProcessed(state.iterations()*n);
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK_TEMPLATE(BM_SpecialisedMoveNodes, CPMVertexPartition)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SpecialisedMoveNodes, ModularityVertexPartition)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SpecialisedMoveNodes, RBConfigurationVertexPartition)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SpecialisedMoveNodes, RBERVertexPartition)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+
+/*****************************************************************************
+  The queue-based move_nodes from singletons on a graph with integer weights,
+  using a CSR layout with 64-bit ids (impl 0) or compact indices (impl 1).
+  The counters show the memory usage of each CSR layout of the graph.
+*****************************************************************************/
+static void BM_CompactIndices(benchmark::State& state)
+{
+  Graph* graph = cache.weighted_graph(state.range(0), state.range(1));
+  size_t n = graph->vcount();
+  vector<bool> is_membership_fixed(n, false);
+  ExtendedOptimiser optimiser;
+  optimiser.use_queue = true;
+  optimiser.compact_indices = (state.range(2) == 1);
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    ModularityVertexPartition partition(graph);
+    optimiser.set_rng_seed(SEED);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(optimiser.move_nodes(&partition, is_membership_fixed, Optimiser::ALL_NEIGH_COMMS, false));
+  }
+  state.counters["csr_bytes"] = CSRGraph(graph, IGRAPH_ALL).memory_usage();
+  state.counters["compact_bytes"] = CompactCSRGraph(graph, IGRAPH_ALL).memory_usage();
+  state.counters["compact_float_bytes"] = CompactFloatCSRGraph(graph, IGRAPH_ALL).memory_usage();
+  state.SetItemsProcessed(state.iterations()*n);
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_CompactIndices)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+
+static void BM_MergeNodes(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  size_t n = graph->vcount();
+  vector<bool> is_membership_fixed(n, false);
+  ExtendedOptimiser optimiser;
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    ModularityVertexPartition partition(graph);
+    optimiser.set_rng_seed(SEED);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(optimiser.merge_nodes(&partition, is_membership_fixed, Optimiser::ALL_NEIGH_COMMS, false));
+  }
+  state.SetItemsProcessed(state.iterations()*n);
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_MergeNodes)->Apply(graph_args)->Unit(benchmark::kMillisecond);
+
+/*****************************************************************************
+  Checking whether the partition after moving nodes once is stable, by moving
+  the nodes of a copy again (impl 0) or using is_locally_optimal (impl 1).
+*****************************************************************************/
+static void BM_IsLocallyOptimal(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  size_t n = graph->vcount();
+  vector<bool> is_membership_fixed(n, false);
+  ModularityVertexPartition partition(graph, cache.moved_membership(state.range(0), state.range(1)));
+  ExtendedOptimiser optimiser;
+  for (auto _ : state)
+  {
+    if (state.range(2) == 0)
+    {
+      state.PauseTiming();
+      ModularityVertexPartition copy(graph, partition.get_membership());
+      optimiser.set_rng_seed(SEED);
+      state.ResumeTiming();
+      benchmark::DoNotOptimize(optimiser.move_nodes(&copy, is_membership_fixed, Optimiser::ALL_NEIGH_COMMS, false) <= 0);
+    }
+    else
+      benchmark::DoNotOptimize(optimiser.is_locally_optimal(&partition, is_membership_fixed));
+  }
+  state.SetItemsProcessed(state.iterations()*n);
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_IsLocallyOptimal)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+
+/*****************************************************************************
+  Aggregating the graph after moving nodes once, using Graph::collapse_graph
+  (impl 0) or collapse_graph of the extension (impl 1).
+*****************************************************************************/
+static void BM_CollapseGraph(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  ModularityVertexPartition partition(graph, cache.moved_membership(state.range(0), state.range(1)));
+  AggregationArena arena;
+  for (auto _ : state)
+  {
+    if (state.range(2) == 0)
+      delete graph->collapse_graph(&partition);
+    else
+      delete_collapsed_graph(collapse_graph(graph, &partition, 1, arena));
+  }
+  state.SetItemsProcessed(state.iterations()*graph->ecount());
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_CollapseGraph)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+
+// collapse_graph of the extension using several threads
+static void BM_CollapseGraphThreads(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  ModularityVertexPartition partition(graph, cache.moved_membership(state.range(0), state.range(1)));
+  AggregationArena arena;
+  for (auto _ : state)
+    delete_collapsed_graph(collapse_graph(graph, &partition, state.range(2), arena));
+  state.counters["arena_peak_bytes"] = arena.peak_bytes;
+  state.SetItemsProcessed(state.iterations()*graph->ecount());
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_CollapseGraphThreads)->Apply(graph_threads_args)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/*****************************************************************************
+  A single iteration of the Leiden algorithm from singletons, using
+  libleidenalg (impl 0) or the queue-based routines of the extension (impl 1).
+*****************************************************************************/
+static void BM_OptimisePartition(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  size_t n = graph->vcount();
+  vector<bool> is_membership_fixed(n, false);
+  ExtendedOptimiser optimiser;
+  optimiser.use_queue = (state.range(2) == 1);
+  double quality = 0.0;
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    ModularityVertexPartition partition(graph);
+    optimiser.set_rng_seed(SEED);
+    state.ResumeTiming();
+    optimiser.optimise_partition(&partition, is_membership_fixed);
+    state.PauseTiming();
+    quality = partition.quality();
+    state.ResumeTiming();
+  }
+  state.counters["quality"] = quality;
+  state.SetItemsProcessed(state.iterations()*n);
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_OptimisePartition)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+
+/*****************************************************************************
+  Updating an optimised partition after removing 1% of the edges at random
+  and adding as many random edges, by optimising the partition from
+  singletons on the new graph until no further improvement (impl 0), or by
+  creating the graph with create_graph_with_delta and using
+  optimise_changed_nodes from the previous membership (impl 1).
+*****************************************************************************/
+static void BM_ChangedNodes(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  EdgeList const& edges = cache.edges(state.range(0), state.range(1));
+  vector<size_t> const& membership = cache.optimised_membership(state.range(0), state.range(1));
+  size_t n = graph->vcount();
+
+  BenchmarkRng rng(SEED);
+  vector<size_t> from = edges.from, to = edges.to;
+  vector<size_t> removed_from, removed_to, added_from, added_to, changed_nodes;
+  size_t n_changed = std::max((size_t)1, from.size()/100);
+  for (size_t idx = 0; idx < n_changed; idx++)
+  {
+    size_t e = rng.index(from.size());
+    removed_from.push_back(from[e]);
+    removed_to.push_back(to[e]);
+    from[e] = from.back(); from.pop_back();
+    to[e] = to.back(); to.pop_back();
+    added_from.push_back(rng.index(n));
+    added_to.push_back(rng.index(n));
+    changed_nodes.push_back(removed_from.back());
+    changed_nodes.push_back(removed_to.back());
+    changed_nodes.push_back(added_from.back());
+    changed_nodes.push_back(added_to.back());
+  }
+  from.insert(from.end(), added_from.begin(), added_from.end());
+  to.insert(to.end(), added_to.begin(), added_to.end());
+
+  vector<double> none;
+  vector<bool> is_membership_fixed(n, false);
+  ExtendedOptimiser optimiser;
+  optimiser.use_queue = true;
+  double quality = 0.0;
+  for (auto _ : state)
+  {
+    optimiser.set_rng_seed(SEED);
+    Graph* new_graph;
+    ModularityVertexPartition* partition;
+    if (state.range(2) == 0)
+    {
+      new_graph = create_graph_from_edges(n, from, to, none, none, false, false);
+      partition = new ModularityVertexPartition(new_graph);
+      while (optimiser.optimise_partition(partition, is_membership_fixed) > 0) {}
+    }
+    else
+    {
+      new_graph = create_graph_with_delta(graph, n, added_from, added_to, none, removed_from, removed_to);
+      partition = new ModularityVertexPartition(new_graph, membership);
+      optimiser.optimise_changed_nodes(partition, changed_nodes, is_membership_fixed);
+    }
+    state.PauseTiming();
+    quality = partition->quality();
+    delete partition;
+    delete_native_graph(new_graph);
+    state.ResumeTiming();
+  }
+  state.counters["quality"] = quality;
+  state.SetItemsProcessed(state.iterations()*n_changed);
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_ChangedNodes)->Apply(graph_impl_args)->Unit(benchmark::kMillisecond);
+
+/*****************************************************************************
+  Eight runs of two iterations of the Leiden algorithm from singletons with
+  different seeds, keeping the best, as separate calls of optimise_partition
+  (impl 0, on one thread) or using optimise_ensemble on the given number of
+  threads (impl 1).
+*****************************************************************************/
+static void ensemble_args(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"graph", "n", "impl", "threads"});
+  for (int64_t type : {SBM, RMAT, LFR})
+    for (int64_t n : {1 << 12, 1 << 15, 1 << 18})
+    {
+      b->Args({type, n, 0, 1});
+      for (int64_t n_threads : {1, 2, 4, 8})
+        b->Args({type, n, 1, n_threads});
+    }
+}
+
+static void BM_OptimiseEnsemble(benchmark::State& state)
+{
+  Graph* graph = cache.graph(state.range(0), state.range(1));
+  size_t n = graph->vcount();
+  vector<bool> is_membership_fixed(n, false);
+  const size_t n_starts = 8;
+  double quality = 0.0;
+  for (auto _ : state)
+  {
+    if (state.range(2) == 0)
+    {
+      quality = -INFINITY;
+      for (size_t run = 0; run < n_starts; run++)
+      {
+        ExtendedOptimiser optimiser;
+        optimiser.set_rng_seed(SEED + run);
+        ModularityVertexPartition partition(graph);
+        optimiser.optimise_partition(&partition, is_membership_fixed);
+        optimiser.optimise_partition(&partition, is_membership_fixed);
+        quality = std::max(quality, partition.quality());
+      }
+    }
+    else
+    {
+      ExtendedOptimiser optimiser;
+      optimiser.set_rng_seed(SEED);
+      ModularityVertexPartition partition(graph);
+      vector<EnsembleRun> runs;
+      quality = optimiser.optimise_ensemble(&partition, n_starts, state.range(3), 2, runs);
+    }
+  }
+  state.counters["quality"] = quality;
+  state.SetItemsProcessed(state.iterations()*n_starts*n);
+  state.SetLabel(GRAPH_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_OptimiseEnsemble)->Apply(ensemble_args)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
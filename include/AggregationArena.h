@@ -0,0 +1,77 @@
+#ifndef AGGREGATIONARENA_H_INCLUDED
+#define AGGREGATIONARENA_H_INCLUDED
+
+#include <igraph/igraph.h>
+#include <libleidenalg/GraphHelper.h>
+
+#include "SparseAccumulator.h"
+
+/****************************************************************************
+Buffers that are used when aggregating the graph, reused across levels.
+
+Aggregating the graph (see collapse_graph) needs several temporary arrays of
+the size of the graph, and the optimiser needs the membership of every new
+aggregate partition. The optimiser keeps these buffers in an arena, which is
+reused for every level and every call, so that they are only allocated when
+a larger graph is encountered than before. The graphs and partitions
+themselves are still allocated by libleidenalg.
+
+The arena keeps track of the number of bytes it currently holds, the peak of
+that number and the total number of bytes it allocated. Call account after
+using the buffers to update these statistics.
+****************************************************************************/
+
+class AggregationArena
+{
+  public:
+    AggregationArena() : peak_bytes(0), total_bytes_allocated(0), _bytes(0)
+    { igraph_vector_int_init(&this->collapsed_edges, 0); };
+    ~AggregationArena()
+    { igraph_vector_int_destroy(&this->collapsed_edges); };
+
+    // Edges from each node, ordered by the other end point
+    vector<size_t> edge_offsets;
+    vector<size_t> edges;
+    vector<size_t> edges_by_to;
+
+    // Nodes of each community
+    vector<size_t> comm_offsets;
+    vector<size_t> comm_nodes;
+
+    vector<size_t> position; // Used when counting sorts
+
+    // Aggregate edges per block of communities, one block per thread
+    vector<size_t> block_begin;
+    vector<size_t> block_offsets;
+    vector< vector<igraph_integer_t> > block_edges;
+    vector< vector<double> > block_weights;
+    vector<SparseAccumulator> weight_to_comm;
+
+    // The aggregate graph, which is copied by igraph and libleidenalg
+    igraph_vector_int_t collapsed_edges;
+    vector<double> collapsed_weights;
+    vector<double> csizes;
+
+    // Membership of the aggregate partition
+    vector<size_t> membership;
+
+    size_t peak_bytes; // Peak number of bytes held by the arena
+    size_t total_bytes_allocated; // Total number of bytes allocated by the arena
+
+    // Number of bytes currently held by the arena.
+    size_t memory_usage() const;
+
+    // Update the statistics after the buffers were used.
+    void account();
+
+    // Free all buffers. The statistics are kept.
+    void release();
+
+  private:
+    size_t _bytes;
+
+    AggregationArena(AggregationArena const&);
+    AggregationArena& operator=(AggregationArena const&);
+};
+
+#endif // AGGREGATIONARENA_H_INCLUDED
@@ -0,0 +1,252 @@
+#ifndef BATCHDIFFMOVE_H_INCLUDED
+#define BATCHDIFFMOVE_H_INCLUDED
+
+#include <libleidenalg/GraphHelper.h>
+#include <libleidenalg/MutableVertexPartition.h>
+
+#include "SparseAccumulator.h"
+
+/****************************************************************************
+Score moving a node to several communities at once.
+
+MutableVertexPartition::diff_move scores a single community per (virtual)
+call. When moving nodes, the optimiser instead calls diff_moves once per node
+for all candidate communities, passing the weights from the node to the
+communities, which were already accumulated in a NeighbourCommunities.
+
+This base class simply calls diff_move on the partition for each community,
+and hence works for any type of partition. Use create to obtain the most
+suitable implementation for a partition.
+****************************************************************************/
+
+class BatchDiffMove
+{
+  public:
+    BatchDiffMove(MutableVertexPartition* partition) : partition(partition) {};
+    virtual ~BatchDiffMove() {};
+
+    // Make sure that up to max_comms communities can be scored without
+    // allocating memory.
+    virtual void reserve(size_t /* max_comms */) {};
+
+    // Set diffs[i] to diff_move(v, comms[i]) for i = 0, ..., n_comms - 1.
+    // The neighbours should be computed for v on the same partition.
+    virtual void diff_moves(size_t v, NeighbourCommunities const& neighbours,
+                            size_t const* comms, size_t n_comms, double* diffs);
+
+    static BatchDiffMove* create(MutableVertexPartition* partition);
+
+  protected:
+    MutableVertexPartition* partition;
+};
+
+// Set out[i] = offset + scale*(w_to[i] + w_from[i] - cx*x[i] - cy*y[i]) for
+// i = 0, ..., n - 1, using the widest vector instructions available.
+void linear_diff_kernel(size_t n, double const* w_to, double const* w_from,
+                        double const* x, double const* y,
+                        double cx, double cy, double scale, double offset,
+                        double* out);
+
+/****************************************************************************
+Community totals of the candidate communities of a node, in the layout used
+by linear_diff_kernel (see LinearBatchDiffMove).
+****************************************************************************/
+
+struct LinearDiffTotals
+{
+  vector<double> w_to;
+  vector<double> w_from;
+  vector<double> x;
+  vector<double> y;
+  double cx;
+  double cy;
+  double w_old; // Gain of v in its own community, without v itself
+
+  inline void reserve(size_t max_comms)
+  {
+    if (this->w_to.size() < max_comms)
+    {
+      this->w_to.resize(max_comms);
+      this->w_from.resize(max_comms);
+      this->x.resize(max_comms);
+      this->y.resize(max_comms);
+    }
+  };
+
+  // Gather the totals of comms[0], ..., comms[n_comms - 1] for node v, and
+  // of the community of v without v.
+  template <int NULL_MODEL>
+  inline void gather(MutableVertexPartition* partition, size_t v,
+                     NeighbourCommunities const& neighbours,
+                     size_t const* comms, size_t n_comms,
+                     double resolution_parameter);
+
+  // Set diffs to the improvement of moving v to each community. Moving to
+  // the community of v itself does not change the partition.
+  inline void evaluate(size_t v_comm, size_t const* comms, size_t n_comms, double scale, double* diffs)
+  {
+    linear_diff_kernel(n_comms, this->w_to.data(), this->w_from.data(),
+                       this->x.data(), this->y.data(),
+                       this->cx, this->cy, scale, -scale*this->w_old, diffs);
+    for (size_t idx = 0; idx < n_comms; idx++)
+      if (comms[idx] == v_comm)
+        diffs[idx] = 0.0;
+  };
+};
+
+/****************************************************************************
+Batched diff_move for quality functions that are linear in the weights to
+the community and in a single (or two) community totals.
+
+For CPM and RBER, moving node v to community c changes the quality by
+
+  offset + scale*(w_to(c) + w_from(c) - cx*csize(c))
+
+and for RBConfiguration and modularity by
+
+  offset + scale*(w_to(c) + w_from(c) - cx*K_in(c) - cy*K_out(c))
+
+where K_in(c) and K_out(c) are the total weights to and from community c. The
+coefficients only depend on v and the quality function, and the offset
+collects all terms that do not depend on c. It is minus the same expression
+for the current community of v, after removing v (its size or degrees, and
+its self-loops) from that community. Hence diff_move is not called at all:
+everything follows from the weights in NeighbourCommunities and the totals
+of the partition, which neither use the caches of the partition or the graph
+nor allocate memory.
+
+The community totals are gathered into contiguous arrays (structure of
+arrays), which are then evaluated using AVX-512 or AVX2 if the CPU supports
+it, or a scalar loop otherwise.
+****************************************************************************/
+
+class LinearBatchDiffMove : public BatchDiffMove
+{
+  public:
+    LinearBatchDiffMove(MutableVertexPartition* partition, int null_model,
+                        double resolution_parameter, double scale);
+    virtual ~LinearBatchDiffMove() {};
+
+    virtual void reserve(size_t max_comms);
+    virtual void diff_moves(size_t v, NeighbourCommunities const& neighbours,
+                            size_t const* comms, size_t n_comms, double* diffs);
+
+    static const int CONSTANT_POTTS = 1; // Expected weight proportional to community size (CPM, RBER)
+    static const int CONFIGURATION = 2;  // Expected weight proportional to community degree (RBConfiguration, modularity)
+
+  private:
+    int null_model;
+    double resolution_parameter; // For RBER this includes the density
+    double scale;
+
+    LinearDiffTotals totals;
+};
+
+template <int NULL_MODEL>
+inline void LinearDiffTotals::gather(MutableVertexPartition* partition, size_t v,
+                                     NeighbourCommunities const& neighbours,
+                                     size_t const* comms, size_t n_comms,
+                                     double resolution_parameter)
+{
+  Graph* graph = partition->get_graph();
+  size_t v_comm = partition->membership(v);
+  double x_old;
+  double y_old;
+  this->cx = 0.0;
+  this->cy = 0.0;
+
+  for (size_t idx = 0; idx < n_comms; idx++)
+  {
+    size_t comm = comms[idx];
+    this->w_to[idx] = neighbours.weight_to_comm(comm);
+    this->w_from[idx] = neighbours.weight_from_comm(comm);
+  }
+
+  if (NULL_MODEL == LinearBatchDiffMove::CONSTANT_POTTS)
+  {
+    this->cx = 2.0*resolution_parameter*graph->node_size(v);
+    for (size_t idx = 0; idx < n_comms; idx++)
+    {
+      this->x[idx] = partition->csize(comms[idx]);
+      this->y[idx] = 0.0;
+    }
+    x_old = partition->csize(v_comm) - graph->node_size(v);
+    y_old = 0.0;
+  }
+  else
+  {
+    double total_weight = graph->total_weight()*(2.0 - graph->is_directed());
+    if (total_weight > 0)
+    {
+      this->cx = resolution_parameter*graph->strength(v, IGRAPH_OUT)/total_weight;
+      this->cy = resolution_parameter*graph->strength(v, IGRAPH_IN)/total_weight;
+    }
+    for (size_t idx = 0; idx < n_comms; idx++)
+    {
+      this->x[idx] = partition->total_weight_to_comm(comms[idx]);
+      this->y[idx] = partition->total_weight_from_comm(comms[idx]);
+    }
+    x_old = partition->total_weight_to_comm(v_comm) - graph->strength(v, IGRAPH_IN);
+    y_old = partition->total_weight_from_comm(v_comm) - graph->strength(v, IGRAPH_OUT);
+  }
+
+  // The self-loops of v stay with v, and count in both directions
+  double self_weight = graph->node_self_weight(v);
+  this->w_old = neighbours.weight_to_comm(v_comm) - self_weight +
+                neighbours.weight_from_comm(v_comm) - self_weight -
+                this->cx*x_old - this->cy*y_old;
+}
+
+// Determine the null model and coefficients of the linear form of diff_move
+// for the partition. Returns false if its quality function is not linear.
+bool linear_parameters(MutableVertexPartition* partition, int& null_model,
+                       double& resolution_parameter, double& scale);
+
+/****************************************************************************
+Batched diff_move for a linear quality function that is known at compile
+time.
+
+This computes the same as LinearBatchDiffMove, but is not virtual, and calls
+the accessors of the concrete type of partition directly instead of through
+the vtable. It is meant to be used by code that is itself templated on the
+type of partition, such as the specialised move_nodes of ExtendedOptimiser,
+so that gathering the totals is inlined into the loop over the nodes.
+****************************************************************************/
+
+template <class Partition, int NULL_MODEL>
+class StaticLinearBatchDiffMove
+{
+  public:
+    StaticLinearBatchDiffMove(Partition* partition) : partition(partition)
+    {
+      int null_model;
+      linear_parameters(partition, null_model, this->resolution_parameter, this->scale);
+    };
+
+    inline void reserve(size_t max_comms) { this->totals.reserve(max_comms); };
+
+    inline void diff_moves(size_t v, NeighbourCommunities const& neighbours,
+                           size_t const* comms, size_t n_comms, double* diffs)
+    {
+      if (n_comms == 0)
+        return;
+
+      this->totals.reserve(n_comms);
+      this->totals.template gather<NULL_MODEL>(this->partition, v, neighbours, comms, n_comms,
+                                               this->resolution_parameter);
+      this->totals.evaluate(this->partition->membership(v), comms, n_comms, this->scale, diffs);
+    };
+
+  private:
+    Partition* partition;
+    double resolution_parameter;
+    double scale;
+
+    LinearDiffTotals totals;
+};
+
+// Name of the instruction set used by linear_diff_kernel ("avx512f", "avx2"
+// or "scalar").
+const char* linear_diff_kernel_isa();
+
+#endif // BATCHDIFFMOVE_H_INCLUDED
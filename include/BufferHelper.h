@@ -0,0 +1,40 @@
+#ifndef BUFFERHELPER_H_INCLUDED
+#define BUFFERHELPER_H_INCLUDED
+
+#include <Python.h>
+#include <libleidenalg/GraphHelper.h>
+
+/****************************************************************************
+Exchange vectors with Python through the buffer protocol.
+
+This allows passing, for example, NumPy arrays of weights, node sizes,
+fixed memberships or memberships, which are then read directly from their
+memory, instead of converting each element to a Python object first. Any
+one-dimensional buffer of booleans, integers or floating point numbers in
+native byte order is accepted; the values are converted to the type of the
+result. Floating point numbers are not accepted for vectors of indices.
+
+The buffer protocol is only part of the limited API from Python 3.11
+onwards. When building against an older limited API, the functions below
+instead read any sequence other than a list element by element, and return
+false for lists, which the callers read themselves.
+****************************************************************************/
+
+#if !defined(Py_LIMITED_API) || Py_LIMITED_API+0 >= 0x030B0000
+  #define LEIDENALG_HAS_BUFFER_PROTOCOL
+#endif
+
+// Read py_obj into result if it supports the buffer protocol, and return
+// true. Return false if py_obj does not support the buffer protocol, and
+// throw an Exception if it does, but its contents cannot be read.
+bool read_buffer(PyObject* py_obj, vector<double>& result);
+bool read_buffer(PyObject* py_obj, vector<bool>& result);
+bool read_buffer(PyObject* py_obj, vector<size_t>& result);
+
+// Return a new memoryview of unsigned integers of the same size as size_t,
+// holding a copy of values, or NULL with a Python error set if this fails.
+PyObject* create_buffer(vector<size_t> const& values);
+// Idem, holding doubles.
+PyObject* create_buffer(vector<double> const& values);
+
+#endif // BUFFERHELPER_H_INCLUDED
@@ -0,0 +1,103 @@
+#ifndef CSRGRAPH_H_INCLUDED
+#define CSRGRAPH_H_INCLUDED
+
+#include <libleidenalg/GraphHelper.h>
+
+#include <stdint.h>
+
+/****************************************************************************
+Compressed sparse row (CSR) layout of the neighbourhoods of a Graph.
+
+Graph::get_neighbours and Graph::get_neighbour_edges only cache the
+neighbourhood of a single node, and query igraph for every other node. When
+nodes are visited in a random order, this means calling into igraph (and
+copying the result) for every visit. This class instead builds the
+neighbourhoods of all nodes once, in a single contiguous array. Neighbour ids
+and edge weights are interleaved, so that iterating over the neighbourhood of
+a node reads a single consecutive block of memory.
+
+The neighbourhood of a node is returned as a span, which refers directly to
+the underlying array, so that no copies are made. As for igraph, self-loops
+of undirected graphs (or when using IGRAPH_ALL) are listed twice, once for
+each end point. The span remains valid for the lifetime of the CSRGraph.
+
+The layout is a snapshot: it does not reflect changes made to the Graph after
+construction. Since it is only read after construction, a CSRGraph can safely
+be shared between threads.
+
+Compact layouts
+
+The layout is a template on the type of the neighbour ids and of the edge
+weights. CSRGraph uses size_t and double, and takes 16 bytes per neighbour.
+CompactCSRGraph uses 32-bit ids (12 bytes per neighbour), and
+CompactFloatCSRGraph also uses float weights (8 bytes per neighbour). Use
+fits to check whether a graph can be represented by a layout: all node ids
+should fit in the id type, and all edge weights should be represented exactly
+by the weight type, so that a compact layout gives exactly the same results.
+The constructor throws an Exception if this is not the case. Weights are
+always accumulated as double.
+****************************************************************************/
+
+template <class Index, class Weight>
+class BasicCSRGraph
+{
+  public:
+    // Packed, so that 32-bit ids with double weights take 12 bytes
+    #pragma pack(push, 4)
+    struct Neighbour
+    {
+      Index node;
+      Weight weight;
+    };
+    #pragma pack(pop)
+
+    class NeighbourSpan
+    {
+      public:
+        NeighbourSpan(Neighbour const* begin, Neighbour const* end) : _begin(begin), _end(end) {};
+
+        inline Neighbour const* begin() const { return this->_begin; };
+        inline Neighbour const* end() const { return this->_end; };
+        inline size_t size() const { return this->_end - this->_begin; };
+        inline bool empty() const { return this->_begin == this->_end; };
+        inline Neighbour const& operator[](size_t idx) const { return this->_begin[idx]; };
+
+      private:
+        Neighbour const* _begin;
+        Neighbour const* _end;
+    };
+
+    BasicCSRGraph() : _mode(IGRAPH_ALL), _max_degree(0), _offsets(1, 0) {};
+    BasicCSRGraph(Graph* graph, igraph_neimode_t mode);
+
+    inline NeighbourSpan neighbours(size_t v) const
+    {
+      Neighbour const* data = this->_neighbours.data();
+      return NeighbourSpan(data + this->_offsets[v], data + this->_offsets[v + 1]);
+    };
+
+    inline size_t degree(size_t v) const { return this->_offsets[v + 1] - this->_offsets[v]; };
+    inline size_t max_degree() const { return this->_max_degree; };
+
+    inline size_t vcount() const { return this->_offsets.size() - 1; };
+    inline igraph_neimode_t mode() const { return this->_mode; };
+
+    // Number of bytes used by the layout.
+    size_t memory_usage() const;
+
+    // Whether the graph can be represented exactly by this layout.
+    static bool fits(Graph* graph);
+
+  private:
+    igraph_neimode_t _mode;
+    size_t _max_degree;
+
+    vector<size_t> _offsets; // Neighbours of v are at positions _offsets[v], ..., _offsets[v + 1] - 1
+    vector<Neighbour> _neighbours;
+};
+
+typedef BasicCSRGraph<size_t, double> CSRGraph;
+typedef BasicCSRGraph<uint32_t, double> CompactCSRGraph;
+typedef BasicCSRGraph<uint32_t, float> CompactFloatCSRGraph;
+
+#endif // CSRGRAPH_H_INCLUDED
@@ -0,0 +1,38 @@
+#ifndef COLLAPSEGRAPH_H_INCLUDED
+#define COLLAPSEGRAPH_H_INCLUDED
+
+#include <libleidenalg/GraphHelper.h>
+#include <libleidenalg/MutableVertexPartition.h>
+
+#include "AggregationArena.h"
+
+/****************************************************************************
+Aggregate the graph based on a partition, using multiple threads.
+
+This creates the same aggregate graph as Graph::collapse_graph: one node per
+community, with the size of the community as node size, and for each
+community an edge to each community that its nodes link to, weighted by the
+total weight of those links. Communities are visited in order, and the edges
+of a community are listed in the order in which its nodes (in increasing
+order) first link to the other communities.
+
+The communities are split in contiguous blocks of roughly equal numbers of
+edges, one block per thread. Each thread accumulates the weights to the
+other communities in its own SparseAccumulator, so that no hashing is
+involved, and collects the aggregate edges of its block. The blocks are
+then concatenated in order, so that the result does not depend on the
+number of threads.
+
+The Graph does not own the igraph_t it is built on, so the result should be
+deleted using delete_collapsed_graph, which also destroys the igraph_t.
+
+All temporary buffers are taken from the given AggregationArena, so that
+repeated aggregations (on every level, and in every call of the optimiser)
+reuse the same memory. Without an arena, a temporary one is used.
+****************************************************************************/
+
+Graph* collapse_graph(Graph* graph, MutableVertexPartition* partition, size_t n_threads);
+Graph* collapse_graph(Graph* graph, MutableVertexPartition* partition, size_t n_threads, AggregationArena& arena);
+void delete_collapsed_graph(Graph* graph);
+
+#endif // COLLAPSEGRAPH_H_INCLUDED
@@ -0,0 +1,30 @@
+#ifndef CONSENSUS_H_INCLUDED
+#define CONSENSUS_H_INCLUDED
+
+#include <libleidenalg/GraphHelper.h>
+
+/****************************************************************************
+Consensus of an ensemble of partitions of the same graph.
+
+agreement_weights computes for every edge the fraction of the memberships in
+which both end points are in the same community, in a single pass over the
+edges, split in contiguous blocks over n_threads threads. Only edges of the
+graph are considered, rather than all pairs of nodes, so that this takes
+O(k m) time for k memberships, and the result does not depend on the number
+of threads. Throws an Exception if a membership does not have one entry per
+node.
+
+create_consensus_graph creates the consensus graph: the edges of graph with
+an agreement above threshold, weighted by their agreement. Nodes keep their
+size. The graph should be deleted using delete_native_graph.
+
+is_agreement_stable tells whether all memberships agree on every edge, i.e.
+all agreement weights are 0 or 1, so that clustering the consensus graph
+again would not change anything.
+****************************************************************************/
+
+vector<double> agreement_weights(Graph* graph, vector< vector<size_t> > const& memberships, size_t n_threads);
+Graph* create_consensus_graph(Graph* graph, vector<double> const& agreement, double threshold);
+bool is_agreement_stable(vector<double> const& agreement);
+
+#endif // CONSENSUS_H_INCLUDED
@@ -0,0 +1,104 @@
+#ifndef DEADLINE_H_INCLUDED
+#define DEADLINE_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+/****************************************************************************
+Deadline and cancellation token of an optimiser.
+
+The long-running loops of ExtendedOptimiser regularly call expired(), and
+stop as soon as it returns true, leaving the partition in a valid state. A
+deadline expires once its time limit has passed, or once it is cancelled,
+which may be done from any thread. It then stays expired until it is reset,
+so that has_expired() tells whether a call stopped early. A deadline with a
+parent also expires once its parent expires, which is used to stop the
+optimisers of concurrent runs together.
+
+A deadline can also poll for requests to stop from outside the optimiser,
+such as signals: expired() then calls the poll function at most once per
+poll interval, and only on the thread that set it, which is the thread that
+runs the optimisation. The poll function may cancel the deadline.
+****************************************************************************/
+
+class Deadline
+{
+  public:
+    typedef std::chrono::steady_clock clock;
+
+    typedef void (*PollFunction)(Deadline* deadline, void* data);
+
+    Deadline() : _has_time_limit(false), _parent(NULL), _poll(NULL), _poll_data(NULL),
+                 _is_cancelled(false), _is_expired(false) {};
+
+    // Expire after the given number of seconds from now, or never if seconds
+    // is negative. Clears an earlier cancellation or expiry.
+    inline void reset(double seconds)
+    {
+      this->_has_time_limit = (seconds >= 0);
+      if (this->_has_time_limit)
+        this->_time_limit = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+      this->_is_cancelled.store(false);
+      this->_is_expired.store(false);
+    };
+
+    inline void cancel() { this->_is_cancelled.store(true); };
+
+    // Also expire once parent expires. The parent should outlive this deadline.
+    inline void set_parent(Deadline* parent) { this->_parent = parent; };
+
+    // Call poll(this, data) from expired() on the calling thread, at most
+    // once every interval seconds. Clear using set_poll(NULL, NULL, 0).
+    inline void set_poll(PollFunction poll, void* data, double interval)
+    {
+      this->_poll = poll;
+      this->_poll_data = data;
+      this->_poll_thread = std::this_thread::get_id();
+      this->_poll_interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(interval));
+      this->_next_poll = clock::now() + this->_poll_interval;
+    };
+
+    inline bool expired()
+    {
+      if (this->_is_expired.load(std::memory_order_relaxed))
+        return true;
+      if (this->_poll != NULL && std::this_thread::get_id() == this->_poll_thread)
+      {
+        clock::time_point now = clock::now();
+        if (now >= this->_next_poll)
+        {
+          this->_next_poll = now + this->_poll_interval;
+          this->_poll(this, this->_poll_data);
+        }
+      }
+      if (this->_is_cancelled.load(std::memory_order_relaxed) ||
+          (this->_has_time_limit && clock::now() >= this->_time_limit) ||
+          (this->_parent != NULL && this->_parent->expired()))
+      {
+        this->_is_expired.store(true);
+        return true;
+      }
+      return false;
+    };
+
+    inline bool has_expired() const { return this->_is_expired.load(); };
+
+  private:
+    bool _has_time_limit;
+    clock::time_point _time_limit;
+    Deadline* _parent;
+    PollFunction _poll;
+    void* _poll_data;
+    std::thread::id _poll_thread;
+    clock::duration _poll_interval;
+    clock::time_point _next_poll;
+    std::atomic<bool> _is_cancelled;
+    std::atomic<bool> _is_expired;
+
+    Deadline(Deadline const&);
+    Deadline& operator=(Deadline const&);
+};
+
+#endif // DEADLINE_H_INCLUDED
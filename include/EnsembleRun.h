@@ -0,0 +1,27 @@
+#ifndef ENSEMBLERUN_H_INCLUDED
+#define ENSEMBLERUN_H_INCLUDED
+
+#include <cstddef>
+
+/****************************************************************************
+Statistics of a single run of ExtendedOptimiser::optimise_ensemble.
+
+Every run optimises the partition independently, starting from the same
+membership, using its own seed. The runs are listed in the order of their
+seeds, regardless of the order in which threads completed them.
+****************************************************************************/
+
+struct EnsembleRun
+{
+  EnsembleRun() : seed(0), quality(0.0), n_communities(0), n_iterations(0),
+                  converged(false), time(0.0) {};
+
+  size_t seed; // Seed of the random number generator of the run.
+  double quality; // Quality of the resulting partition.
+  size_t n_communities; // Number of communities of the resulting partition.
+  size_t n_iterations; // Number of iterations of the Leiden algorithm that were run.
+  bool converged; // Whether the last iteration did not improve the partition.
+  double time; // Wall time of the run in seconds.
+};
+
+#endif // ENSEMBLERUN_H_INCLUDED
@@ -0,0 +1,156 @@
+#ifndef EXTENDEDOPTIMISER_H_INCLUDED
+#define EXTENDEDOPTIMISER_H_INCLUDED
+
+#include <libleidenalg/GraphHelper.h>
+#include <libleidenalg/MutableVertexPartition.h>
+#include <libleidenalg/Optimiser.h>
+
+#include "AggregationArena.h"
+#include "BatchDiffMove.h"
+#include "CollapseGraph.h"
+#include "CSRGraph.h"
+#include "Deadline.h"
+#include "EnsembleRun.h"
+#include "LevelProfile.h"
+#include "MoveScratch.h"
+#include "ParallelHelper.h"
+#include "PartitionHierarchy.h"
+#include "ProfilePoint.h"
+
+template <class CSR> struct CSRNeighbourhoods;
+
+/****************************************************************************
+Optimiser that is used by the Python interface.
+
+The Leiden algorithm itself is implemented in libleidenalg. This class
+extends that optimiser with routines that are not (yet) part of the C++
+library: a queue-based and a multi-threaded move_nodes, a multi-threaded
+refinement, optimising only changed nodes, ensembles and their consensus,
+resolution profiles and checking local optimality. With use_queue or
+n_threads > 1, optimise_partition uses these routines for single partitions,
+and otherwise simply calls the implementation of libleidenalg. Every routine
+is described where it is defined.
+****************************************************************************/
+
+class ExtendedOptimiser : public Optimiser
+{
+  public:
+    ExtendedOptimiser();
+    virtual ~ExtendedOptimiser();
+
+    using Optimiser::optimise_partition;
+    using Optimiser::move_nodes;
+    using Optimiser::optimise_partition_hierarchical;
+    using Optimiser::move_nodes_constrained;
+    using Optimiser::merge_nodes_constrained;
+
+    double optimise_partition(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed);
+    double optimise_partition(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, size_t max_comm_size);
+    double optimise_partition_hierarchical(vector<MutableVertexPartition*> partitions, vector<double> layer_weights, vector<bool> const& is_membership_fixed, PartitionHierarchy& hierarchy);
+    double optimise_changed_nodes(MutableVertexPartition* partition, vector<size_t> const& changed_nodes, vector<bool> const& is_membership_fixed);
+    double optimise_ensemble(MutableVertexPartition* partition, size_t n_starts, size_t n_threads, int n_iterations, vector<EnsembleRun>& runs);
+    double optimise_consensus(MutableVertexPartition* partition, vector< vector<size_t> > memberships, size_t n_threads, size_t max_rounds, double threshold, vector<double>& agreement, size_t& n_rounds);
+    bool is_locally_optimal(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed);
+    void resolution_profile(MutableVertexPartition* partition, double min_resolution, double max_resolution,
+                            double min_diff_bisect_value, double min_diff_resolution, bool linear_bisection,
+                            int n_iterations, size_t n_threads, vector<ProfilePoint>& profile);
+
+    double move_nodes(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes);
+    double move_nodes(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size);
+    double move_nodes_queue(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size);
+    double move_nodes_queue(MutableVertexPartition* partition, vector<size_t> const& initial_nodes, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size);
+    double move_nodes_parallel(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size);
+
+    double move_nodes_constrained(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition);
+    double move_nodes_constrained(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size);
+    double merge_nodes_constrained(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition);
+    double merge_nodes_constrained(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size);
+    double move_nodes_constrained_parallel(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size);
+    double merge_nodes_constrained_parallel(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size);
+
+    void set_rng_seed(size_t seed);
+
+    size_t n_threads; // Number of threads to use for moving nodes, 1 (the default) means single-threaded.
+    size_t batch_size; // Number of nodes that are evaluated in parallel before committing moves.
+    int use_queue; // Only revisit nodes whose neighbourhood changed when moving nodes.
+    int specialise_diff_move; // Use the queue-based move_nodes specialised for the type of partition, if available.
+    int compact_indices; // Use CSR layouts with 32-bit ids (and float weights if exact) when the graph fits.
+    size_t check_interval; // Number of node visits between checks of the deadline.
+    int profiling; // Record a LevelProfile for every level when optimising a partition.
+
+    size_t n_visits; // Number of nodes visited when moving nodes.
+    size_t n_moves; // Number of nodes moved when moving nodes.
+    size_t n_diff_moves; // Number of moves evaluated when moving nodes and refining.
+    size_t n_scratch_allocations; // Number of times scratch buffers had to be (re)allocated.
+
+    AggregationArena arena; // Buffers for aggregating the graph, reused between levels and calls.
+    Deadline deadline; // Time limit and cancellation, checked while optimising.
+    vector<LevelProfile> profile; // Profile of every level while profiling, accumulates over calls.
+
+  private:
+    // Separate from the generator of the base class, which is private.
+    igraph_rng_t rng;
+
+    // Buffers that are reused between calls (one scratch per thread)
+    vector<MoveScratch> scratch;
+    NodeQueue queue;
+    vector<size_t> nodes;
+    vector<NodeQueue> refine_queues;
+    void reserve_scratch(size_t n_threads, MutableVertexPartition* partition, size_t max_degree, int consider_comms);
+    void collect_diff_moves();
+
+    // Replicas of replicated_graph for the threads other than the first (which
+    // uses the graph itself), kept while keep_replica_graphs is set
+    Graph* replicated_graph;
+    vector<Graph*> replica_graphs;
+    bool keep_replica_graphs;
+    void replicate_graphs(Graph* graph, size_t n_replicas);
+    void delete_replica_graphs();
+
+    // CSR layout of neighbourhoods_graph for is_locally_optimal, kept while
+    // keep_neighbourhoods is set
+    Graph* neighbourhoods_graph;
+    CSRNeighbourhoods<CSRGraph>* neighbourhoods;
+    bool keep_neighbourhoods;
+    CSRNeighbourhoods<CSRGraph> const& build_neighbourhoods(Graph* graph);
+    void delete_neighbourhoods();
+
+    enum CSRLayout { FULL_CSR, COMPACT_CSR, COMPACT_FLOAT_CSR };
+    CSRLayout csr_layout(Graph* graph) const;
+
+    double optimise_levels(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, size_t max_comm_size);
+    double split_disconnected_communities(MutableVertexPartition* partition, vector<size_t> const& nodes, vector<bool> const& is_membership_fixed);
+
+    double move_queued_nodes(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size);
+    template <class CSR>
+    double move_nodes_queue_csr(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size);
+    template <class CSR>
+    double move_nodes_parallel_csr(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size);
+
+    template <class Partition, int NULL_MODEL, class CSR>
+    double move_nodes_queue_static(Partition* partition, vector<bool> const& is_membership_fixed,
+                                   CSR const& out_graph, CSR const& in_graph, CSR const& all_graph,
+                                   int consider_comms, size_t max_comm_size, uint64_t seed);
+    template <class DiffMoves, class CSR>
+    double move_nodes_queue_dispatch(MutableVertexPartition* partition, DiffMoves* batch_diff_move, vector<bool> const& is_membership_fixed,
+                                     CSR const& out_graph, CSR const& in_graph, CSR const& all_graph,
+                                     int consider_comms, size_t max_comm_size, uint64_t seed);
+    template <bool IS_DIRECTED, bool IS_WEIGHTED, class DiffMoves, class CSR>
+    double move_nodes_queue_loop(MutableVertexPartition* partition, DiffMoves* batch_diff_move, vector<bool> const& is_membership_fixed,
+                                 CSR const& out_graph, CSR const& in_graph, CSR const& all_graph,
+                                 int consider_comms, size_t max_comm_size, uint64_t seed);
+    bool refines_in_parallel(MutableVertexPartition* partition);
+    double refine_parallel(MutableVertexPartition* partition, bool merge_only, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size);
+    template <class CSR>
+    double refine_parallel_csr(MutableVertexPartition* partition, bool merge_only, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size);
+
+    void copy_settings_to(ExtendedOptimiser* optimiser) const;
+    double run_ensemble(MutableVertexPartition* partition, size_t n_starts, size_t n_threads, int n_iterations, vector<EnsembleRun>& runs, vector< vector<size_t> >* memberships);
+    void optimise_resolutions(MutableVertexPartition* partition, vector<ProfilePoint>& points, int n_iterations,
+                              vector<Graph*>& replica_graphs, vector<ExtendedOptimiser*>& optimisers);
+
+    uint64_t random_seed();
+    void shuffle(vector<size_t>& v);
+};
+
+#endif // EXTENDEDOPTIMISER_H_INCLUDED
@@ -0,0 +1,117 @@
+#ifndef GRAPHFILE_H_INCLUDED
+#define GRAPHFILE_H_INCLUDED
+
+#include <libleidenalg/GraphHelper.h>
+
+#include "NativeGraph.h"
+
+#include <stdint.h>
+#include <string>
+
+using std::string;
+
+/****************************************************************************
+Versioned binary file of a graph, which is memory-mapped read-only.
+
+The file starts with a GraphFileHeader, followed by these arrays, each
+starting at a multiple of 8 bytes:
+
+  offsets            uint64_t[n + 1]  Edges of node v are offsets[v] .. offsets[v + 1]
+  targets            uint64_t[m]      Other end point of each edge
+  weights            double[m]        Only if the graph is weighted
+  node_sizes         double[n]
+  node_self_weights  double[n]
+  strength_out       double[n]
+  strength_in        double[n]
+
+Edges are stored once, in CSR order of their source (for undirected graphs,
+of the end point that igraph reports as IGRAPH_FROM). The edge identifiers of
+a graph read from a file are hence the positions in this order, which may
+differ from the graph that was written; node identifiers are the same. All
+numbers are in native byte order. A file written on a machine with a
+different byte order is rejected, since its version does not match.
+
+Several processes can map the same file, sharing a single copy in the page
+cache. The header is validated when the file is opened, and the edges when
+the Graph is created. Graph itself is part of libleidenalg, and needs an
+igraph_t and its own vectors, so that create_graph still copies the edges
+into a new igraph_t and the weights and node sizes into the Graph. For
+weighted graphs, the self weights are not recomputed. The Graph does not
+own that igraph_t, so it should be deleted using delete_native_graph. The
+GraphFile itself can be closed once the Graph has been created.
+****************************************************************************/
+
+struct GraphFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t n;
+  uint64_t m;
+  double total_weight;
+  double total_size;
+  uint64_t reserved[2];
+};
+
+class GraphFile
+{
+  public:
+    static const uint32_t VERSION = 1;
+
+    enum Flags { DIRECTED = 1, WEIGHTED = 2, CORRECT_SELF_LOOPS = 4 };
+
+    // Map the file read-only. Throws an Exception if the file cannot be
+    // mapped, or is not a valid graph file of this version.
+    GraphFile(string const& path);
+    ~GraphFile();
+
+    // Write graph to a new file at path.
+    static void write(Graph* graph, string const& path);
+
+    inline size_t vcount() const { return this->_header->n; };
+    inline size_t ecount() const { return this->_header->m; };
+    inline bool is_directed() const { return this->_header->flags & DIRECTED; };
+    inline bool is_weighted() const { return this->_header->flags & WEIGHTED; };
+    inline bool correct_self_loops() const { return this->_header->flags & CORRECT_SELF_LOOPS; };
+    inline double total_weight() const { return this->_header->total_weight; };
+    inline double total_size() const { return this->_header->total_size; };
+
+    // Arrays in the mapping, see above. weights is NULL for unweighted graphs.
+    inline uint64_t const* offsets() const { return this->_offsets; };
+    inline uint64_t const* targets() const { return this->_targets; };
+    inline double const* weights() const { return this->_weights; };
+    inline double const* node_sizes() const { return this->_node_sizes; };
+    inline double const* node_self_weights() const { return this->_node_self_weights; };
+    inline double const* strength_out() const { return this->_strength_out; };
+    inline double const* strength_in() const { return this->_strength_in; };
+
+    // Number of bytes mapped.
+    inline size_t size() const { return this->_size; };
+
+    // Create a Graph from the file, to be deleted using delete_native_graph.
+    Graph* create_graph() const;
+
+  private:
+    void* _data;
+    size_t _size;
+    #ifdef _WIN32
+      void* _file;
+      void* _mapping;
+    #endif
+
+    GraphFileHeader const* _header;
+    uint64_t const* _offsets;
+    uint64_t const* _targets;
+    double const* _weights;
+    double const* _node_sizes;
+    double const* _node_self_weights;
+    double const* _strength_out;
+    double const* _strength_in;
+
+    void unmap();
+
+    GraphFile(GraphFile const&);
+    GraphFile& operator=(GraphFile const&);
+};
+
+#endif // GRAPHFILE_H_INCLUDED
@@ -0,0 +1,47 @@
+#ifndef LEVELPROFILE_H_INCLUDED
+#define LEVELPROFILE_H_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+
+/****************************************************************************
+Counters and timings of a single level of optimise_partition.
+
+When profiling is enabled, ExtendedOptimiser records one of these for every
+level, i.e. every graph on which nodes are moved, in the order in which the
+levels were optimised. Times are wall times in seconds. Counters that are
+not measured on a level (for example the aggregate graph if the deadline
+expired before aggregating) are left at zero.
+****************************************************************************/
+
+struct LevelProfile
+{
+  typedef std::chrono::steady_clock clock;
+
+  LevelProfile() : level(0), n_nodes(0), n_edges(0),
+                   n_communities_before(0), n_communities_after(0),
+                   n_visits(0), n_moves(0), n_diff_moves(0),
+                   move_time(0.0), refine_time(0.0), collapse_time(0.0),
+                   n_aggregate_nodes(0), n_aggregate_edges(0) {};
+
+  size_t level; // Level within a call of optimise_partition, starting at 0.
+  size_t n_nodes; // Number of nodes of the graph of this level.
+  size_t n_edges; // Number of edges of the graph of this level.
+  size_t n_communities_before; // Number of non-empty communities before moving nodes.
+  size_t n_communities_after; // Number of non-empty communities after moving nodes.
+  size_t n_visits; // Number of nodes visited when moving nodes.
+  size_t n_moves; // Number of nodes moved when moving nodes.
+  size_t n_diff_moves; // Number of moves evaluated when moving nodes and refining.
+  double move_time; // Time to move nodes.
+  double refine_time; // Time to refine the partition.
+  double collapse_time; // Time to aggregate the graph.
+  size_t n_aggregate_nodes; // Number of nodes of the aggregate graph.
+  size_t n_aggregate_edges; // Number of edges of the aggregate graph.
+
+  static inline double seconds_since(clock::time_point start)
+  {
+    return std::chrono::duration<double>(clock::now() - start).count();
+  };
+};
+
+#endif // LEVELPROFILE_H_INCLUDED
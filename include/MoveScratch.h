@@ -0,0 +1,110 @@
+#ifndef MOVESCRATCH_H_INCLUDED
+#define MOVESCRATCH_H_INCLUDED
+
+#include <libleidenalg/GraphHelper.h>
+
+#include "BatchDiffMove.h"
+#include "SparseAccumulator.h"
+
+/****************************************************************************
+FIFO queue of nodes, together with a bitmap of the nodes that are queued.
+
+Since a node can be queued at most once, the queue never holds more than n
+nodes, and it is implemented as a ring buffer of size n. Once reset for a
+certain number of nodes, pushing and popping never allocates.
+****************************************************************************/
+
+class NodeQueue
+{
+  public:
+    NodeQueue() : _head(0), _size(0) {};
+
+    // Empty the queue, and make sure it can hold n nodes. Returns true if
+    // memory had to be allocated for this.
+    inline bool reset(size_t n)
+    {
+      bool is_allocated = (n > this->_buffer.size() || n > this->_is_queued.capacity());
+      if (n > this->_buffer.size())
+        this->_buffer.resize(n);
+      this->_is_queued.assign(n, false);
+      this->_head = 0;
+      this->_size = 0;
+      return is_allocated;
+    };
+
+    // Append v, unless it is already queued. Returns true if v was appended.
+    inline bool push(size_t v)
+    {
+      if (this->_is_queued[v])
+        return false;
+      size_t pos = this->_head + this->_size;
+      if (pos >= this->_buffer.size())
+        pos -= this->_buffer.size();
+      this->_buffer[pos] = v;
+      this->_is_queued[v] = true;
+      this->_size += 1;
+      return true;
+    };
+
+    inline size_t pop()
+    {
+      size_t v = this->_buffer[this->_head];
+      this->_head += 1;
+      if (this->_head >= this->_buffer.size())
+        this->_head = 0;
+      this->_size -= 1;
+      this->_is_queued[v] = false;
+      return v;
+    };
+
+    inline bool is_queued(size_t v) const { return this->_is_queued[v]; };
+    inline bool empty() const { return this->_size == 0; };
+    inline size_t size() const { return this->_size; };
+
+  private:
+    vector<size_t> _buffer;
+    vector<bool> _is_queued;
+    size_t _head;
+    size_t _size;
+};
+
+/****************************************************************************
+Buffers that are used when evaluating a single node.
+
+The optimiser keeps one of these per thread, and reuses them for every node
+and every call, so that visiting a node does not allocate memory.
+****************************************************************************/
+
+struct MoveScratch
+{
+  MoveScratch() : n_diff_moves(0) {};
+
+  NeighbourCommunities neighbours;
+  vector<size_t> comms; // Candidate communities
+  vector<double> diffs; // Improvement of moving to each candidate community
+  LinearDiffTotals totals; // Totals of the candidates, for linear quality functions
+  size_t n_diff_moves; // Number of moves evaluated, collected by the optimiser
+
+  // Make sure the buffers are large enough. Returns true if memory had to be
+  // allocated for this.
+  inline bool reserve(size_t n_communities, size_t max_degree, size_t max_candidates, bool is_directed)
+  {
+    size_t memory_usage = this->memory_usage();
+    this->neighbours.reserve(n_communities, max_degree, is_directed);
+    this->comms.reserve(max_candidates);
+    if (this->diffs.size() < max_candidates)
+      this->diffs.resize(max_candidates);
+    this->totals.reserve(max_candidates);
+    return this->memory_usage() > memory_usage;
+  };
+
+  inline size_t memory_usage() const
+  {
+    return this->neighbours.memory_usage() +
+           this->comms.capacity()*sizeof(size_t) +
+           this->diffs.capacity()*sizeof(double) +
+           4*this->totals.w_to.capacity()*sizeof(double);
+  };
+};
+
+#endif // MOVESCRATCH_H_INCLUDED
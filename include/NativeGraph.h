@@ -0,0 +1,53 @@
+#ifndef NATIVEGRAPH_H_INCLUDED
+#define NATIVEGRAPH_H_INCLUDED
+
+#include <libleidenalg/GraphHelper.h>
+
+/****************************************************************************
+Graphs that are created by the extension itself, rather than from the
+igraph_t of a python-igraph Graph (see also GraphFile).
+
+create_graph_from_edges creates a graph with n nodes and an edge from[e] to
+to[e] for every e. Graph itself is part of libleidenalg and still needs an
+igraph_t, but this is created directly from the arrays of end points, without
+constructing a python-igraph Graph or any Python objects, so that it can run
+without holding the GIL. Edges keep their position as identifier. If weights
+is empty, all edges have weight 1, and if node_sizes is empty, all nodes have
+size 1. Throws an Exception if an end point is not a node, if the arrays do
+not have matching lengths, or if a weight is not finite. Weights are not
+required to be positive, so the caller should check that if the quality
+function requires it.
+
+create_graph_with_delta creates a new graph from the edges of graph, without
+the removed edges, and with the added edges appended. An edge from
+removed_from[i] to removed_to[i] removes one edge between these nodes (in
+either direction for undirected graphs); it is an error if there is no such
+edge left. The new graph has n nodes, at least as many as graph, and keeps
+the node sizes of graph, while added nodes have size 1. Added edges have
+weight 1 if added_weights is empty. This takes time linear in the size of the
+graph, since Graph needs to be created anew (see
+ExtendedOptimiser::optimise_changed_nodes for updating a partition).
+
+The Graph does not own its igraph_t, so any graph created by the extension
+should be deleted using delete_native_graph.
+****************************************************************************/
+
+Graph* create_graph_from_edges(size_t n,
+                               vector<size_t> const& from,
+                               vector<size_t> const& to,
+                               vector<double> const& weights,
+                               vector<double> const& node_sizes,
+                               bool is_directed,
+                               bool correct_self_loops);
+
+Graph* create_graph_with_delta(Graph* graph,
+                               size_t n,
+                               vector<size_t> const& added_from,
+                               vector<size_t> const& added_to,
+                               vector<double> const& added_weights,
+                               vector<size_t> const& removed_from,
+                               vector<size_t> const& removed_to);
+
+void delete_native_graph(Graph* graph);
+
+#endif // NATIVEGRAPH_H_INCLUDED
@@ -0,0 +1,191 @@
+#ifndef PARALLELHELPER_H_INCLUDED
+#define PARALLELHELPER_H_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+using std::vector;
+
+/****************************************************************************
+Run f(task, thread) for task = 0, ..., n_tasks - 1 using at most n_threads
+threads.
+
+Tasks are split in contiguous blocks, one block per thread, so that the
+assignment of tasks to threads only depends on n_tasks and n_threads. The
+calling thread processes the first block itself. If any of the tasks throws
+an exception, the first such exception is rethrown in the calling thread after
+all threads have finished.
+****************************************************************************/
+template <class F> void parallel_for(size_t n_tasks, size_t n_threads, F f)
+{
+  if (n_threads < 1)
+    n_threads = 1;
+  if (n_threads > n_tasks)
+    n_threads = n_tasks;
+
+  if (n_threads <= 1)
+  {
+    for (size_t task = 0; task < n_tasks; task++)
+      f(task, (size_t)0);
+    return;
+  }
+
+  vector<std::exception_ptr> errors(n_threads);
+  size_t block_size = (n_tasks + n_threads - 1)/n_threads;
+
+  auto run_block = [&](size_t thread)
+  {
+    size_t begin = thread*block_size;
+    size_t end = std::min(n_tasks, begin + block_size);
+    try
+    {
+      for (size_t task = begin; task < end; task++)
+        f(task, thread);
+    }
+    catch (...)
+    {
+      errors[thread] = std::current_exception();
+    }
+  };
+
+  vector<std::thread> threads;
+  threads.reserve(n_threads - 1);
+  for (size_t thread = 1; thread < n_threads; thread++)
+    threads.emplace_back(run_block, thread);
+  run_block(0);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (std::exception_ptr& error : errors)
+    if (error)
+      std::rethrow_exception(error);
+}
+
+/****************************************************************************
+Run f(task, thread) for task = 0, ..., n_tasks - 1 using at most n_threads
+threads, handing out tasks one at a time.
+
+Unlike parallel_for, threads take the next task from a shared counter as soon
+as they finish their previous task, so that tasks of very different sizes are
+balanced over the threads. Tasks are handed out in order, so larger tasks
+should come first. Which thread runs which task depends on timing, so f should
+give the same result regardless of the thread. Exceptions are handled as for
+parallel_for; once a task throws, no new tasks are started.
+****************************************************************************/
+template <class F> void parallel_for_dynamic(size_t n_tasks, size_t n_threads, F f)
+{
+  if (n_threads < 1)
+    n_threads = 1;
+  if (n_threads > n_tasks)
+    n_threads = n_tasks;
+
+  if (n_threads <= 1)
+  {
+    for (size_t task = 0; task < n_tasks; task++)
+      f(task, (size_t)0);
+    return;
+  }
+
+  vector<std::exception_ptr> errors(n_threads);
+  std::atomic<size_t> next_task(0);
+  std::atomic<bool> is_failed(false);
+
+  auto run_tasks = [&](size_t thread)
+  {
+    try
+    {
+      for (size_t task = next_task++; task < n_tasks && !is_failed; task = next_task++)
+        f(task, thread);
+    }
+    catch (...)
+    {
+      errors[thread] = std::current_exception();
+      is_failed = true;
+    }
+  };
+
+  vector<std::thread> threads;
+  threads.reserve(n_threads - 1);
+  for (size_t thread = 1; thread < n_threads; thread++)
+    threads.emplace_back(run_tasks, thread);
+  run_tasks(0);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  for (std::exception_ptr& error : errors)
+    if (error)
+      std::rethrow_exception(error);
+}
+
+/****************************************************************************
+Barrier for a fixed number of threads, which can be reused.
+
+This allows a single parallel region (a parallel_for with one task per
+thread) to run several phases, instead of starting threads for each phase.
+Every thread should call wait the same number of times, so a thread that
+fails should still take part in the remaining barriers.
+****************************************************************************/
+class Barrier
+{
+  public:
+    Barrier(size_t n_threads) : n_threads(n_threads), n_waiting(0), generation(0) {};
+
+    // Block until all threads called wait.
+    void wait()
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      size_t generation = this->generation;
+      this->n_waiting += 1;
+      if (this->n_waiting == this->n_threads)
+      {
+        this->n_waiting = 0;
+        this->generation += 1;
+        lock.unlock();
+        this->condition.notify_all();
+      }
+      else
+        this->condition.wait(lock, [&] { return this->generation != generation; });
+    };
+
+  private:
+    size_t n_threads;
+    size_t n_waiting;
+    size_t generation;
+    std::mutex mutex;
+    std::condition_variable condition;
+};
+
+// Default number of threads, i.e. the number of hardware threads (or 1 if
+// this cannot be determined).
+inline size_t default_n_threads()
+{
+  size_t n_threads = std::thread::hardware_concurrency();
+  return n_threads > 0 ? n_threads : 1;
+}
+
+// Stateless pseudo random number generator (splitmix64). This allows to draw
+// random numbers for a particular item deterministically, independent of the
+// thread that happens to process the item.
+inline uint64_t splitmix64(uint64_t x)
+{
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30))*0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27))*0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+// Random integer in [0, n) for item i of a stream identified by seed.
+inline size_t random_index(uint64_t seed, uint64_t i, size_t n)
+{
+  return (size_t)(splitmix64(seed ^ splitmix64(i)) % n);
+}
+
+#endif // PARALLELHELPER_H_INCLUDED
@@ -0,0 +1,50 @@
+#ifndef PARTITIONHIERARCHY_H_INCLUDED
+#define PARTITIONHIERARCHY_H_INCLUDED
+
+#include <libleidenalg/GraphHelper.h>
+#include <stdint.h>
+
+/****************************************************************************
+Compact representation of a hierarchy of nested partitions.
+
+Instead of keeping a full partition (with its own graph administration) for
+every level, only the mapping from the communities of one level to the
+communities of the next, coarser, level is stored:
+
+  level 0:  node -> community at level 0
+  level k:  community at level k - 1 -> community at level k
+
+Since each level has at most as many communities as the previous one, this
+takes at most n integers for the first level, and usually far fewer for the
+other levels, rather than n per level. All mappings are stored as int32, so
+that the number of nodes may not exceed INT32_MAX.
+
+The membership of the nodes at any level is only materialised on request, by
+composing the mappings.
+****************************************************************************/
+
+class PartitionHierarchy
+{
+  public:
+    PartitionHierarchy() : _n_nodes(0) {};
+
+    // Append the next level, given the membership of all nodes. The membership
+    // should be nested in the previous level, that is, nodes in the same
+    // community in the previous level should also be in the same community.
+    void add_level(vector<size_t> const& membership);
+
+    // Membership of all nodes at the given level.
+    vector<size_t> membership(size_t level) const;
+
+    inline size_t n_levels() const { return this->_maps.size(); };
+    inline size_t n_nodes() const { return this->_n_nodes; };
+    inline size_t n_communities(size_t level) const { return this->_n_communities[level]; };
+    size_t memory_usage() const;
+
+  private:
+    size_t _n_nodes;
+    vector< vector<int32_t> > _maps;
+    vector<size_t> _n_communities;
+};
+
+#endif // PARTITIONHIERARCHY_H_INCLUDED
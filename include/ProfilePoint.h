@@ -0,0 +1,37 @@
+#ifndef PROFILEPOINT_H_INCLUDED
+#define PROFILEPOINT_H_INCLUDED
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+/****************************************************************************
+A partition at a single resolution of ExtendedOptimiser::resolution_profile.
+
+The quality of a partition with a linear resolution parameter is linear in
+the resolution. Hence the quality at any resolution follows from the quality
+at resolution 0 and the slope, which are computed once from the totals of the
+communities when the point is optimised. The profile compares points using
+these two numbers only, without revisiting the communities.
+****************************************************************************/
+
+struct ProfilePoint
+{
+  ProfilePoint() : resolution(0.0), bisect_value(0.0), quality_at_zero(0.0),
+                   quality_slope(0.0), is_stable(false) {};
+
+  double resolution; // Resolution at which the partition was optimised.
+  vector<size_t> membership; // Membership of the partition (before: the initial membership).
+  double bisect_value; // Total weight within communities, which is constant between breakpoints.
+  double quality_at_zero; // Quality of the partition at resolution 0.
+  double quality_slope; // Change in quality per unit of resolution.
+  bool is_stable; // Whether the partition is locally optimal (see ExtendedOptimiser::is_locally_optimal).
+
+  inline double quality(double resolution) const
+  {
+    return this->quality_at_zero + this->quality_slope*resolution;
+  };
+};
+
+#endif // PROFILEPOINT_H_INCLUDED
@@ -0,0 +1,175 @@
+#ifndef SPARSEACCUMULATOR_H_INCLUDED
+#define SPARSEACCUMULATOR_H_INCLUDED
+
+#include <libleidenalg/GraphHelper.h>
+
+#include "CSRGraph.h"
+
+/****************************************************************************
+Sparse accumulator of values indexed by community.
+
+The values are stored in a dense scratch array, but only the entries that
+were touched since the last clear are tracked and reset. Hence, accumulating
+the weights of the neighbourhood of a node costs time proportional to its
+degree, no matter how many communities there are. The scratch array is only
+allocated once, and only grows.
+****************************************************************************/
+
+class SparseAccumulator
+{
+  public:
+    SparseAccumulator() {};
+    SparseAccumulator(size_t n) : _values(n, 0.0), _is_touched(n, 0) {};
+    SparseAccumulator(size_t n, size_t max_touched) : _values(n, 0.0), _is_touched(n, 0)
+    { this->_touched.reserve(max_touched); };
+
+    // Make sure indices 0, ..., n - 1 can be used, and that up to max_touched
+    // indices can be touched without allocating. Existing values are kept.
+    inline void reserve(size_t n, size_t max_touched)
+    {
+      if (n > this->_values.size())
+      {
+        this->_values.resize(n, 0.0);
+        this->_is_touched.resize(n, 0);
+      }
+      this->_touched.reserve(max_touched);
+    };
+
+    inline void add(size_t idx, double w)
+    {
+      if (!this->_is_touched[idx])
+      {
+        this->_is_touched[idx] = 1;
+        this->_touched.push_back(idx);
+      }
+      this->_values[idx] += w;
+    };
+
+    inline double get(size_t idx) const
+    { return idx < this->_values.size() ? this->_values[idx] : 0.0; };
+
+    // Indices that were touched since the last clear, in order of first touch.
+    inline vector<size_t> const& touched() const { return this->_touched; };
+
+    inline void clear()
+    {
+      for (size_t idx : this->_touched)
+      {
+        this->_values[idx] = 0.0;
+        this->_is_touched[idx] = 0;
+      }
+      this->_touched.clear();
+    };
+
+    inline size_t memory_usage() const
+    {
+      return this->_values.capacity()*sizeof(double) +
+             this->_is_touched.capacity()*sizeof(unsigned char) +
+             this->_touched.capacity()*sizeof(size_t);
+    };
+
+  private:
+    vector<double> _values;
+    vector<unsigned char> _is_touched; // Not vector<bool>, for faster access
+    vector<size_t> _touched;
+};
+
+/****************************************************************************
+Weights from a node to the communities of its neighbours.
+
+This provides the same information as weight_to_comm, weight_from_comm and
+get_neigh_comms of MutableVertexPartition, but using sparse accumulators, and
+without relying on the caches of the partition. Since it does not change the
+partition, different threads can each use their own NeighbourCommunities on
+the same partition.
+
+For undirected graphs, out_graph and in_graph should both refer to the same
+CSRGraph (with mode IGRAPH_ALL), and only a single accumulator is used. As for
+MutableVertexPartition, undirected self-loops count only once.
+****************************************************************************/
+
+class NeighbourCommunities
+{
+  public:
+    NeighbourCommunities() : _v(0), _is_directed(false) {};
+    NeighbourCommunities(size_t n_communities, size_t max_degree, bool is_directed) : _v(0), _is_directed(false)
+    { this->reserve(n_communities, max_degree, is_directed); };
+
+    // Make sure that nodes of degree at most max_degree can be computed without
+    // allocating, if all communities are below n_communities.
+    inline void reserve(size_t n_communities, size_t max_degree, bool is_directed)
+    {
+      this->_is_directed = is_directed;
+      this->_to.reserve(n_communities, max_degree);
+      if (is_directed)
+      {
+        this->_from.reserve(n_communities, max_degree);
+        this->_all.reserve(n_communities, max_degree);
+      }
+    };
+
+    template <class CSR>
+    inline void compute(size_t v, vector<size_t> const& membership,
+                        CSR const& out_graph, CSR const& in_graph)
+    {
+      if (this->_is_directed)
+        this->compute<true, true>(v, membership, out_graph, in_graph);
+      else
+        this->compute<false, true>(v, membership, out_graph, in_graph);
+    };
+
+    // As compute, for a graph whose directedness is known at compile time.
+    // For unweighted graphs (IS_WEIGHTED false) all edges count as 1. Any
+    // of the (compact) CSR layouts can be used.
+    template <bool IS_DIRECTED, bool IS_WEIGHTED, class CSR>
+    inline void compute(size_t v, vector<size_t> const& membership,
+                        CSR const& out_graph, CSR const& in_graph)
+    {
+      this->_to.clear();
+      this->_from.clear();
+      this->_all.clear();
+      this->_v = v;
+
+      for (typename CSR::Neighbour const& neighbour : out_graph.neighbours(v))
+      {
+        double w = IS_WEIGHTED ? neighbour.weight : 1.0;
+        if (!IS_DIRECTED && neighbour.node == v)
+          w /= 2.0;
+        this->_to.add(membership[neighbour.node], w);
+      }
+
+      if (IS_DIRECTED)
+      {
+        for (typename CSR::Neighbour const& neighbour : in_graph.neighbours(v))
+          this->_from.add(membership[neighbour.node], IS_WEIGHTED ? neighbour.weight : 1.0);
+
+        // Union of communities of in- and out-neighbours
+        for (size_t comm : this->_to.touched())
+          this->_all.add(comm, this->_to.get(comm));
+        for (size_t comm : this->_from.touched())
+          this->_all.add(comm, this->_from.get(comm));
+      }
+    };
+
+    inline size_t node() const { return this->_v; };
+
+    inline double weight_to_comm(size_t comm) const { return this->_to.get(comm); };
+    inline double weight_from_comm(size_t comm) const
+    { return this->_is_directed ? this->_from.get(comm) : this->_to.get(comm); };
+
+    // Communities of all (in- and out-) neighbours.
+    inline vector<size_t> const& comms() const
+    { return this->_is_directed ? this->_all.touched() : this->_to.touched(); };
+
+    inline size_t memory_usage() const
+    { return this->_to.memory_usage() + this->_from.memory_usage() + this->_all.memory_usage(); };
+
+  private:
+    size_t _v;
+    bool _is_directed;
+    SparseAccumulator _to;
+    SparseAccumulator _from;
+    SparseAccumulator _all;
+};
+
+#endif // SPARSEACCUMULATOR_H_INCLUDED
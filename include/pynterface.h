@@ -12,6 +12,7 @@
 #include <libleidenalg/CPMVertexPartition.h>
 #include <libleidenalg/Optimiser.h>
 
+#include "python_graph_interface.h"
 #include "python_partition_interface.h"
 #include "python_optimiser_interface.h"
 
@@ -47,16 +48,33 @@ extern "C"
       {"_MutableVertexPartition_weight_to_comm",                    (PyCFunction)_MutableVertexPartition_weight_to_comm,                    METH_VARARGS | METH_KEYWORDS, ""},
       {"_MutableVertexPartition_weight_from_comm",                  (PyCFunction)_MutableVertexPartition_weight_from_comm,                  METH_VARARGS | METH_KEYWORDS, ""},
       {"_MutableVertexPartition_get_membership",                    (PyCFunction)_MutableVertexPartition_get_membership,                    METH_VARARGS | METH_KEYWORDS, ""},
+      {"_MutableVertexPartition_get_membership_buffer",             (PyCFunction)_MutableVertexPartition_get_membership_buffer,             METH_VARARGS | METH_KEYWORDS, ""},
       {"_MutableVertexPartition_set_membership",                    (PyCFunction)_MutableVertexPartition_set_membership,                    METH_VARARGS | METH_KEYWORDS, ""},
       {"_ResolutionParameterVertexPartition_get_resolution",        (PyCFunction)_ResolutionParameterVertexPartition_get_resolution,        METH_VARARGS | METH_KEYWORDS, ""},
       {"_ResolutionParameterVertexPartition_set_resolution",        (PyCFunction)_ResolutionParameterVertexPartition_set_resolution,        METH_VARARGS | METH_KEYWORDS, ""},
       {"_ResolutionParameterVertexPartition_quality",               (PyCFunction)_ResolutionParameterVertexPartition_quality,               METH_VARARGS | METH_KEYWORDS, ""},
 
+      {"_new_NativeGraph_from_file",                                (PyCFunction)_new_NativeGraph_from_file,                                METH_VARARGS | METH_KEYWORDS, ""},
+      {"_new_NativeGraph_from_edges",                               (PyCFunction)_new_NativeGraph_from_edges,                               METH_VARARGS | METH_KEYWORDS, ""},
+      {"_NativeGraph_write_file",                                   (PyCFunction)_NativeGraph_write_file,                                   METH_VARARGS | METH_KEYWORDS, ""},
+      {"_NativeGraph_apply_edge_delta",                             (PyCFunction)_NativeGraph_apply_edge_delta,                             METH_VARARGS | METH_KEYWORDS, ""},
+      {"_NativeGraph_vcount",                                       (PyCFunction)_NativeGraph_vcount,                                       METH_VARARGS | METH_KEYWORDS, ""},
+      {"_NativeGraph_ecount",                                       (PyCFunction)_NativeGraph_ecount,                                       METH_VARARGS | METH_KEYWORDS, ""},
+      {"_NativeGraph_is_directed",                                  (PyCFunction)_NativeGraph_is_directed,                                  METH_VARARGS | METH_KEYWORDS, ""},
+      {"_write_graph_file",                                         (PyCFunction)_write_graph_file,                                         METH_VARARGS | METH_KEYWORDS, ""},
+
 
       {"_new_Optimiser",                            (PyCFunction)_new_Optimiser,                            METH_NOARGS,                  ""},
       {"_Optimiser_optimise_partition",             (PyCFunction)_Optimiser_optimise_partition,             METH_VARARGS | METH_KEYWORDS, ""},
       {"_Optimiser_optimise_partition_multiplex",   (PyCFunction)_Optimiser_optimise_partition_multiplex,   METH_VARARGS | METH_KEYWORDS, ""},
       {"_Optimiser_optimise_partition_hierarchical", (PyCFunction)_Optimiser_optimise_partition_hierarchical, METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_optimise_graph",                 (PyCFunction)_Optimiser_optimise_graph,                 METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_optimise_ensemble",              (PyCFunction)_Optimiser_optimise_ensemble,              METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_optimise_consensus",             (PyCFunction)_Optimiser_optimise_consensus,             METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_resolution_profile",             (PyCFunction)_Optimiser_resolution_profile,             METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_is_locally_optimal",             (PyCFunction)_Optimiser_is_locally_optimal,             METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_optimise_changed_nodes",               (PyCFunction)_Optimiser_optimise_changed_nodes,               METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_optimise_graph_changed_nodes",                   (PyCFunction)_Optimiser_optimise_graph_changed_nodes,                   METH_VARARGS | METH_KEYWORDS, ""},
       {"_Optimiser_move_nodes",                     (PyCFunction)_Optimiser_move_nodes,                     METH_VARARGS | METH_KEYWORDS, ""},
       {"_Optimiser_move_nodes_constrained",         (PyCFunction)_Optimiser_move_nodes_constrained,         METH_VARARGS | METH_KEYWORDS, ""},
       {"_Optimiser_merge_nodes",                    (PyCFunction)_Optimiser_merge_nodes,                    METH_VARARGS | METH_KEYWORDS, ""},
@@ -69,6 +87,11 @@ extern "C"
       {"_Optimiser_set_consider_empty_community",   (PyCFunction)_Optimiser_set_consider_empty_community,   METH_VARARGS | METH_KEYWORDS, ""},
       {"_Optimiser_set_refine_partition",           (PyCFunction)_Optimiser_set_refine_partition,           METH_VARARGS | METH_KEYWORDS, ""},
       {"_Optimiser_set_max_comm_size",              (PyCFunction)_Optimiser_set_max_comm_size,              METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_set_n_threads",                  (PyCFunction)_Optimiser_set_n_threads,                  METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_set_use_queue",                  (PyCFunction)_Optimiser_set_use_queue,                  METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_set_compact_indices",            (PyCFunction)_Optimiser_set_compact_indices,            METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_set_check_interval",             (PyCFunction)_Optimiser_set_check_interval,             METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_set_profiling",                  (PyCFunction)_Optimiser_set_profiling,                  METH_VARARGS | METH_KEYWORDS, ""},
 
       {"_Optimiser_get_consider_comms",             (PyCFunction)_Optimiser_get_consider_comms,             METH_VARARGS | METH_KEYWORDS, ""},
       {"_Optimiser_get_refine_consider_comms",      (PyCFunction)_Optimiser_get_refine_consider_comms,      METH_VARARGS | METH_KEYWORDS, ""},
@@ -77,6 +100,26 @@ extern "C"
       {"_Optimiser_get_consider_empty_community",   (PyCFunction)_Optimiser_get_consider_empty_community,   METH_VARARGS | METH_KEYWORDS, ""},
       {"_Optimiser_get_refine_partition",           (PyCFunction)_Optimiser_get_refine_partition,           METH_VARARGS | METH_KEYWORDS, ""},
       {"_Optimiser_get_max_comm_size",              (PyCFunction)_Optimiser_get_max_comm_size,              METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_n_threads",                  (PyCFunction)_Optimiser_get_n_threads,                  METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_use_queue",                  (PyCFunction)_Optimiser_get_use_queue,                  METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_compact_indices",            (PyCFunction)_Optimiser_get_compact_indices,            METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_check_interval",             (PyCFunction)_Optimiser_get_check_interval,             METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_profiling",                  (PyCFunction)_Optimiser_get_profiling,                  METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_n_visits",                   (PyCFunction)_Optimiser_get_n_visits,                   METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_n_moves",                    (PyCFunction)_Optimiser_get_n_moves,                    METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_n_diff_moves",               (PyCFunction)_Optimiser_get_n_diff_moves,               METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_n_scratch_allocations",      (PyCFunction)_Optimiser_get_n_scratch_allocations,      METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_arena_peak_bytes",           (PyCFunction)_Optimiser_get_arena_peak_bytes,           METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_arena_bytes_allocated",      (PyCFunction)_Optimiser_get_arena_bytes_allocated,      METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_set_timeout",                    (PyCFunction)_Optimiser_set_timeout,                    METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_cancel",                         (PyCFunction)_Optimiser_cancel,                         METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_has_expired",                    (PyCFunction)_Optimiser_has_expired,                    METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_get_profile",                    (PyCFunction)_Optimiser_get_profile,                    METH_VARARGS | METH_KEYWORDS, ""},
+      {"_Optimiser_clear_profile",                  (PyCFunction)_Optimiser_clear_profile,                  METH_VARARGS | METH_KEYWORDS, ""},
+
+      {"_PartitionHierarchy_get_n_levels",          (PyCFunction)_PartitionHierarchy_get_n_levels,          METH_VARARGS | METH_KEYWORDS, ""},
+      {"_PartitionHierarchy_get_membership",        (PyCFunction)_PartitionHierarchy_get_membership,        METH_VARARGS | METH_KEYWORDS, ""},
+      {"_PartitionHierarchy_get_memory_usage",      (PyCFunction)_PartitionHierarchy_get_memory_usage,      METH_VARARGS | METH_KEYWORDS, ""},
 
       {"_Optimiser_set_rng_seed",                   (PyCFunction)_Optimiser_set_rng_seed,                   METH_VARARGS | METH_KEYWORDS, ""},
 
@@ -0,0 +1,45 @@
+#ifndef PYNTERFACE_GRAPH_H_INCLUDED
+#define PYNTERFACE_GRAPH_H_INCLUDED
+
+#include <Python.h>
+#include <igraph/igraph.h>
+#include <libleidenalg/GraphHelper.h>
+
+#include "GraphFile.h"
+#include "NativeGraph.h"
+
+#include "python_partition_interface.h"
+
+#ifdef DEBUG
+#include <iostream>
+  using std::cerr;
+  using std::endl;
+#endif
+
+// Graphs that are only held by the extension (see NativeGraph in Python),
+// which own their igraph_t.
+PyObject* capsule_NativeGraph(Graph* graph);
+Graph* decapsule_NativeGraph(PyObject* py_graph);
+void del_NativeGraph(PyObject* py_graph);
+
+// Read node indices or numbers from a buffer or a list (or None, for numbers).
+vector<size_t> read_node_vector(PyObject* py_list);
+vector<double> read_double_vector(PyObject* py_list);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+  PyObject* _new_NativeGraph_from_file(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _new_NativeGraph_from_edges(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _NativeGraph_write_file(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _NativeGraph_apply_edge_delta(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _NativeGraph_vcount(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _NativeGraph_ecount(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _NativeGraph_is_directed(PyObject *self, PyObject *args, PyObject *keywds);
+
+  PyObject* _write_graph_file(PyObject *self, PyObject *args, PyObject *keywds);
+#ifdef __cplusplus
+}
+#endif
+#endif // PYNTERFACE_GRAPH_H_INCLUDED
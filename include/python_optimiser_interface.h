@@ -12,6 +12,10 @@
 #include <libleidenalg/CPMVertexPartition.h>
 #include <libleidenalg/Optimiser.h>
 
+#include "Consensus.h"
+#include "ExtendedOptimiser.h"
+
+#include "python_graph_interface.h"
 #include "python_partition_interface.h"
 
 #ifdef DEBUG
@@ -20,10 +24,14 @@
   using std::endl;
 #endif
 
-PyObject* capsule_Optimiser(Optimiser* optimiser);
-Optimiser* decapsule_Optimiser(PyObject* py_optimiser);
+PyObject* capsule_Optimiser(ExtendedOptimiser* optimiser);
+ExtendedOptimiser* decapsule_Optimiser(PyObject* py_optimiser);
 void del_Optimiser(PyObject* py_optimiser);
 
+PyObject* capsule_PartitionHierarchy(PartitionHierarchy* hierarchy);
+PartitionHierarchy* decapsule_PartitionHierarchy(PyObject* py_hierarchy);
+void del_PartitionHierarchy(PyObject* py_hierarchy);
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -32,6 +40,13 @@ extern "C"
   PyObject* _Optimiser_optimise_partition(PyObject *self, PyObject *args, PyObject *keywds);
   PyObject* _Optimiser_optimise_partition_multiplex(PyObject *self, PyObject *args, PyObject *keywds);
   PyObject* _Optimiser_optimise_partition_hierarchical(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_optimise_graph(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_optimise_ensemble(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_optimise_consensus(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_resolution_profile(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_is_locally_optimal(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_optimise_changed_nodes(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_optimise_graph_changed_nodes(PyObject *self, PyObject *args, PyObject *keywds);
   PyObject* _Optimiser_move_nodes(PyObject *self, PyObject *args, PyObject *keywds);
   PyObject* _Optimiser_move_nodes_constrained(PyObject *self, PyObject *args, PyObject *keywds);
   PyObject* _Optimiser_merge_nodes(PyObject *self, PyObject *args, PyObject *keywds);
@@ -44,6 +59,11 @@ extern "C"
   PyObject* _Optimiser_set_consider_empty_community(PyObject *self, PyObject *args, PyObject *keywds);
   PyObject* _Optimiser_set_refine_partition(PyObject *self, PyObject *args, PyObject *keywds);
   PyObject* _Optimiser_set_max_comm_size(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_set_n_threads(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_set_use_queue(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_set_compact_indices(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_set_check_interval(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_set_profiling(PyObject *self, PyObject *args, PyObject *keywds);
   PyObject* _Optimiser_set_rng_seed(PyObject *self, PyObject *args, PyObject *keywds);
 
   PyObject* _Optimiser_get_consider_comms(PyObject *self, PyObject *args, PyObject *keywds);
@@ -53,6 +73,26 @@ extern "C"
   PyObject* _Optimiser_get_consider_empty_community(PyObject *self, PyObject *args, PyObject *keywds);
   PyObject* _Optimiser_get_refine_partition(PyObject *self, PyObject *args, PyObject *keywds);
   PyObject* _Optimiser_get_max_comm_size(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_n_threads(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_use_queue(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_compact_indices(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_check_interval(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_profiling(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_n_visits(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_n_moves(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_n_diff_moves(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_n_scratch_allocations(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_arena_peak_bytes(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_arena_bytes_allocated(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_set_timeout(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_cancel(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_has_expired(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_get_profile(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _Optimiser_clear_profile(PyObject *self, PyObject *args, PyObject *keywds);
+
+  PyObject* _PartitionHierarchy_get_n_levels(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _PartitionHierarchy_get_membership(PyObject *self, PyObject *args, PyObject *keywds);
+  PyObject* _PartitionHierarchy_get_memory_usage(PyObject *self, PyObject *args, PyObject *keywds);
 
 #ifdef __cplusplus
 }
@@ -54,18 +54,101 @@ import os.path
 # Get the absolute path to the library directory
 lib_dir = os.path.abspath('build-deps/install/lib')
 
+# Sources of the extension that do not depend on Python, which the C++
+# programs below are built from as well
+core_sources = [os.path.join('src', 'leidenalg', 'AggregationArena.cpp'),
+                os.path.join('src', 'leidenalg', 'BatchDiffMove.cpp'),
+                os.path.join('src', 'leidenalg', 'BufferHelper.cpp'),
+                os.path.join('src', 'leidenalg', 'CSRGraph.cpp'),
+                os.path.join('src', 'leidenalg', 'CollapseGraph.cpp'),
+                os.path.join('src', 'leidenalg', 'Consensus.cpp'),
+                os.path.join('src', 'leidenalg', 'ExtendedOptimiser.cpp'),
+                os.path.join('src', 'leidenalg', 'GraphFile.cpp'),
+                os.path.join('src', 'leidenalg', 'NativeGraph.cpp'),
+                os.path.join('src', 'leidenalg', 'PartitionHierarchy.cpp')]
+
+include_dirs = ['include',
+                'build-deps/install/include',
+                'build-deps/install/include/libleidenalg']
+
+from setuptools import Command
+
+class build_program(Command):
+    """Build a C++ program against the same dependencies as the extension.
+
+    Subclasses set the name of the executable, its sources and any libraries
+    it needs in addition to libleidenalg and igraph.
+    """
+    program = None
+    sources = []
+    libraries = []
+    default_build_dir = None
+
+    user_options = [('build-dir=', 'b', "directory for the executable")]
+
+    def initialize_options(self):
+        self.build_dir = None
+
+    def finalize_options(self):
+        if self.build_dir is None:
+            self.build_dir = self.default_build_dir
+
+    def run(self):
+        from distutils.ccompiler import new_compiler
+        from distutils.sysconfig import customize_compiler
+
+        compiler = new_compiler()
+        customize_compiler(compiler)
+        extra_args = [] if compiler.compiler_type == 'msvc' else ['-O2', '-std=c++17', '-pthread']
+        library_dirs = ['build-deps/install/lib', 'build-deps/install/lib64']
+        objects = compiler.compile(self.sources,
+                                   output_dir=os.path.join(self.build_dir, 'obj'),
+                                   include_dirs=include_dirs,
+                                   extra_postargs=extra_args)
+        compiler.link_executable(objects, self.program,
+                                 output_dir=self.build_dir,
+                                 libraries=['libleidenalg', 'igraph'] + self.libraries,
+                                 library_dirs=library_dirs,
+                                 runtime_library_dirs=[os.path.abspath(d) for d in library_dirs] if sys.platform.startswith('linux') else [],
+                                 target_lang='c++',
+                                 extra_postargs=extra_args)
+
+class build_benchmarks(build_program):
+    """Build the Google Benchmark suite in benchmarks/hot_paths.cpp as
+    build/benchmarks/hot_paths. Google Benchmark should be installed where the
+    compiler can find it."""
+    description = "build the benchmarks of the C++ hot paths"
+    program = 'hot_paths'
+    sources = core_sources + [os.path.join('benchmarks', 'hot_paths.cpp')]
+    libraries = ['benchmark']
+    default_build_dir = os.path.join('build', 'benchmarks')
+
+class build_tests(build_program):
+    """Build the C++ test programs in tests/ into build/tests, which the Python
+    tests run."""
+    description = "build the C++ test programs"
+    program = 'test_allocations'
+    sources = [os.path.join('src', 'leidenalg', 'BatchDiffMove.cpp'),
+               os.path.join('src', 'leidenalg', 'CSRGraph.cpp'),
+               os.path.join('src', 'leidenalg', 'NativeGraph.cpp'),
+               os.path.join('tests', 'test_allocations.cpp')]
+    default_build_dir = os.path.join('build', 'tests')
+
+cmdclass["build_benchmarks"] = build_benchmarks
+cmdclass["build_tests"] = build_tests
+
 setup(
     ext_modules = [
         Extension('leidenalg._c_leiden',
-                  sources = [os.path.join('src', 'leidenalg', 'python_optimiser_interface.cpp'),
+                  sources = core_sources +
+                            [os.path.join('src', 'leidenalg', 'python_graph_interface.cpp'),
+                             os.path.join('src', 'leidenalg', 'python_optimiser_interface.cpp'),
                              os.path.join('src', 'leidenalg', 'python_partition_interface.cpp'),
                              os.path.join('src', 'leidenalg', 'pynterface.cpp')],
                   py_limited_api=should_build_abi3_wheel,
                   define_macros=macros,
                   libraries = ['libleidenalg', 'igraph'],
-                  include_dirs=['include',
-                                'build-deps/install/include',
-                                'build-deps/install/include/libleidenalg'],
+                  include_dirs=include_dirs,
                   library_dirs=['build-deps/install/lib'],
                   # Embed the runtime library path so LD_LIBRARY_PATH is not needed
                   runtime_library_dirs=[lib_dir] if sys.platform.startswith('linux') else [],
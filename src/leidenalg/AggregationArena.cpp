@@ -0,0 +1,62 @@
+#include "AggregationArena.h"
+
+template <class T> static size_t capacity_bytes(vector<T> const& v)
+{
+  return v.capacity()*sizeof(T);
+}
+
+size_t AggregationArena::memory_usage() const
+{
+  size_t bytes = capacity_bytes(this->edge_offsets) +
+                 capacity_bytes(this->edges) +
+                 capacity_bytes(this->edges_by_to) +
+                 capacity_bytes(this->comm_offsets) +
+                 capacity_bytes(this->comm_nodes) +
+                 capacity_bytes(this->position) +
+                 capacity_bytes(this->block_begin) +
+                 capacity_bytes(this->block_offsets) +
+                 capacity_bytes(this->collapsed_weights) +
+                 capacity_bytes(this->csizes) +
+                 capacity_bytes(this->membership) +
+                 igraph_vector_int_capacity(&this->collapsed_edges)*sizeof(igraph_integer_t);
+
+  for (vector<igraph_integer_t> const& block : this->block_edges)
+    bytes += capacity_bytes(block);
+  for (vector<double> const& block : this->block_weights)
+    bytes += capacity_bytes(block);
+  for (SparseAccumulator const& accumulator : this->weight_to_comm)
+    bytes += accumulator.memory_usage();
+
+  return bytes;
+}
+
+void AggregationArena::account()
+{
+  size_t bytes = this->memory_usage();
+  if (bytes > this->_bytes)
+    this->total_bytes_allocated += bytes - this->_bytes;
+  this->_bytes = bytes;
+  if (bytes > this->peak_bytes)
+    this->peak_bytes = bytes;
+}
+
+void AggregationArena::release()
+{
+  vector<size_t>().swap(this->edge_offsets);
+  vector<size_t>().swap(this->edges);
+  vector<size_t>().swap(this->edges_by_to);
+  vector<size_t>().swap(this->comm_offsets);
+  vector<size_t>().swap(this->comm_nodes);
+  vector<size_t>().swap(this->position);
+  vector<size_t>().swap(this->block_begin);
+  vector<size_t>().swap(this->block_offsets);
+  vector< vector<igraph_integer_t> >().swap(this->block_edges);
+  vector< vector<double> >().swap(this->block_weights);
+  vector<SparseAccumulator>().swap(this->weight_to_comm);
+  vector<double>().swap(this->collapsed_weights);
+  vector<double>().swap(this->csizes);
+  vector<size_t>().swap(this->membership);
+  igraph_vector_int_destroy(&this->collapsed_edges);
+  igraph_vector_int_init(&this->collapsed_edges, 0);
+  this->_bytes = 0;
+}
@@ -0,0 +1,199 @@
+#include "BatchDiffMove.h"
+
+#include <libleidenalg/CPMVertexPartition.h>
+#include <libleidenalg/ModularityVertexPartition.h>
+#include <libleidenalg/RBConfigurationVertexPartition.h>
+#include <libleidenalg/RBERVertexPartition.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #define LINEAR_DIFF_KERNEL_X86
+  #include <immintrin.h>
+#endif
+
+void BatchDiffMove::diff_moves(size_t v, NeighbourCommunities const& /* neighbours */,
+                               size_t const* comms, size_t n_comms, double* diffs)
+{
+  for (size_t idx = 0; idx < n_comms; idx++)
+    diffs[idx] = this->partition->diff_move(v, comms[idx]);
+}
+
+/*****************************************************************************
+  Parameters of the linear form of diff_move (see LinearBatchDiffMove) for
+  the type of partition.
+*****************************************************************************/
+bool linear_parameters(MutableVertexPartition* partition, int& null_model,
+                       double& resolution_parameter, double& scale)
+{
+  Graph* graph = partition->get_graph();
+
+  if (dynamic_cast<ModularityVertexPartition*>(partition))
+  {
+    double m = graph->is_directed() ? graph->total_weight() : 2.0*graph->total_weight();
+    null_model = LinearBatchDiffMove::CONFIGURATION;
+    resolution_parameter = 1.0;
+    scale = m > 0 ? 1.0/m : 0.0;
+    return true;
+  }
+  else if (RBConfigurationVertexPartition* rb_partition = dynamic_cast<RBConfigurationVertexPartition*>(partition))
+  {
+    null_model = LinearBatchDiffMove::CONFIGURATION;
+    resolution_parameter = rb_partition->resolution_parameter;
+    scale = 1.0;
+    return true;
+  }
+  else if (RBERVertexPartition* rber_partition = dynamic_cast<RBERVertexPartition*>(partition))
+  {
+    null_model = LinearBatchDiffMove::CONSTANT_POTTS;
+    resolution_parameter = rber_partition->resolution_parameter*graph->density();
+    scale = 1.0;
+    return true;
+  }
+  else if (CPMVertexPartition* cpm_partition = dynamic_cast<CPMVertexPartition*>(partition))
+  {
+    null_model = LinearBatchDiffMove::CONSTANT_POTTS;
+    resolution_parameter = cpm_partition->resolution_parameter;
+    scale = 1.0;
+    return true;
+  }
+
+  return false;
+}
+
+/*****************************************************************************
+  Return the batched diff_move for the type of partition. The linear quality
+  functions use vectorised kernels, all others call diff_move for each
+  community.
+*****************************************************************************/
+BatchDiffMove* BatchDiffMove::create(MutableVertexPartition* partition)
+{
+  int null_model;
+  double resolution_parameter;
+  double scale;
+  if (linear_parameters(partition, null_model, resolution_parameter, scale))
+    return new LinearBatchDiffMove(partition, null_model, resolution_parameter, scale);
+
+  return new BatchDiffMove(partition);
+}
+
+LinearBatchDiffMove::LinearBatchDiffMove(MutableVertexPartition* partition, int null_model,
+                                         double resolution_parameter, double scale) :
+  BatchDiffMove(partition)
+{
+  this->null_model = null_model;
+  this->resolution_parameter = resolution_parameter;
+  this->scale = scale;
+}
+
+void LinearBatchDiffMove::reserve(size_t max_comms)
+{
+  this->totals.reserve(max_comms);
+}
+
+void LinearBatchDiffMove::diff_moves(size_t v, NeighbourCommunities const& neighbours,
+                                     size_t const* comms, size_t n_comms, double* diffs)
+{
+  if (n_comms == 0)
+    return;
+
+  this->totals.reserve(n_comms);
+  if (this->null_model == LinearBatchDiffMove::CONSTANT_POTTS)
+    this->totals.gather<LinearBatchDiffMove::CONSTANT_POTTS>(this->partition, v, neighbours, comms, n_comms, this->resolution_parameter);
+  else
+    this->totals.gather<LinearBatchDiffMove::CONFIGURATION>(this->partition, v, neighbours, comms, n_comms, this->resolution_parameter);
+  this->totals.evaluate(this->partition->membership(v), comms, n_comms, this->scale, diffs);
+}
+
+static void linear_diff_kernel_scalar(size_t n, double const* w_to, double const* w_from,
+                                      double const* x, double const* y,
+                                      double cx, double cy, double scale, double offset,
+                                      double* out)
+{
+  for (size_t i = 0; i < n; i++)
+    out[i] = offset + scale*(w_to[i] + w_from[i] - cx*x[i] - cy*y[i]);
+}
+
+#ifdef LINEAR_DIFF_KERNEL_X86
+__attribute__((target("avx2,fma")))
+static void linear_diff_kernel_avx2(size_t n, double const* w_to, double const* w_from,
+                                    double const* x, double const* y,
+                                    double cx, double cy, double scale, double offset,
+                                    double* out)
+{
+  __m256d v_cx = _mm256_set1_pd(cx);
+  __m256d v_cy = _mm256_set1_pd(cy);
+  __m256d v_scale = _mm256_set1_pd(scale);
+  __m256d v_offset = _mm256_set1_pd(offset);
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d w = _mm256_add_pd(_mm256_loadu_pd(w_to + i), _mm256_loadu_pd(w_from + i));
+    w = _mm256_fnmadd_pd(v_cx, _mm256_loadu_pd(x + i), w);
+    w = _mm256_fnmadd_pd(v_cy, _mm256_loadu_pd(y + i), w);
+    _mm256_storeu_pd(out + i, _mm256_fmadd_pd(v_scale, w, v_offset));
+  }
+  linear_diff_kernel_scalar(n - i, w_to + i, w_from + i, x + i, y + i, cx, cy, scale, offset, out + i);
+}
+
+__attribute__((target("avx512f")))
+static void linear_diff_kernel_avx512(size_t n, double const* w_to, double const* w_from,
+                                      double const* x, double const* y,
+                                      double cx, double cy, double scale, double offset,
+                                      double* out)
+{
+  __m512d v_cx = _mm512_set1_pd(cx);
+  __m512d v_cy = _mm512_set1_pd(cy);
+  __m512d v_scale = _mm512_set1_pd(scale);
+  __m512d v_offset = _mm512_set1_pd(offset);
+
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m512d w = _mm512_add_pd(_mm512_loadu_pd(w_to + i), _mm512_loadu_pd(w_from + i));
+    w = _mm512_fnmadd_pd(v_cx, _mm512_loadu_pd(x + i), w);
+    w = _mm512_fnmadd_pd(v_cy, _mm512_loadu_pd(y + i), w);
+    _mm512_storeu_pd(out + i, _mm512_fmadd_pd(v_scale, w, v_offset));
+  }
+  linear_diff_kernel_scalar(n - i, w_to + i, w_from + i, x + i, y + i, cx, cy, scale, offset, out + i);
+}
+#endif
+
+typedef void (*linear_diff_kernel_t)(size_t, double const*, double const*,
+                                     double const*, double const*,
+                                     double, double, double, double, double*);
+
+// Select the kernel once, based on the instruction sets the CPU supports.
+static linear_diff_kernel_t select_linear_diff_kernel(const char** isa)
+{
+  #ifdef LINEAR_DIFF_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+      *isa = "avx512f";
+      return linear_diff_kernel_avx512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+      *isa = "avx2";
+      return linear_diff_kernel_avx2;
+    }
+  #endif
+  *isa = "scalar";
+  return linear_diff_kernel_scalar;
+}
+
+static const char* linear_diff_isa = NULL;
+static linear_diff_kernel_t linear_diff_kernel_impl = select_linear_diff_kernel(&linear_diff_isa);
+
+void linear_diff_kernel(size_t n, double const* w_to, double const* w_from,
+                        double const* x, double const* y,
+                        double cx, double cy, double scale, double offset,
+                        double* out)
+{
+  linear_diff_kernel_impl(n, w_to, w_from, x, y, cx, cy, scale, offset, out);
+}
+
+const char* linear_diff_kernel_isa()
+{
+  return linear_diff_isa;
+}
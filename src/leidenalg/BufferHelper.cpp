@@ -0,0 +1,236 @@
+#include "BufferHelper.h"
+
+#include <cstring>
+#include <stdint.h>
+#include <type_traits>
+
+#ifdef LEIDENALG_HAS_BUFFER_PROTOCOL
+
+// Copy n elements of type S, which are stride bytes apart, to result.
+template <class S, class T>
+static void copy_buffer(char const* data, Py_ssize_t stride, size_t n, vector<T>& result)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    S value;
+    memcpy(&value, data + i*stride, sizeof(S));
+    result[i] = (T)value;
+  }
+}
+
+template <class T>
+static bool read_buffer_impl(PyObject* py_obj, vector<T>& result)
+{
+  if (!PyObject_CheckBuffer(py_obj))
+    return false;
+
+  Py_buffer buffer;
+  if (PyObject_GetBuffer(py_obj, &buffer, PyBUF_STRIDES | PyBUF_FORMAT) < 0)
+  {
+    PyErr_Clear();
+    throw Exception("Could not read buffer.");
+  }
+
+  if (buffer.ndim != 1)
+  {
+    PyBuffer_Release(&buffer);
+    throw Exception("Expected a one-dimensional buffer.");
+  }
+
+  // Only accept native byte order, possibly using standard sizes, since the
+  // size of each element is taken from the item size anyway.
+  char const* format = buffer.format != NULL ? buffer.format : "B";
+  if (*format == '@' || *format == '=')
+    format++;
+  #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    else if (*format == '<')
+      format++;
+  #endif
+
+  size_t n = buffer.shape[0];
+  Py_ssize_t stride = buffer.strides[0];
+  char const* data = (char const*)buffer.buf;
+  size_t itemsize = buffer.itemsize;
+  char type = format[1] == '\0' ? format[0] : '\0';
+
+  result.resize(n);
+  bool is_read = true;
+  switch (type)
+  {
+    case 'd': case 'f':
+      // Do not silently truncate floating point numbers to indices
+      if (std::is_same<T, size_t>::value)
+        is_read = false;
+      else if (itemsize == sizeof(double))
+        copy_buffer<double>(data, stride, n, result);
+      else if (itemsize == sizeof(float))
+        copy_buffer<float>(data, stride, n, result);
+      else
+        is_read = false;
+      break;
+    case 'b': case 'h': case 'i': case 'l': case 'q': case 'n':
+      if (itemsize == 1)
+        copy_buffer<int8_t>(data, stride, n, result);
+      else if (itemsize == 2)
+        copy_buffer<int16_t>(data, stride, n, result);
+      else if (itemsize == 4)
+        copy_buffer<int32_t>(data, stride, n, result);
+      else if (itemsize == 8)
+        copy_buffer<int64_t>(data, stride, n, result);
+      else
+        is_read = false;
+      break;
+    case '?': case 'B': case 'H': case 'I': case 'L': case 'Q': case 'N':
+      if (itemsize == 1)
+        copy_buffer<uint8_t>(data, stride, n, result);
+      else if (itemsize == 2)
+        copy_buffer<uint16_t>(data, stride, n, result);
+      else if (itemsize == 4)
+        copy_buffer<uint32_t>(data, stride, n, result);
+      else if (itemsize == 8)
+        copy_buffer<uint64_t>(data, stride, n, result);
+      else
+        is_read = false;
+      break;
+    default:
+      is_read = false;
+  }
+
+  PyBuffer_Release(&buffer);
+
+  if (!is_read)
+  {
+    if (std::is_same<T, size_t>::value)
+      throw Exception("Expected a buffer of booleans or integers in native byte order.");
+    throw Exception("Expected a buffer of booleans, integers or floating point numbers in native byte order.");
+  }
+
+  return true;
+}
+
+bool read_buffer(PyObject* py_obj, vector<double>& result)
+{
+  return read_buffer_impl(py_obj, result);
+}
+
+bool read_buffer(PyObject* py_obj, vector<bool>& result)
+{
+  return read_buffer_impl(py_obj, result);
+}
+
+bool read_buffer(PyObject* py_obj, vector<size_t>& result)
+{
+  return read_buffer_impl(py_obj, result);
+}
+
+#else
+
+// Without the buffer protocol, sequences other than lists (such as NumPy
+// arrays) are read element by element, since callers only handle lists.
+static bool read_item(PyObject* py_item, double& value)
+{
+  value = PyFloat_AsDouble(py_item);
+  return !(value == -1.0 && PyErr_Occurred());
+}
+
+static bool read_item(PyObject* py_item, bool& value)
+{
+  int is_true = PyObject_IsTrue(py_item);
+  value = (is_true == 1);
+  return is_true >= 0;
+}
+
+static bool read_item(PyObject* py_item, size_t& value)
+{
+  PyObject* py_index = PyNumber_Index(py_item);
+  if (py_index == NULL)
+    return false;
+  value = PyLong_AsSize_t(py_index);
+  Py_DECREF(py_index);
+  return !(value == (size_t)-1 && PyErr_Occurred());
+}
+
+template <class T>
+static bool read_sequence(PyObject* py_obj, vector<T>& result)
+{
+  if (PyList_Check(py_obj) || !PySequence_Check(py_obj))
+    return false;
+
+  Py_ssize_t n = PySequence_Size(py_obj);
+  if (n < 0)
+  {
+    PyErr_Clear();
+    throw Exception("Could not read sequence.");
+  }
+
+  result.resize(n);
+  for (Py_ssize_t i = 0; i < n; i++)
+  {
+    PyObject* py_item = PySequence_GetItem(py_obj, i);
+    T value = T();
+    bool is_read = (py_item != NULL && read_item(py_item, value));
+    Py_XDECREF(py_item);
+    if (!is_read)
+    {
+      PyErr_Clear();
+      throw Exception("Expected numerical values in sequence.");
+    }
+    result[i] = value;
+  }
+  return true;
+}
+
+bool read_buffer(PyObject* py_obj, vector<double>& result)
+{
+  return read_sequence(py_obj, result);
+}
+
+bool read_buffer(PyObject* py_obj, vector<bool>& result)
+{
+  return read_sequence(py_obj, result);
+}
+
+bool read_buffer(PyObject* py_obj, vector<size_t>& result)
+{
+  return read_sequence(py_obj, result);
+}
+
+#endif
+
+/*****************************************************************************
+  The values are copied once into a bytearray, which the memoryview then
+  exposes without further copies. Since memoryview and bytearray are part of
+  the limited API, this does not depend on LEIDENALG_HAS_BUFFER_PROTOCOL.
+*****************************************************************************/
+static PyObject* create_buffer(const void* data, size_t n_bytes, const char* format)
+{
+  PyObject* py_bytes = PyByteArray_FromStringAndSize(NULL, n_bytes);
+  if (py_bytes == NULL)
+    return NULL;
+  if (n_bytes > 0)
+    memcpy(PyByteArray_AsString(py_bytes), data, n_bytes);
+
+  PyObject* py_view = PyMemoryView_FromObject(py_bytes);
+  Py_DECREF(py_bytes);
+  if (py_view == NULL)
+    return NULL;
+
+  PyObject* py_result = PyObject_CallMethod(py_view, "cast", "s", format);
+  Py_DECREF(py_view);
+  return py_result;
+}
+
+PyObject* create_buffer(vector<size_t> const& values)
+{
+  const char* format = "N";
+  if (sizeof(size_t) == sizeof(unsigned long long))
+    format = "Q";
+  else if (sizeof(size_t) == sizeof(unsigned int))
+    format = "I";
+  return create_buffer(values.data(), values.size()*sizeof(size_t), format);
+}
+
+PyObject* create_buffer(vector<double> const& values)
+{
+  return create_buffer(values.data(), values.size()*sizeof(double), "d");
+}
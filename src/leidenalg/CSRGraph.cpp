@@ -0,0 +1,99 @@
+#include "CSRGraph.h"
+
+#include <algorithm>
+#include <limits>
+
+/*****************************************************************************
+  Build the layout with a counting sort of the edges on their end points, so
+  that neighbours are listed in order of the edge identifiers for each node.
+*****************************************************************************/
+template <class Index, class Weight>
+BasicCSRGraph<Index, Weight>::BasicCSRGraph(Graph* graph, igraph_neimode_t mode)
+{
+  size_t n = graph->vcount();
+  size_t m = graph->ecount();
+  const igraph_t* g = graph->get_igraph();
+
+  if (!BasicCSRGraph<Index, Weight>::fits(graph))
+    throw Exception("Graph cannot be represented by a compact layout: too many nodes, or edge weights that are not exact.");
+
+  // For undirected graphs all modes are equivalent
+  if (!graph->is_directed())
+    mode = IGRAPH_ALL;
+  this->_mode = mode;
+
+  bool use_out = (mode == IGRAPH_OUT || mode == IGRAPH_ALL);
+  bool use_in = (mode == IGRAPH_IN || mode == IGRAPH_ALL);
+
+  this->_offsets.assign(n + 1, 0);
+  for (size_t e = 0; e < m; e++)
+  {
+    if (use_out)
+      this->_offsets[IGRAPH_FROM(g, e) + 1] += 1;
+    if (use_in)
+      this->_offsets[IGRAPH_TO(g, e) + 1] += 1;
+  }
+  this->_max_degree = 0;
+  for (size_t v = 0; v < n; v++)
+  {
+    this->_max_degree = std::max(this->_max_degree, this->_offsets[v + 1]);
+    this->_offsets[v + 1] += this->_offsets[v];
+  }
+
+  this->_neighbours.resize(this->_offsets[n]);
+  vector<size_t> position(this->_offsets.begin(), this->_offsets.end() - 1);
+  for (size_t e = 0; e < m; e++)
+  {
+    size_t from = IGRAPH_FROM(g, e);
+    size_t to = IGRAPH_TO(g, e);
+    Weight w = (Weight)graph->edge_weight(e);
+
+    if (use_out)
+    {
+      Neighbour& neighbour = this->_neighbours[position[from]++];
+      neighbour.node = (Index)to;
+      neighbour.weight = w;
+    }
+    if (use_in)
+    {
+      Neighbour& neighbour = this->_neighbours[position[to]++];
+      neighbour.node = (Index)from;
+      neighbour.weight = w;
+    }
+  }
+}
+
+template <class Index, class Weight>
+size_t BasicCSRGraph<Index, Weight>::memory_usage() const
+{
+  return this->_offsets.capacity()*sizeof(size_t) +
+         this->_neighbours.capacity()*sizeof(Neighbour);
+}
+
+/*****************************************************************************
+  Check that all node ids fit in Index and that converting the edge weights to
+  Weight does not change them.
+*****************************************************************************/
+template <class Index, class Weight>
+bool BasicCSRGraph<Index, Weight>::fits(Graph* graph)
+{
+  size_t n = graph->vcount();
+  if (n > 0 && n - 1 > (size_t)std::numeric_limits<Index>::max())
+    return false;
+
+  if (sizeof(Weight) < sizeof(double) && graph->is_weighted())
+  {
+    size_t m = graph->ecount();
+    for (size_t e = 0; e < m; e++)
+    {
+      double w = graph->edge_weight(e);
+      if ((double)(Weight)w != w)
+        return false;
+    }
+  }
+  return true;
+}
+
+template class BasicCSRGraph<size_t, double>;
+template class BasicCSRGraph<uint32_t, double>;
+template class BasicCSRGraph<uint32_t, float>;
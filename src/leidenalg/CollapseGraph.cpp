@@ -0,0 +1,167 @@
+#include "CollapseGraph.h"
+
+#include "ParallelHelper.h"
+#include "SparseAccumulator.h"
+
+/*****************************************************************************
+  List the edges from each node (for undirected graphs, the edges for which
+  the node is the first end point), ordered by the other end point, as
+  igraph_incident does. This uses two stable counting sorts, first on the
+  other end point and then on the node itself.
+*****************************************************************************/
+static void out_edges(const igraph_t* g, size_t n, size_t m, AggregationArena& arena)
+{
+  vector<size_t>& offsets = arena.edge_offsets;
+  vector<size_t>& to_offsets = arena.position;
+  to_offsets.assign(n + 1, 0);
+  offsets.assign(n + 1, 0);
+  for (size_t e = 0; e < m; e++)
+  {
+    to_offsets[IGRAPH_TO(g, e) + 1] += 1;
+    offsets[IGRAPH_FROM(g, e) + 1] += 1;
+  }
+  for (size_t v = 0; v < n; v++)
+  {
+    to_offsets[v + 1] += to_offsets[v];
+    offsets[v + 1] += offsets[v];
+  }
+
+  arena.edges_by_to.resize(m);
+  for (size_t e = 0; e < m; e++)
+    arena.edges_by_to[to_offsets[IGRAPH_TO(g, e)]++] = e;
+
+  arena.edges.resize(m);
+  vector<size_t>& position = arena.position;
+  position.assign(offsets.begin(), offsets.end() - 1);
+  for (size_t e : arena.edges_by_to)
+    arena.edges[position[IGRAPH_FROM(g, e)]++] = e;
+}
+
+Graph* collapse_graph(Graph* graph, MutableVertexPartition* partition, size_t n_threads)
+{
+  AggregationArena arena;
+  return collapse_graph(graph, partition, n_threads, arena);
+}
+
+Graph* collapse_graph(Graph* graph, MutableVertexPartition* partition, size_t n_threads, AggregationArena& arena)
+{
+  const igraph_t* g = graph->get_igraph();
+  size_t n = graph->vcount();
+  size_t m = graph->ecount();
+  size_t n_collapsed = partition->n_communities();
+  vector<size_t> const& membership = partition->get_membership();
+
+  out_edges(g, n, m, arena);
+  vector<size_t> const& edge_offsets = arena.edge_offsets;
+  vector<size_t> const& edges = arena.edges;
+
+  // Nodes of each community, in increasing order
+  vector<size_t>& comm_offsets = arena.comm_offsets;
+  comm_offsets.assign(n_collapsed + 1, 0);
+  for (size_t v = 0; v < n; v++)
+    comm_offsets[membership[v] + 1] += 1;
+  for (size_t c = 0; c < n_collapsed; c++)
+    comm_offsets[c + 1] += comm_offsets[c];
+  vector<size_t>& comm_nodes = arena.comm_nodes;
+  comm_nodes.resize(n);
+  vector<size_t>& position = arena.position;
+  position.assign(comm_offsets.begin(), comm_offsets.end() - 1);
+  for (size_t v = 0; v < n; v++)
+    comm_nodes[position[membership[v]]++] = v;
+
+  // Split the communities in blocks with roughly the same number of edges
+  if (n_threads < 1)
+    n_threads = 1;
+  size_t n_blocks = std::min(n_threads, std::max(n_collapsed, (size_t)1));
+  vector<size_t>& block_begin = arena.block_begin;
+  block_begin.assign(n_blocks + 1, n_collapsed);
+  block_begin[0] = 0;
+  size_t block = 1;
+  size_t n_edges_seen = 0;
+  for (size_t c = 0; c < n_collapsed && block < n_blocks; c++)
+  {
+    if (n_edges_seen*n_blocks >= block*m)
+      block_begin[block++] = c;
+    for (size_t idx = comm_offsets[c]; idx < comm_offsets[c + 1]; idx++)
+    {
+      size_t v = comm_nodes[idx];
+      n_edges_seen += edge_offsets[v + 1] - edge_offsets[v];
+    }
+  }
+
+  // Keep the buffers of blocks that are not used now for later calls
+  if (arena.block_edges.size() < n_blocks)
+  {
+    arena.block_edges.resize(n_blocks);
+    arena.block_weights.resize(n_blocks);
+    arena.weight_to_comm.resize(n_blocks);
+  }
+  parallel_for(n_blocks, n_threads, [&](size_t block, size_t)
+  {
+    SparseAccumulator& weight_to_comm = arena.weight_to_comm[block];
+    weight_to_comm.reserve(n_collapsed, 0);
+    vector<igraph_integer_t>& collapsed_edges = arena.block_edges[block];
+    vector<double>& collapsed_weights = arena.block_weights[block];
+    collapsed_edges.clear();
+    collapsed_weights.clear();
+
+    for (size_t c = block_begin[block]; c < block_begin[block + 1]; c++)
+    {
+      for (size_t idx = comm_offsets[c]; idx < comm_offsets[c + 1]; idx++)
+      {
+        size_t v = comm_nodes[idx];
+        for (size_t pos = edge_offsets[v]; pos < edge_offsets[v + 1]; pos++)
+        {
+          size_t e = edges[pos];
+          weight_to_comm.add(membership[IGRAPH_TO(g, e)], graph->edge_weight(e));
+        }
+      }
+
+      for (size_t d : weight_to_comm.touched())
+      {
+        collapsed_edges.push_back(c);
+        collapsed_edges.push_back(d);
+        collapsed_weights.push_back(weight_to_comm.get(d));
+      }
+      weight_to_comm.clear();
+    }
+  });
+
+  // Concatenate the blocks
+  vector<size_t>& block_offsets = arena.block_offsets;
+  block_offsets.assign(n_blocks + 1, 0);
+  for (size_t block = 0; block < n_blocks; block++)
+    block_offsets[block + 1] = block_offsets[block] + arena.block_weights[block].size();
+  size_t m_collapsed = block_offsets[n_blocks];
+
+  igraph_vector_int_t* collapsed_edges = &arena.collapsed_edges;
+  igraph_vector_int_resize(collapsed_edges, 2*m_collapsed);
+  vector<double>& collapsed_weights = arena.collapsed_weights;
+  collapsed_weights.resize(m_collapsed);
+  parallel_for(n_blocks, n_threads, [&](size_t block, size_t)
+  {
+    std::copy(arena.block_edges[block].begin(), arena.block_edges[block].end(),
+              VECTOR(*collapsed_edges) + 2*block_offsets[block]);
+    std::copy(arena.block_weights[block].begin(), arena.block_weights[block].end(),
+              collapsed_weights.begin() + block_offsets[block]);
+  });
+
+  igraph_t* collapsed_graph = new igraph_t();
+  igraph_create(collapsed_graph, collapsed_edges, n_collapsed, graph->is_directed());
+
+  vector<double>& csizes = arena.csizes;
+  csizes.resize(n_collapsed);
+  for (size_t c = 0; c < n_collapsed; c++)
+    csizes[c] = partition->csize(c);
+
+  arena.account();
+  return new Graph(collapsed_graph, collapsed_weights, csizes, graph->correct_self_loops());
+}
+
+void delete_collapsed_graph(Graph* graph)
+{
+  igraph_t* g = (igraph_t*)graph->get_igraph();
+  delete graph;
+  igraph_destroy(g);
+  delete g;
+}
@@ -0,0 +1,71 @@
+#include "Consensus.h"
+
+#include "NativeGraph.h"
+#include "ParallelHelper.h"
+
+vector<double> agreement_weights(Graph* graph, vector< vector<size_t> > const& memberships, size_t n_threads)
+{
+  size_t n = graph->vcount();
+  size_t m = graph->ecount();
+  size_t k = memberships.size();
+
+  if (k == 0)
+    throw Exception("At least one membership is required.");
+  for (vector<size_t> const& membership : memberships)
+    if (membership.size() != n)
+      throw Exception("Membership vector not the same size as the number of nodes.");
+
+  igraph_t const* g = graph->get_igraph();
+  vector<double> agreement(m);
+  size_t block_size = (m + std::max((size_t)1, n_threads) - 1)/std::max((size_t)1, n_threads);
+  parallel_for(n_threads, n_threads, [&](size_t thread, size_t)
+  {
+    size_t begin = std::min(m, thread*block_size);
+    size_t end = std::min(m, begin + block_size);
+    for (size_t e = begin; e < end; e++)
+    {
+      size_t v = IGRAPH_FROM(g, e);
+      size_t u = IGRAPH_TO(g, e);
+      size_t n_agree = 0;
+      for (vector<size_t> const& membership : memberships)
+        if (membership[v] == membership[u])
+          n_agree += 1;
+      agreement[e] = (double)n_agree/k;
+    }
+  });
+  return agreement;
+}
+
+Graph* create_consensus_graph(Graph* graph, vector<double> const& agreement, double threshold)
+{
+  size_t n = graph->vcount();
+  size_t m = graph->ecount();
+  if (agreement.size() != m)
+    throw Exception("Agreement vector not the same size as the number of edges.");
+
+  igraph_t const* g = graph->get_igraph();
+  vector<size_t> from, to;
+  vector<double> weights;
+  for (size_t e = 0; e < m; e++)
+  {
+    if (agreement[e] <= threshold)
+      continue;
+    from.push_back(IGRAPH_FROM(g, e));
+    to.push_back(IGRAPH_TO(g, e));
+    weights.push_back(agreement[e]);
+  }
+
+  vector<double> node_sizes(n);
+  for (size_t v = 0; v < n; v++)
+    node_sizes[v] = graph->node_size(v);
+
+  return create_graph_from_edges(n, from, to, weights, node_sizes, graph->is_directed(), graph->correct_self_loops());
+}
+
+bool is_agreement_stable(vector<double> const& agreement)
+{
+  for (double weight : agreement)
+    if (weight != 0.0 && weight != 1.0)
+      return false;
+  return true;
+}
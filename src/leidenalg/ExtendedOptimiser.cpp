@@ -0,0 +1,2242 @@
+#include "ExtendedOptimiser.h"
+
+#include <atomic>
+#include <cmath>
+#include <ctime>
+#include <set>
+#include <typeinfo>
+
+#include <libleidenalg/CPMVertexPartition.h>
+#include <libleidenalg/ModularityVertexPartition.h>
+#include <libleidenalg/RBConfigurationVertexPartition.h>
+#include <libleidenalg/RBERVertexPartition.h>
+#include <libleidenalg/SignificanceVertexPartition.h>
+
+#include "Consensus.h"
+#include "NativeGraph.h"
+
+ExtendedOptimiser::ExtendedOptimiser() : Optimiser()
+{
+  this->n_threads = 1;
+  this->batch_size = 256;
+  this->use_queue = false;
+
+  this->n_visits = 0;
+  this->n_moves = 0;
+  this->n_diff_moves = 0;
+  this->n_scratch_allocations = 0;
+  this->specialise_diff_move = true;
+  this->compact_indices = false;
+  this->check_interval = 1000;
+  this->profiling = false;
+
+  this->replicated_graph = NULL;
+  this->keep_replica_graphs = false;
+  this->neighbourhoods_graph = NULL;
+  this->neighbourhoods = NULL;
+  this->keep_neighbourhoods = false;
+
+  igraph_rng_init(&rng, &igraph_rngtype_mt19937);
+  igraph_rng_seed(&rng, time(NULL));
+}
+
+ExtendedOptimiser::~ExtendedOptimiser()
+{
+  this->delete_replica_graphs();
+  this->delete_neighbourhoods();
+  igraph_rng_destroy(&rng);
+}
+
+void ExtendedOptimiser::set_rng_seed(size_t seed)
+{
+  Optimiser::set_rng_seed(seed);
+  igraph_rng_seed(&rng, seed);
+}
+
+uint64_t ExtendedOptimiser::random_seed()
+{
+  uint64_t high = (uint64_t)igraph_rng_get_integer(&rng, 0, 0x7FFFFFFF);
+  uint64_t low = (uint64_t)igraph_rng_get_integer(&rng, 0, 0x7FFFFFFF);
+  return (high << 32) ^ low;
+}
+
+void ExtendedOptimiser::shuffle(vector<size_t>& v)
+{
+  size_t n = v.size();
+  if (n < 2)
+    return;
+
+  for (size_t idx = n - 1; idx > 0; idx--)
+  {
+    size_t rand_idx = get_random_int(0, idx, &rng);
+    std::swap(v[idx], v[rand_idx]);
+  }
+}
+
+/*****************************************************************************
+  Create a copy of the administration of a graph.
+
+  The copy refers to the same igraph_t, which is only read, so that the copy can
+  be used concurrently with the original graph.
+*****************************************************************************/
+static Graph* replicate_graph(Graph* graph)
+{
+  size_t n = graph->vcount();
+  size_t m = graph->ecount();
+
+  vector<double> edge_weights(m);
+  for (size_t e = 0; e < m; e++)
+    edge_weights[e] = graph->edge_weight(e);
+
+  vector<double> node_sizes(n);
+  vector<double> node_self_weights(n);
+  for (size_t v = 0; v < n; v++)
+  {
+    node_sizes[v] = graph->node_size(v);
+    node_self_weights[v] = graph->node_self_weight(v);
+  }
+
+  return new Graph((igraph_t*)graph->get_igraph(),
+                   edge_weights, node_sizes, node_self_weights,
+                   graph->correct_self_loops());
+}
+
+/*****************************************************************************
+  Make sure that replica_graphs holds at least n_replicas replicas of graph,
+  created in parallel. Replicas of another graph are deleted first. The
+  replicas are kept until delete_replica_graphs is called, so that moving
+  nodes and refining on the same graph (in optimise_partition, all calls on
+  one level) only replicate the graph once. Since replicas are identified by
+  the address of the graph, they should be deleted before that graph is.
+*****************************************************************************/
+void ExtendedOptimiser::replicate_graphs(Graph* graph, size_t n_replicas)
+{
+  if (this->replicated_graph != graph)
+  {
+    this->delete_replica_graphs();
+    this->replicated_graph = graph;
+  }
+
+  size_t n_existing = this->replica_graphs.size();
+  if (n_existing >= n_replicas)
+    return;
+
+  this->replica_graphs.resize(n_replicas, NULL);
+  parallel_for(n_replicas - n_existing, n_replicas - n_existing, [&](size_t idx, size_t)
+  {
+    this->replica_graphs[n_existing + idx] = replicate_graph(graph);
+  });
+}
+
+void ExtendedOptimiser::delete_replica_graphs()
+{
+  for (Graph* replica_graph : this->replica_graphs)
+    delete replica_graph;
+  this->replica_graphs.clear();
+  this->replicated_graph = NULL;
+}
+
+/*****************************************************************************
+  CSR layouts of a graph. For directed graphs, the out- and in-neighbours are
+  also kept separately, for accumulating the weights to and from communities.
+  CSR is one of the layouts of CSRGraph.h.
+*****************************************************************************/
+template <class CSR>
+struct CSRNeighbourhoods
+{
+  CSRNeighbourhoods(Graph* graph) : is_directed(graph->is_directed()), all(graph, IGRAPH_ALL)
+  {
+    if (this->is_directed)
+    {
+      this->out = CSR(graph, IGRAPH_OUT);
+      this->in = CSR(graph, IGRAPH_IN);
+    }
+  };
+
+  inline CSR const& out_graph() const { return this->is_directed ? this->out : this->all; };
+  inline CSR const& in_graph() const { return this->is_directed ? this->in : this->all; };
+
+  bool is_directed;
+  CSR all;
+  CSR out;
+  CSR in;
+};
+
+/*****************************************************************************
+  Return the CSR layout of graph that is used by is_locally_optimal, building
+  it unless it was kept for the same graph. As for the replicas of a graph, it
+  is identified by the address of the graph, so it should be deleted before
+  that graph is.
+*****************************************************************************/
+CSRNeighbourhoods<CSRGraph> const& ExtendedOptimiser::build_neighbourhoods(Graph* graph)
+{
+  if (this->neighbourhoods_graph != graph)
+  {
+    this->delete_neighbourhoods();
+    this->neighbourhoods = new CSRNeighbourhoods<CSRGraph>(graph);
+    this->neighbourhoods_graph = graph;
+  }
+  return *this->neighbourhoods;
+}
+
+void ExtendedOptimiser::delete_neighbourhoods()
+{
+  delete this->neighbourhoods;
+  this->neighbourhoods = NULL;
+  this->neighbourhoods_graph = NULL;
+}
+
+/*****************************************************************************
+  Select the CSR layout for the graph. Unless compact_indices is set, the
+  layout with size_t ids and double weights is used. Otherwise, float weights
+  are used if they represent all edge weights exactly, and 32-bit ids if all
+  node ids fit. Graphs that are too large for 32-bit ids use the full layout.
+
+  The full layout takes 16 bytes per neighbour, 32-bit ids take 12 bytes and
+  float weights 8 bytes, which reduces the memory traffic when visiting nodes.
+  Weights are still accumulated as double, so the results are exactly the
+  same. The Graph and partitions themselves are part of libleidenalg and
+  always use size_t and double.
+*****************************************************************************/
+ExtendedOptimiser::CSRLayout ExtendedOptimiser::csr_layout(Graph* graph) const
+{
+  if (!this->compact_indices)
+    return FULL_CSR;
+  else if (CompactFloatCSRGraph::fits(graph))
+    return COMPACT_FLOAT_CSR;
+  else if (CompactCSRGraph::fits(graph))
+    return COMPACT_CSR;
+  return FULL_CSR;
+}
+
+/*****************************************************************************
+  Determine the best community for node v, in the same way as move_nodes does.
+
+  Random choices are derived from the seed and the node only. The community is
+  returned in best_comm. If the best move is to an empty community,
+  is_empty_comm is set to true, since the identifier of the empty community
+  may differ between partitions. Returns the improvement of the move, which is
+  zero if the node should stay in its current community.
+
+  The candidate communities, including the empty community, are scored using
+  a single call to diff_moves, of a BatchDiffMove or of a specialised
+  StaticLinearBatchDiffMove, which for the linear quality functions does not
+  call diff_move of the partition. The neighbours in scratch should be
+  computed for v on the same partition, and csr should contain all
+  neighbours. The buffers in scratch should be large enough for all
+  candidates, so that no memory is allocated.
+*****************************************************************************/
+template <class DiffMoves, class CSR>
+static double propose_move(MutableVertexPartition* partition, size_t v,
+                           CSR const& csr,
+                           DiffMoves* batch_diff_move, MoveScratch& scratch,
+                           int consider_comms, int consider_empty_community,
+                           size_t max_comm_size, uint64_t seed,
+                           size_t& best_comm, bool& is_empty_comm)
+{
+  Graph* graph = partition->get_graph();
+  size_t v_comm = partition->membership(v);
+  double v_size = graph->node_size(v);
+
+  vector<size_t>& comms = scratch.comms;
+  comms.clear();
+
+  auto add_candidate = [&](size_t comm)
+  {
+    if (comm == v_comm)
+      return;
+    if (max_comm_size > 0 && max_comm_size < partition->csize(comm) + v_size)
+      return;
+    comms.push_back(comm);
+  };
+
+  if (consider_comms == Optimiser::ALL_COMMS)
+  {
+    for (size_t comm = 0; comm < partition->n_communities(); comm++)
+      add_candidate(comm);
+  }
+  else if (consider_comms == Optimiser::ALL_NEIGH_COMMS)
+  {
+    for (size_t comm : scratch.neighbours.comms())
+      add_candidate(comm);
+  }
+  else if (consider_comms == Optimiser::RAND_COMM)
+  {
+    // Community of a random node, i.e. proportional to the number of nodes
+    add_candidate(partition->membership(random_index(seed, v, graph->vcount())));
+  }
+  else if (consider_comms == Optimiser::RAND_NEIGH_COMM)
+  {
+    // Community of a random neighbour, i.e. proportional to the number of neighbours
+    typename CSR::NeighbourSpan neighbours = csr.neighbours(v);
+    if (!neighbours.empty())
+      add_candidate(partition->membership(neighbours[random_index(seed, v, neighbours.size())].node));
+  }
+
+  // The empty community is always the last candidate
+  size_t n_neigh_candidates = comms.size();
+  if (consider_empty_community && partition->cnodes(v_comm) > 1)
+    comms.push_back(partition->get_empty_community());
+
+  best_comm = v_comm;
+  is_empty_comm = false;
+  double max_improv = (0.0 < max_comm_size && max_comm_size < partition->csize(v_comm)) ? -INFINITY : 0.0;
+
+  if (comms.empty())
+    return 0.0;
+
+  batch_diff_move->diff_moves(v, scratch.neighbours, comms.data(), comms.size(), scratch.diffs.data());
+  scratch.n_diff_moves += comms.size();
+
+  for (size_t idx = 0; idx < comms.size(); idx++)
+  {
+    if (scratch.diffs[idx] > max_improv)
+    {
+      best_comm = comms[idx];
+      is_empty_comm = (idx == n_neigh_candidates);
+      max_improv = scratch.diffs[idx];
+    }
+  }
+
+  return best_comm != v_comm ? max_improv : 0.0;
+}
+
+/*****************************************************************************
+  Make sure that there are n_threads scratch buffers, which are large enough
+  for the partition. Allocations are counted in n_scratch_allocations.
+
+  The queue-based and multi-threaded routines keep all buffers that are used
+  when visiting a node (see MoveScratch) in the optimiser, so that they are
+  sized once per call and reused between calls. Visiting a node hence does
+  not allocate memory; only moving a node calls move_node of libleidenalg.
+  tests/test_allocations.cpp counts the actual allocations when visiting
+  nodes.
+*****************************************************************************/
+void ExtendedOptimiser::reserve_scratch(size_t n_threads, MutableVertexPartition* partition, size_t max_degree, int consider_comms)
+{
+  Graph* graph = partition->get_graph();
+  size_t n = graph->vcount();
+  size_t n_communities = std::max(n, partition->n_communities());
+
+  // Candidates are neighbour communities plus the empty community, or all communities.
+  size_t max_candidates = std::min(max_degree, n_communities) + 1;
+  if (consider_comms == Optimiser::ALL_COMMS)
+    max_candidates = n_communities + 1;
+
+  if (this->scratch.size() < n_threads)
+  {
+    this->scratch.resize(n_threads);
+    this->n_scratch_allocations += 1;
+  }
+  for (size_t thread = 0; thread < n_threads; thread++)
+    if (this->scratch[thread].reserve(n_communities, max_degree, max_candidates, graph->is_directed()))
+      this->n_scratch_allocations += 1;
+}
+
+/*****************************************************************************
+  Add the moves that were evaluated using the scratch buffers to n_diff_moves.
+*****************************************************************************/
+void ExtendedOptimiser::collect_diff_moves()
+{
+  for (MoveScratch& scratch : this->scratch)
+  {
+    this->n_diff_moves += scratch.n_diff_moves;
+    scratch.n_diff_moves = 0;
+  }
+}
+
+static size_t count_nonempty_communities(MutableVertexPartition* partition)
+{
+  size_t n_communities = 0;
+  for (size_t comm = 0; comm < partition->n_communities(); comm++)
+    if (partition->cnodes(comm) > 0)
+      n_communities += 1;
+  return n_communities;
+}
+
+/*****************************************************************************
+  Whether diff_move only depends on the communities involved in the move (and
+  on constants of the graph). This holds for all quality functions except
+  Surprise, which depends on the totals over all communities.
+*****************************************************************************/
+static bool has_local_diff_move(MutableVertexPartition* partition)
+{
+  return dynamic_cast<ModularityVertexPartition*>(partition) ||
+         dynamic_cast<RBConfigurationVertexPartition*>(partition) ||
+         dynamic_cast<RBERVertexPartition*>(partition) ||
+         dynamic_cast<CPMVertexPartition*>(partition) ||
+         dynamic_cast<SignificanceVertexPartition*>(partition);
+}
+
+double ExtendedOptimiser::optimise_partition(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed)
+{
+  return this->optimise_partition(partition, is_membership_fixed, this->max_comm_size);
+}
+
+/*****************************************************************************
+  Optimise a single partition.
+
+  This follows the implementation of libleidenalg for a single layer, except
+  that moving nodes uses the queue-based or multi-threaded move_nodes, the
+  refinement uses refine_parallel (see refines_in_parallel), and the graph is
+  aggregated using multiple threads (see collapse_graph). If neither use_queue
+  nor n_threads > 1 is set, libleidenalg is called directly. The replicas of
+  the graph of every level are kept while optimising, so that moving nodes
+  and refining share them, and are deleted afterwards. The buffers for
+  aggregating the graph are kept in arena, which only grows when a larger
+  graph is aggregated than before.
+
+  The deadline is checked after moving nodes on every level, before
+  aggregating further, and every check_interval node visits while moving
+  nodes and refining. All moves made until then are kept, so that the
+  partition is the best one found so far. libleidenalg itself can only be
+  stopped between calls. Whether a call stopped early is available from
+  deadline.has_expired(); the optimiser never resets its deadline itself.
+
+  With profiling set, a LevelProfile is appended to profile for every level:
+  the wall time of moving nodes, refining and aggregating, the node visits,
+  moves and evaluated moves, the number of communities before and after
+  moving nodes, and the size of the aggregate graph. The clock is only read
+  while profiling. Moves that libleidenalg evaluates, for example in the
+  serial refinement, are not counted.
+*****************************************************************************/
+double ExtendedOptimiser::optimise_partition(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, size_t max_comm_size)
+{
+  if (this->deadline.expired())
+    return 0.0;
+
+  if (this->n_threads <= 1 && !this->use_queue)
+    return Optimiser::optimise_partition(partition, is_membership_fixed, max_comm_size);
+
+  double improv = 0.0;
+  this->keep_replica_graphs = true;
+  try
+  {
+    improv = this->optimise_levels(partition, is_membership_fixed, max_comm_size);
+  }
+  catch (...)
+  {
+    this->keep_replica_graphs = false;
+    this->delete_replica_graphs();
+    throw;
+  }
+  this->keep_replica_graphs = false;
+  this->delete_replica_graphs();
+
+  return improv;
+}
+
+double ExtendedOptimiser::optimise_levels(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, size_t max_comm_size)
+{
+  Graph* graph = partition->get_graph();
+  size_t n = graph->vcount();
+
+  if (is_membership_fixed.size() != n)
+    throw Exception("Node fixed vector not same size as number of nodes.");
+
+  // Fixed nodes keep the identifier of their original community
+  vector<size_t> fixed_nodes;
+  vector<size_t> fixed_membership(n);
+  for (size_t v = 0; v < n; v++)
+  {
+    if (is_membership_fixed[v])
+    {
+      fixed_nodes.push_back(v);
+      fixed_membership[v] = partition->membership(v);
+    }
+  }
+
+  Graph* collapsed_graph = graph;
+  MutableVertexPartition* collapsed_partition = partition;
+  vector<bool> is_collapsed_membership_fixed(is_membership_fixed);
+
+  // Aggregate node of each individual node
+  vector<size_t> aggregate_node_per_individual_node(n);
+  for (size_t v = 0; v < n; v++)
+    aggregate_node_per_individual_node[v] = v;
+
+  bool aggregate_further = true;
+  double improv = 0.0;
+  size_t level = 0;
+  do
+  {
+    #ifdef DEBUG
+      cerr << "Optimising partition on graph with " << collapsed_graph->vcount() << " nodes using " << this->n_threads << " threads." << endl;
+    #endif
+
+    // The profile is added up front, so that it is kept if the deadline expires
+    LevelProfile* level_profile = NULL;
+    LevelProfile::clock::time_point start;
+    if (this->profiling)
+    {
+      this->profile.push_back(LevelProfile());
+      level_profile = &this->profile.back();
+      level_profile->level = level;
+      level_profile->n_nodes = collapsed_graph->vcount();
+      level_profile->n_edges = collapsed_graph->ecount();
+      level_profile->n_communities_before = count_nonempty_communities(collapsed_partition);
+      level_profile->n_visits = this->n_visits;
+      level_profile->n_moves = this->n_moves;
+      level_profile->n_diff_moves = this->n_diff_moves;
+      start = LevelProfile::clock::now();
+    }
+
+    if (this->optimise_routine == Optimiser::MOVE_NODES)
+      improv += this->move_nodes(collapsed_partition, is_collapsed_membership_fixed, this->consider_comms, false, max_comm_size);
+    else if (this->optimise_routine == Optimiser::MERGE_NODES)
+      improv += this->merge_nodes(collapsed_partition, is_collapsed_membership_fixed, this->consider_comms, false, max_comm_size);
+
+    if (level_profile != NULL)
+    {
+      level_profile->move_time = LevelProfile::seconds_since(start);
+      level_profile->n_communities_after = count_nonempty_communities(collapsed_partition);
+      level_profile->n_visits = this->n_visits - level_profile->n_visits;
+      level_profile->n_moves = this->n_moves - level_profile->n_moves;
+      level_profile->n_diff_moves = this->n_diff_moves - level_profile->n_diff_moves;
+    }
+
+    // Make sure improvements on the collapsed graph are reflected in the original
+    if (collapsed_partition != partition)
+    {
+      if (this->refine_partition)
+        partition->from_coarse_partition(collapsed_partition, aggregate_node_per_individual_node);
+      else
+        partition->from_coarse_partition(collapsed_partition);
+    }
+
+    // Once the deadline expired, keep the partition found so far
+    if (this->deadline.expired())
+      break;
+
+    Graph* new_collapsed_graph = NULL;
+    MutableVertexPartition* new_collapsed_partition = NULL;
+    vector<bool> new_is_collapsed_membership_fixed;
+
+    if (this->refine_partition)
+    {
+      if (level_profile != NULL)
+        start = LevelProfile::clock::now();
+
+      // Refine the partition within the communities of the collapsed partition
+      MutableVertexPartition* sub_collapsed_partition = collapsed_partition->create(collapsed_graph);
+
+      if (this->refine_routine == Optimiser::MOVE_NODES)
+        this->move_nodes_constrained(sub_collapsed_partition, this->refine_consider_comms, collapsed_partition, max_comm_size);
+      else if (this->refine_routine == Optimiser::MERGE_NODES)
+        this->merge_nodes_constrained(sub_collapsed_partition, this->refine_consider_comms, collapsed_partition, max_comm_size);
+
+      for (size_t v = 0; v < n; v++)
+        aggregate_node_per_individual_node[v] = sub_collapsed_partition->membership(aggregate_node_per_individual_node[v]);
+
+      if (level_profile != NULL)
+      {
+        level_profile->refine_time = LevelProfile::seconds_since(start);
+        start = LevelProfile::clock::now();
+      }
+
+      new_collapsed_graph = collapse_graph(collapsed_graph, sub_collapsed_partition, this->n_threads, this->arena);
+
+      // Each refined aggregate node starts in the community of the unrefined partition
+      vector<size_t>& new_collapsed_membership = this->arena.membership;
+      new_collapsed_membership.resize(new_collapsed_graph->vcount());
+      for (size_t v = 0; v < collapsed_graph->vcount(); v++)
+        new_collapsed_membership[sub_collapsed_partition->membership(v)] = collapsed_partition->membership(v);
+
+      new_collapsed_partition = collapsed_partition->create(new_collapsed_graph, new_collapsed_membership);
+      this->arena.account();
+
+      new_is_collapsed_membership_fixed.resize(new_collapsed_graph->vcount(), false);
+      for (size_t v : fixed_nodes)
+        new_is_collapsed_membership_fixed[aggregate_node_per_individual_node[v]] = true;
+
+      delete sub_collapsed_partition;
+    }
+    else
+    {
+      if (level_profile != NULL)
+        start = LevelProfile::clock::now();
+
+      new_collapsed_graph = collapse_graph(collapsed_graph, collapsed_partition, this->n_threads, this->arena);
+      new_collapsed_partition = collapsed_partition->create(new_collapsed_graph);
+
+      new_is_collapsed_membership_fixed.resize(new_collapsed_graph->vcount(), false);
+      for (size_t v : fixed_nodes)
+        new_is_collapsed_membership_fixed[partition->membership(v)] = true;
+    }
+
+    if (level_profile != NULL)
+    {
+      level_profile->collapse_time = LevelProfile::seconds_since(start);
+      level_profile->n_aggregate_nodes = new_collapsed_graph->vcount();
+      level_profile->n_aggregate_edges = new_collapsed_graph->ecount();
+    }
+
+    aggregate_further = (new_collapsed_graph->vcount() < collapsed_graph->vcount()) &&
+                        (collapsed_graph->vcount() > collapsed_partition->n_communities());
+
+    if (collapsed_partition != partition)
+      delete collapsed_partition;
+    this->delete_replica_graphs();
+    if (collapsed_graph != graph)
+      delete_collapsed_graph(collapsed_graph);
+
+    collapsed_partition = new_collapsed_partition;
+    collapsed_graph = new_collapsed_graph;
+    is_collapsed_membership_fixed = new_is_collapsed_membership_fixed;
+    level += 1;
+  } while (aggregate_further);
+
+  if (collapsed_partition != partition)
+    delete collapsed_partition;
+  this->delete_replica_graphs();
+  if (collapsed_graph != graph)
+    delete_collapsed_graph(collapsed_graph);
+
+  // Make sure the resulting communities are called 0,...,r-1, except for
+  // fixed nodes, which keep the numbers of their original communities.
+  partition->renumber_communities();
+  if (fixed_nodes.size() > 0)
+    partition->renumber_communities(fixed_nodes, fixed_membership);
+
+  return improv;
+}
+
+/*****************************************************************************
+  Optimise the partitions and store all levels in a compact hierarchy.
+
+  The levels are obtained from libleidenalg, and each level is converted and
+  deleted in turn, so that only the compact hierarchy remains afterwards.
+*****************************************************************************/
+double ExtendedOptimiser::optimise_partition_hierarchical(vector<MutableVertexPartition*> partitions, vector<double> layer_weights, vector<bool> const& is_membership_fixed, PartitionHierarchy& hierarchy)
+{
+  vector<MutableVertexPartition*> levels;
+  double q = Optimiser::optimise_partition_hierarchical(partitions, layer_weights, is_membership_fixed, levels);
+
+  hierarchy = PartitionHierarchy();
+  try
+  {
+    for (size_t level = 0; level < levels.size(); level++)
+    {
+      hierarchy.add_level(levels[level]->get_membership());
+      delete levels[level];
+      levels[level] = NULL;
+    }
+  }
+  catch (std::exception& e)
+  {
+    for (MutableVertexPartition* level : levels)
+      delete level;
+    throw;
+  }
+
+  return q;
+}
+
+/*****************************************************************************
+  Optimise the partition n_starts times independently, using n_threads
+  threads, and keep the best result.
+
+  Every run starts from the membership of partition, and optimises a new
+  partition of the same type, using its own optimiser with the settings of
+  this optimiser and its own seed, until n_iterations iterations were run or
+  (if n_iterations is negative) an iteration did not improve the partition.
+  Each thread uses its own replica of the graph for all its runs; the calling
+  thread uses the graph itself. All replicas share the igraph_t. The
+  membership of the best run (the first one in case of ties) is set in
+  partition, and its quality is returned. Since the seeds are drawn before
+  starting, the result is deterministic for a given seed and does not depend
+  on the number of threads, unless the deadline, which stops all runs,
+  expires.
+*****************************************************************************/
+double ExtendedOptimiser::optimise_ensemble(MutableVertexPartition* partition, size_t n_starts, size_t n_threads, int n_iterations, vector<EnsembleRun>& runs)
+{
+  return this->run_ensemble(partition, n_starts, n_threads, n_iterations, runs, NULL);
+}
+
+/*****************************************************************************
+  Optimise the partition n_starts times as in optimise_ensemble, and also
+  store the membership of every run in memberships, unless it is NULL.
+*****************************************************************************/
+double ExtendedOptimiser::run_ensemble(MutableVertexPartition* partition, size_t n_starts, size_t n_threads, int n_iterations, vector<EnsembleRun>& runs, vector< vector<size_t> >* memberships)
+{
+  if (n_starts == 0)
+    throw Exception("Number of starts should be positive.");
+
+  Graph* graph = partition->get_graph();
+  size_t n = graph->vcount();
+  n_threads = std::max((size_t)1, std::min(n_threads, n_starts));
+
+  // Seeds are drawn up front, so that they do not depend on the threads
+  runs.assign(n_starts, EnsembleRun());
+  for (EnsembleRun& run : runs)
+    run.seed = (size_t)this->random_seed();
+
+  vector<size_t> initial_membership = partition->get_membership();
+  vector<bool> is_membership_fixed(n, false);
+  if (memberships != NULL)
+    memberships->assign(n_starts, vector<size_t>());
+
+  // Best run of each thread and its membership
+  vector<size_t> best_runs(n_threads, n_starts);
+  vector< vector<size_t> > best_memberships(n_threads);
+  vector<Graph*> replica_graphs(n_threads, NULL);
+  replica_graphs[0] = graph;
+
+  try
+  {
+    parallel_for_dynamic(n_starts, n_threads, [&](size_t run_idx, size_t thread)
+    {
+      Deadline::clock::time_point start = Deadline::clock::now();
+      EnsembleRun& run = runs[run_idx];
+
+      if (replica_graphs[thread] == NULL)
+        replica_graphs[thread] = replicate_graph(graph);
+
+      ExtendedOptimiser optimiser;
+      this->copy_settings_to(&optimiser);
+      optimiser.set_rng_seed(run.seed);
+      optimiser.deadline.set_parent(&this->deadline);
+
+      MutableVertexPartition* run_partition = partition->create(replica_graphs[thread], initial_membership);
+      try
+      {
+        for (int itr = 0; itr < n_iterations || n_iterations < 0; itr++)
+        {
+          double improv = optimiser.optimise_partition(run_partition, is_membership_fixed);
+          run.n_iterations += 1;
+          if (optimiser.deadline.has_expired())
+          {
+            run.converged = false;
+            break;
+          }
+          run.converged = (improv <= 0);
+          if (n_iterations < 0 && run.converged)
+            break;
+        }
+        run.quality = run_partition->quality();
+        run.n_communities = count_nonempty_communities(run_partition);
+        if (memberships != NULL)
+          (*memberships)[run_idx] = run_partition->get_membership();
+
+        // Threads take runs in increasing order, so the first run wins ties
+        if (best_runs[thread] == n_starts || run.quality > runs[best_runs[thread]].quality)
+        {
+          best_runs[thread] = run_idx;
+          best_memberships[thread] = run_partition->get_membership();
+        }
+      }
+      catch (...)
+      {
+        delete run_partition;
+        throw;
+      }
+      delete run_partition;
+      run.time = std::chrono::duration<double>(Deadline::clock::now() - start).count();
+    });
+  }
+  catch (...)
+  {
+    for (size_t thread = 1; thread < n_threads; thread++)
+      delete replica_graphs[thread];
+    throw;
+  }
+  for (size_t thread = 1; thread < n_threads; thread++)
+    delete replica_graphs[thread];
+
+  size_t best_thread = n_threads;
+  for (size_t thread = 0; thread < n_threads; thread++)
+  {
+    size_t run_idx = best_runs[thread];
+    if (run_idx == n_starts)
+      continue;
+    if (best_thread == n_threads ||
+        runs[run_idx].quality > runs[best_runs[best_thread]].quality ||
+        (runs[run_idx].quality == runs[best_runs[best_thread]].quality && run_idx < best_runs[best_thread]))
+      best_thread = thread;
+  }
+
+  partition->set_membership(best_memberships[best_thread]);
+  return runs[best_runs[best_thread]].quality;
+}
+
+/*****************************************************************************
+  Find a consensus of the given memberships of the graph of partition.
+
+  As in consensus clustering (Lancichinetti and Fortunato), the agreement of
+  the memberships on every edge is computed, and the consensus graph with
+  these agreements as weights is partitioned again, as often as there are
+  memberships, using run_ensemble with partitions of the same type as
+  partition, whose quality function should hence support edge weights. This
+  is repeated with the new memberships until they agree on
+  every edge, for at most max_rounds rounds, or until the deadline expires.
+  Edges with an agreement of at most threshold are left out of the consensus
+  graph. Finally, the membership with the highest quality on the original
+  graph is set in partition, and its quality is returned. The agreement of
+  the final memberships is returned in agreement, and the number of rounds
+  in n_rounds.
+*****************************************************************************/
+double ExtendedOptimiser::optimise_consensus(MutableVertexPartition* partition, vector< vector<size_t> > memberships, size_t n_threads, size_t max_rounds, double threshold, vector<double>& agreement, size_t& n_rounds)
+{
+  Graph* graph = partition->get_graph();
+  size_t k = memberships.size();
+
+  n_rounds = 0;
+  agreement = agreement_weights(graph, memberships, n_threads);
+  while (!is_agreement_stable(agreement) && n_rounds < max_rounds && !this->deadline.expired())
+  {
+    Graph* consensus_graph = create_consensus_graph(graph, agreement, threshold);
+    MutableVertexPartition* consensus_partition = NULL;
+    vector<EnsembleRun> runs;
+    try
+    {
+      consensus_partition = partition->create(consensus_graph);
+      this->run_ensemble(consensus_partition, k, n_threads, -1, runs, &memberships);
+    }
+    catch (...)
+    {
+      delete consensus_partition;
+      delete_native_graph(consensus_graph);
+      throw;
+    }
+    delete consensus_partition;
+    delete_native_graph(consensus_graph);
+
+    n_rounds += 1;
+    agreement = agreement_weights(graph, memberships, n_threads);
+  }
+
+  size_t best = 0;
+  double best_quality = -INFINITY;
+  for (size_t idx = 0; idx < k; idx++)
+  {
+    partition->set_membership(memberships[idx]);
+    double quality = partition->quality();
+    if (quality > best_quality)
+    {
+      best = idx;
+      best_quality = quality;
+    }
+  }
+  partition->set_membership(memberships[best]);
+  return best_quality;
+}
+
+/*****************************************************************************
+  Relabel the communities in the order in which they first occur, so that
+  equal partitions have equal memberships.
+*****************************************************************************/
+static vector<size_t> canonical_membership(vector<size_t> const& membership)
+{
+  size_t n_communities = 0;
+  for (size_t comm : membership)
+    n_communities = std::max(n_communities, comm + 1);
+  vector<size_t> new_comm(n_communities, n_communities);
+  vector<size_t> result(membership.size());
+  size_t n_new = 0;
+  for (size_t v = 0; v < membership.size(); v++)
+  {
+    size_t comm = membership[v];
+    if (new_comm[comm] == n_communities)
+      new_comm[comm] = n_new++;
+    result[v] = new_comm[comm];
+  }
+  return result;
+}
+
+/*****************************************************************************
+  Find the partitions that are optimal for a range of resolutions.
+
+  The range [min_resolution, max_resolution] is bisected in rounds. In every
+  round, each interval whose ends differ in resolution by at least
+  min_diff_resolution and in bisect value by at least min_diff_bisect_value
+  (and have different partitions) is split at its midpoint. If
+  linear_bisection is true, the interval is instead split at the resolution
+  at which the partitions at both ends have the same quality, if that lies
+  within the interval. All midpoints of a round are optimised in parallel
+  (see optimise_resolutions), each starting from the partition at the end of
+  its interval with the highest quality at the midpoint. The resolution of
+  partition is ignored; it only determines the graph, the type of partition
+  and the initial membership at both ends of the range.
+
+  Afterwards, the profile is cleaned: for every evaluated resolution, the
+  point with the highest quality at that resolution is selected, and each
+  distinct partition that is selected is returned in profile, in order of
+  resolution. Since the quality of a partition with a linear resolution
+  parameter is linear in the resolution, each point only keeps its quality
+  at resolution 0 and the slope (see ProfilePoint), so that no quality is
+  recomputed. Once the deadline expires, no further rounds are started.
+*****************************************************************************/
+void ExtendedOptimiser::resolution_profile(MutableVertexPartition* partition, double min_resolution, double max_resolution,
+                                           double min_diff_bisect_value, double min_diff_resolution, bool linear_bisection,
+                                           int n_iterations, size_t n_threads, vector<ProfilePoint>& profile)
+{
+  if (dynamic_cast<LinearResolutionParameterVertexPartition*>(partition) == NULL)
+    throw Exception("Partition type should be a linear resolution parameter partition.");
+  if (!(min_resolution <= max_resolution))
+    throw Exception("Minimum resolution should not exceed the maximum resolution.");
+
+  n_threads = std::max((size_t)1, n_threads);
+  vector<Graph*> replica_graphs(n_threads, NULL);
+  replica_graphs[0] = partition->get_graph();
+  vector<ExtendedOptimiser*> optimisers(n_threads, NULL);
+
+  // Evaluated points, and the intervals between them that are to be bisected
+  vector<ProfilePoint> points(min_resolution < max_resolution ? 2 : 1);
+  points.front().resolution = min_resolution;
+  points.back().resolution = max_resolution;
+  for (ProfilePoint& point : points)
+    point.membership = partition->get_membership();
+  vector< std::pair<size_t, size_t> > intervals;
+
+  try
+  {
+    this->optimise_resolutions(partition, points, n_iterations, replica_graphs, optimisers);
+    if (points.size() > 1)
+      intervals.push_back(std::make_pair(0, 1));
+
+    vector<ProfilePoint> midpoints;
+    vector< std::pair<size_t, size_t> > split_intervals;
+    while (!intervals.empty() && !this->deadline.expired())
+    {
+      midpoints.clear();
+      split_intervals.clear();
+      for (std::pair<size_t, size_t> const& interval : intervals)
+      {
+        ProfilePoint const& low = points[interval.first];
+        ProfilePoint const& high = points[interval.second];
+        if (high.resolution - low.resolution < min_diff_resolution ||
+            std::abs(high.bisect_value - low.bisect_value) < min_diff_bisect_value ||
+            canonical_membership(low.membership) == canonical_membership(high.membership))
+          continue;
+
+        ProfilePoint mid;
+        mid.resolution = (low.resolution + high.resolution)/2.0;
+        if (linear_bisection && low.quality_slope != high.quality_slope)
+        {
+          double crossing = (high.quality_at_zero - low.quality_at_zero)/(low.quality_slope - high.quality_slope);
+          if (crossing > low.resolution && crossing < high.resolution)
+            mid.resolution = crossing;
+        }
+        // Warm start from the end that is best at the midpoint
+        if (low.quality(mid.resolution) >= high.quality(mid.resolution))
+          mid.membership = low.membership;
+        else
+          mid.membership = high.membership;
+        midpoints.push_back(mid);
+        split_intervals.push_back(interval);
+      }
+
+      this->optimise_resolutions(partition, midpoints, n_iterations, replica_graphs, optimisers);
+
+      intervals.clear();
+      for (size_t idx = 0; idx < midpoints.size(); idx++)
+      {
+        size_t mid_idx = points.size();
+        points.push_back(midpoints[idx]);
+        intervals.push_back(std::make_pair(split_intervals[idx].first, mid_idx));
+        intervals.push_back(std::make_pair(mid_idx, split_intervals[idx].second));
+      }
+    }
+  }
+  catch (...)
+  {
+    for (ExtendedOptimiser* optimiser : optimisers)
+      delete optimiser;
+    for (size_t thread = 1; thread < n_threads; thread++)
+      delete replica_graphs[thread];
+    throw;
+  }
+  // The optimisers keep the CSR of their replica, so delete them first
+  for (ExtendedOptimiser* optimiser : optimisers)
+    delete optimiser;
+  for (size_t thread = 1; thread < n_threads; thread++)
+    delete replica_graphs[thread];
+
+  vector<size_t> order(points.size());
+  for (size_t idx = 0; idx < points.size(); idx++)
+    order[idx] = idx;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+  {
+    return points[a].resolution < points[b].resolution;
+  });
+
+  // Select the best point at every resolution, using the cached qualities
+  vector<bool> is_selected(points.size(), false);
+  for (size_t idx : order)
+  {
+    double resolution = points[idx].resolution;
+    size_t best = order[0];
+    for (size_t other : order)
+      if (points[other].quality(resolution) > points[best].quality(resolution))
+        best = other;
+    is_selected[best] = true;
+  }
+
+  profile.clear();
+  std::set< vector<size_t> > memberships;
+  for (size_t idx : order)
+    if (is_selected[idx] && memberships.insert(canonical_membership(points[idx].membership)).second)
+      profile.push_back(points[idx]);
+}
+
+/*****************************************************************************
+  Optimise a partition of the same type as partition at the resolution of
+  every point, starting from the membership of the point, and store the
+  result in the point.
+
+  Points are handed out to the threads one at a time, and each thread uses
+  its own replica of the graph (see run_ensemble) and its own optimiser with
+  the settings of this optimiser. Both are created when needed and kept in
+  replica_graphs and optimisers, so that they can be reused between rounds;
+  in particular, each optimiser builds the CSR layout of its replica for
+  is_locally_optimal only once. Every point reseeds the optimiser with a seed
+  that is drawn up front, so that the result does not depend on the number
+  of threads. A point is stable if it is locally optimal, which is checked
+  without optimising the partition any further.
+*****************************************************************************/
+void ExtendedOptimiser::optimise_resolutions(MutableVertexPartition* partition, vector<ProfilePoint>& points, int n_iterations,
+                                             vector<Graph*>& replica_graphs, vector<ExtendedOptimiser*>& optimisers)
+{
+  Graph* graph = partition->get_graph();
+  vector<bool> is_membership_fixed(graph->vcount(), false);
+
+  vector<uint64_t> seeds(points.size());
+  for (uint64_t& seed : seeds)
+    seed = this->random_seed();
+
+  parallel_for_dynamic(points.size(), replica_graphs.size(), [&](size_t idx, size_t thread)
+  {
+    ProfilePoint& point = points[idx];
+    if (replica_graphs[thread] == NULL)
+      replica_graphs[thread] = replicate_graph(graph);
+    if (optimisers[thread] == NULL)
+    {
+      optimisers[thread] = new ExtendedOptimiser();
+      this->copy_settings_to(optimisers[thread]);
+      optimisers[thread]->deadline.set_parent(&this->deadline);
+      optimisers[thread]->keep_neighbourhoods = true;
+    }
+
+    ExtendedOptimiser& optimiser = *optimisers[thread];
+    optimiser.set_rng_seed(seeds[idx]);
+
+    MutableVertexPartition* point_partition = partition->create(replica_graphs[thread], point.membership);
+    try
+    {
+      LinearResolutionParameterVertexPartition* resolution_partition =
+        static_cast<LinearResolutionParameterVertexPartition*>(point_partition);
+      resolution_partition->resolution_parameter = point.resolution;
+
+      for (int itr = 0; itr < n_iterations || n_iterations < 0; itr++)
+      {
+        double improv = optimiser.optimise_partition(point_partition, is_membership_fixed);
+        if (optimiser.deadline.has_expired() || (n_iterations < 0 && improv <= 0))
+          break;
+      }
+
+      point.is_stable = !optimiser.deadline.has_expired() &&
+                        optimiser.is_locally_optimal(point_partition, is_membership_fixed);
+      point.membership = point_partition->get_membership();
+      point.bisect_value = point_partition->total_weight_in_all_comms();
+      point.quality_at_zero = resolution_partition->quality(0.0);
+      point.quality_slope = resolution_partition->quality(1.0) - point.quality_at_zero;
+    }
+    catch (...)
+    {
+      delete point_partition;
+      throw;
+    }
+    delete point_partition;
+  });
+}
+
+/*****************************************************************************
+  Whether no node that is not fixed can improve the partition by moving to a
+  neighbouring community (or to an empty community, if
+  consider_empty_community is set), taking max_comm_size into account.
+
+  This is a single pass over the nodes using n_threads threads, which all
+  stop as soon as one of them finds an improving move. The weights to the
+  neighbouring communities are accumulated from the CSR layout of the graph
+  (see build_neighbourhoods) in the scratch buffers. For the linear quality
+  functions (see linear_parameters), the improvements then follow from the
+  community totals, as for LinearBatchDiffMove, so that the partition is only
+  read. Since these are computed differently from diff_move, differences
+  within a relative tolerance of 1e-10 are not counted as improvements.
+  Apart from the CSR layout, the threads and growing the scratch buffers if
+  needed, nothing is allocated.
+
+  Other quality functions have no such form and use diff_move, which changes
+  the caches of the partition and of the graph. Each thread therefore calls
+  it on its own copy of the partition (on a replica of the graph for the
+  threads other than the first), while reading the candidates from the
+  partition itself.
+
+  Note that the queue-based move_nodes does not guarantee local optimality:
+  nodes that are not neighbours of a node that moved are not revisited, even
+  if the community it left became more attractive to them.
+*****************************************************************************/
+bool ExtendedOptimiser::is_locally_optimal(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed)
+{
+  Graph* graph = partition->get_graph();
+  size_t n = graph->vcount();
+  size_t max_comm_size = this->max_comm_size;
+
+  if (is_membership_fixed.size() != n)
+    throw Exception("Node fixed vector not same size as number of nodes.");
+
+  int null_model;
+  double resolution_parameter;
+  double scale;
+  bool is_linear = linear_parameters(partition, null_model, resolution_parameter, scale);
+
+  size_t n_threads = std::max((size_t)1, std::min(this->n_threads, n));
+  vector<MutableVertexPartition*> copies(n_threads, NULL);
+  vector<size_t> empty_comms(n_threads, 0);
+  std::atomic<bool> is_improvable(false);
+
+  try
+  {
+    CSRNeighbourhoods<CSRGraph> const& csr = this->build_neighbourhoods(graph);
+    CSRGraph const& out_graph = csr.out_graph();
+    CSRGraph const& in_graph = csr.in_graph();
+    vector<size_t> const& membership = partition->get_membership();
+    this->reserve_scratch(n_threads, partition, csr.all.max_degree(), Optimiser::ALL_NEIGH_COMMS);
+
+    if (!is_linear)
+    {
+      this->replicate_graphs(graph, n_threads - 1);
+      parallel_for(n_threads, n_threads, [&](size_t thread, size_t)
+      {
+        Graph* copy_graph = (thread == 0) ? graph : this->replica_graphs[thread - 1];
+        copies[thread] = partition->create(copy_graph, membership);
+        if (this->consider_empty_community)
+          empty_comms[thread] = copies[thread]->get_empty_community();
+      });
+    }
+
+    parallel_for(n, n_threads, [&](size_t v, size_t thread)
+    {
+      if (is_membership_fixed[v] || is_improvable.load(std::memory_order_relaxed))
+        return;
+
+      size_t v_comm = membership[v];
+      if (0 < max_comm_size && max_comm_size < partition->csize(v_comm))
+      {
+        is_improvable.store(true, std::memory_order_relaxed);
+        return;
+      }
+
+      MoveScratch& scratch = this->scratch[thread];
+      scratch.neighbours.compute(v, membership, out_graph, in_graph);
+
+      vector<size_t>& comms = scratch.comms;
+      comms.clear();
+      for (size_t comm : scratch.neighbours.comms())
+        if (comm != v_comm && !(max_comm_size > 0 && max_comm_size < partition->csize(comm) + graph->node_size(v)))
+          comms.push_back(comm);
+      bool is_empty_candidate = this->consider_empty_community && partition->cnodes(v_comm) > 1;
+      scratch.n_diff_moves += comms.size() + is_empty_candidate;
+
+      if (is_linear)
+      {
+        LinearDiffTotals& totals = scratch.totals;
+        if (null_model == LinearBatchDiffMove::CONSTANT_POTTS)
+          totals.gather<LinearBatchDiffMove::CONSTANT_POTTS>(partition, v, scratch.neighbours, comms.data(), comms.size(), resolution_parameter);
+        else
+          totals.gather<LinearBatchDiffMove::CONFIGURATION>(partition, v, scratch.neighbours, comms.data(), comms.size(), resolution_parameter);
+        totals.evaluate(v_comm, comms.data(), comms.size(), scale, scratch.diffs.data());
+
+        // Moving to an empty community gains nothing, so its improvement is
+        // minus the gain of v in its own community
+        double gain_old = scale*totals.w_old;
+        auto is_improvement = [&](double diff)
+        {
+          return diff > 1e-10*(std::abs(diff + gain_old) + std::abs(gain_old));
+        };
+        if (is_empty_candidate && is_improvement(-gain_old))
+          is_improvable.store(true, std::memory_order_relaxed);
+        for (size_t idx = 0; idx < comms.size(); idx++)
+          if (is_improvement(scratch.diffs[idx]))
+            is_improvable.store(true, std::memory_order_relaxed);
+      }
+      else
+      {
+        MutableVertexPartition* copy = copies[thread];
+        if (is_empty_candidate && copy->diff_move(v, empty_comms[thread]) > 0)
+          is_improvable.store(true, std::memory_order_relaxed);
+        for (size_t idx = 0; idx < comms.size() && !is_improvable.load(std::memory_order_relaxed); idx++)
+          if (copy->diff_move(v, comms[idx]) > 0)
+            is_improvable.store(true, std::memory_order_relaxed);
+      }
+    });
+  }
+  catch (...)
+  {
+    for (MutableVertexPartition* copy : copies)
+      delete copy;
+    if (!this->keep_replica_graphs)
+      this->delete_replica_graphs();
+    if (!this->keep_neighbourhoods)
+      this->delete_neighbourhoods();
+    throw;
+  }
+
+  for (MutableVertexPartition* copy : copies)
+    delete copy;
+  if (!this->keep_replica_graphs)
+    this->delete_replica_graphs();
+  if (!this->keep_neighbourhoods)
+    this->delete_neighbourhoods();
+  this->collect_diff_moves();
+
+  return !is_improvable.load();
+}
+
+/*****************************************************************************
+  Copy the settings of this optimiser to another optimiser, for a single
+  thread. The seed, counters and buffers are not copied.
+*****************************************************************************/
+void ExtendedOptimiser::copy_settings_to(ExtendedOptimiser* optimiser) const
+{
+  optimiser->consider_comms = this->consider_comms;
+  optimiser->refine_consider_comms = this->refine_consider_comms;
+  optimiser->optimise_routine = this->optimise_routine;
+  optimiser->refine_routine = this->refine_routine;
+  optimiser->consider_empty_community = this->consider_empty_community;
+  optimiser->refine_partition = this->refine_partition;
+  optimiser->max_comm_size = this->max_comm_size;
+
+  optimiser->n_threads = 1;
+  optimiser->batch_size = this->batch_size;
+  optimiser->use_queue = this->use_queue;
+  optimiser->specialise_diff_move = this->specialise_diff_move;
+  optimiser->compact_indices = this->compact_indices;
+  optimiser->check_interval = this->check_interval;
+}
+
+/*****************************************************************************
+  Optimise a partition after edges of its graph were added or removed.
+
+  The partition should be a partition of the new graph, with the membership
+  from before the change, and changed_nodes the end points of the edges that
+  changed. Only the changed nodes and the nodes in their communities are
+  queued for moving.
+
+  This is not an incremental update: Graph and MutableVertexPartition offer
+  no way to change their edges or community totals, so the caller creates
+  both anew, in time linear in the size of the graph. Removed edges may
+  disconnect a community, so these communities are first split into their
+  connected components. The queued nodes are then moved by the queue-based
+  move_nodes, regardless of use_queue and n_threads. The graph is not
+  aggregated, so that this is much cheaper than optimise_partition, but the
+  result may be of lower quality than optimising from scratch.
+*****************************************************************************/
+double ExtendedOptimiser::optimise_changed_nodes(MutableVertexPartition* partition, vector<size_t> const& changed_nodes, vector<bool> const& is_membership_fixed)
+{
+  Graph* graph = partition->get_graph();
+  size_t n = graph->vcount();
+
+  if (is_membership_fixed.size() != n)
+    throw Exception("Node fixed vector not same size as number of nodes.");
+
+  vector<bool> is_comm_changed(partition->n_communities(), false);
+  for (size_t v : changed_nodes)
+  {
+    if (v >= n)
+      throw Exception("Changed node is not in the graph.");
+    is_comm_changed[partition->membership(v)] = true;
+  }
+
+  vector<size_t> nodes;
+  for (size_t v = 0; v < n; v++)
+    if (is_comm_changed[partition->membership(v)])
+      nodes.push_back(v);
+
+  double improv = this->split_disconnected_communities(partition, nodes, is_membership_fixed);
+  improv += this->move_nodes_queue(partition, nodes, is_membership_fixed, this->consider_comms, true, this->max_comm_size);
+  return improv;
+}
+
+/*****************************************************************************
+  Move every connected component of the communities of nodes, except the
+  first, to a new community.
+
+  Communities that contain a fixed node are left as they are. Returns the
+  improvement in quality.
+*****************************************************************************/
+double ExtendedOptimiser::split_disconnected_communities(MutableVertexPartition* partition, vector<size_t> const& nodes, vector<bool> const& is_membership_fixed)
+{
+  Graph* graph = partition->get_graph();
+  size_t n = graph->vcount();
+  size_t n_comms = partition->n_communities();
+
+  vector<bool> has_fixed_node(n_comms, false);
+  for (size_t v : nodes)
+    if (is_membership_fixed[v])
+      has_fixed_node[partition->membership(v)] = true;
+
+  vector<bool> is_comm_seen(n_comms, false);
+  vector<bool> is_visited(n, false);
+  vector<size_t> stack;
+  double improv = 0.0;
+  for (size_t v : nodes)
+  {
+    size_t comm = partition->membership(v);
+    if (is_visited[v] || has_fixed_node[comm])
+      continue;
+
+    // v starts a component of comm that was not reached from an earlier node
+    size_t new_comm = comm;
+    if (is_comm_seen[comm])
+      new_comm = partition->get_empty_community();
+    is_comm_seen[comm] = true;
+
+    is_visited[v] = true;
+    stack.push_back(v);
+    while (!stack.empty())
+    {
+      size_t u = stack.back();
+      stack.pop_back();
+      if (new_comm != comm)
+      {
+        improv += partition->diff_move(u, new_comm);
+        partition->move_node(u, new_comm);
+      }
+
+      for (size_t w : graph->get_neighbours(u, IGRAPH_ALL))
+      {
+        if (!is_visited[w] && partition->membership(w) == comm)
+        {
+          is_visited[w] = true;
+          stack.push_back(w);
+        }
+      }
+    }
+  }
+
+  return improv;
+}
+
+double ExtendedOptimiser::move_nodes(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes)
+{
+  return this->move_nodes(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, this->max_comm_size);
+}
+
+double ExtendedOptimiser::move_nodes(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size)
+{
+  if (this->n_threads > 1)
+    return this->move_nodes_parallel(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, max_comm_size);
+  else if (this->use_queue)
+    return this->move_nodes_queue(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, max_comm_size);
+  return Optimiser::move_nodes(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, max_comm_size);
+}
+
+double ExtendedOptimiser::move_nodes_queue(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size)
+{
+  size_t n = partition->get_graph()->vcount();
+  if (is_membership_fixed.size() != n)
+    throw Exception("Node fixed vector not same size as number of nodes.");
+
+  // Queue all nodes that are not fixed
+  vector<size_t>& nodes = this->nodes;
+  nodes.clear();
+  for (size_t v = 0; v < n; v++)
+    if (!is_membership_fixed[v])
+      nodes.push_back(v);
+
+  return this->move_queued_nodes(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, max_comm_size);
+}
+
+double ExtendedOptimiser::move_nodes_queue(MutableVertexPartition* partition, vector<size_t> const& initial_nodes, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size)
+{
+  size_t n = partition->get_graph()->vcount();
+  if (is_membership_fixed.size() != n)
+    throw Exception("Node fixed vector not same size as number of nodes.");
+
+  // Queue only the initial nodes that are not fixed
+  vector<size_t>& nodes = this->nodes;
+  nodes.clear();
+  for (size_t v : initial_nodes)
+  {
+    if (v >= n)
+      throw Exception("Node to move is not in the graph.");
+    if (!is_membership_fixed[v])
+      nodes.push_back(v);
+  }
+
+  return this->move_queued_nodes(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, max_comm_size);
+}
+
+// Build the CSR layouts once per call, in the layout selected by csr_layout.
+double ExtendedOptimiser::move_queued_nodes(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size)
+{
+  double improv = 0.0;
+  switch (this->csr_layout(partition->get_graph()))
+  {
+    case COMPACT_FLOAT_CSR:
+      improv = this->move_nodes_queue_csr<CompactFloatCSRGraph>(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, max_comm_size);
+      break;
+    case COMPACT_CSR:
+      improv = this->move_nodes_queue_csr<CompactCSRGraph>(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, max_comm_size);
+      break;
+    case FULL_CSR:
+    default:
+      improv = this->move_nodes_queue_csr<CSRGraph>(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, max_comm_size);
+      break;
+  }
+  this->collect_diff_moves();
+  return improv;
+}
+
+/*****************************************************************************
+  Move nodes to other communities, starting from the nodes in this->nodes, and
+  only revisiting nodes whose neighbourhood changed.
+
+  The initial nodes are queued in random order. Whenever a node moves, its
+  neighbours that are not fixed, not in the new community and not already
+  queued are appended to the queue. Neighbourhoods are read from a CSR layout
+  of the graph, which is built once per call. Node visits and moves are
+  counted in n_visits and n_moves.
+
+  For CPM, RBER, RBConfiguration and modularity, the loop is compiled for the
+  exact type of partition (see move_nodes_queue_static). Other types of
+  partition, or all of them if specialise_diff_move is not set, use the
+  virtual BatchDiffMove in the same loop, which gives the same result.
+*****************************************************************************/
+template <class CSR>
+double ExtendedOptimiser::move_nodes_queue_csr(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size)
+{
+  Graph* graph = partition->get_graph();
+  size_t n = graph->vcount();
+
+  vector<size_t> fixed_nodes;
+  vector<size_t> fixed_membership(n);
+  if (renumber_fixed_nodes)
+  {
+    for (size_t v = 0; v < n; v++)
+    {
+      if (is_membership_fixed[v])
+      {
+        fixed_nodes.push_back(v);
+        fixed_membership[v] = partition->membership(v);
+      }
+    }
+  }
+
+  CSRNeighbourhoods<CSR> csr(graph);
+  this->reserve_scratch(1, partition, csr.all.max_degree(), consider_comms);
+
+  // Queue the initial nodes in random order
+  vector<size_t>& nodes = this->nodes;
+  this->shuffle(nodes);
+
+  NodeQueue& queue = this->queue;
+  if (queue.reset(n))
+    this->n_scratch_allocations += 1;
+  for (size_t v : nodes)
+    queue.push(v);
+
+  uint64_t seed = this->random_seed();
+  CSR const& out_graph = csr.out_graph();
+  CSR const& in_graph = csr.in_graph();
+
+  // Select the specialised loop once per call, based on the exact type of partition
+  double total_improv = 0.0;
+  std::type_info const& type = typeid(*partition);
+  if (this->specialise_diff_move && type == typeid(ModularityVertexPartition))
+    total_improv = this->move_nodes_queue_static<ModularityVertexPartition, LinearBatchDiffMove::CONFIGURATION>(
+        (ModularityVertexPartition*)partition, is_membership_fixed, out_graph, in_graph, csr.all, consider_comms, max_comm_size, seed);
+  else if (this->specialise_diff_move && type == typeid(RBConfigurationVertexPartition))
+    total_improv = this->move_nodes_queue_static<RBConfigurationVertexPartition, LinearBatchDiffMove::CONFIGURATION>(
+        (RBConfigurationVertexPartition*)partition, is_membership_fixed, out_graph, in_graph, csr.all, consider_comms, max_comm_size, seed);
+  else if (this->specialise_diff_move && type == typeid(RBERVertexPartition))
+    total_improv = this->move_nodes_queue_static<RBERVertexPartition, LinearBatchDiffMove::CONSTANT_POTTS>(
+        (RBERVertexPartition*)partition, is_membership_fixed, out_graph, in_graph, csr.all, consider_comms, max_comm_size, seed);
+  else if (this->specialise_diff_move && type == typeid(CPMVertexPartition))
+    total_improv = this->move_nodes_queue_static<CPMVertexPartition, LinearBatchDiffMove::CONSTANT_POTTS>(
+        (CPMVertexPartition*)partition, is_membership_fixed, out_graph, in_graph, csr.all, consider_comms, max_comm_size, seed);
+  else
+  {
+    BatchDiffMove* batch_diff_move = BatchDiffMove::create(partition);
+    batch_diff_move->reserve(this->scratch[0].diffs.size());
+    try
+    {
+      total_improv = this->move_nodes_queue_dispatch(partition, batch_diff_move, is_membership_fixed,
+                                                     out_graph, in_graph, csr.all, consider_comms, max_comm_size, seed);
+    }
+    catch (...)
+    {
+      delete batch_diff_move;
+      throw;
+    }
+    delete batch_diff_move;
+  }
+
+  partition->renumber_communities();
+  if (renumber_fixed_nodes && fixed_nodes.size() > 0)
+    partition->renumber_communities(fixed_nodes, fixed_membership);
+
+  return total_improv;
+}
+
+/*****************************************************************************
+  Move nodes from the queue, using diff_moves of a partition whose type is
+  known at compile time. Here diff_moves is not virtual (see
+  StaticLinearBatchDiffMove), and the community totals are read directly from
+  the concrete type of partition.
+*****************************************************************************/
+template <class Partition, int NULL_MODEL, class CSR>
+double ExtendedOptimiser::move_nodes_queue_static(Partition* partition, vector<bool> const& is_membership_fixed,
+                                                  CSR const& out_graph, CSR const& in_graph, CSR const& all_graph,
+                                                  int consider_comms, size_t max_comm_size, uint64_t seed)
+{
+  StaticLinearBatchDiffMove<Partition, NULL_MODEL> batch_diff_move(partition);
+  batch_diff_move.reserve(this->scratch[0].diffs.size());
+  return this->move_nodes_queue_dispatch(partition, &batch_diff_move, is_membership_fixed,
+                                         out_graph, in_graph, all_graph, consider_comms, max_comm_size, seed);
+}
+
+// Select the loop for the directedness and weights of the graph, so that
+// accumulating the weights to the neighbouring communities has no run-time
+// branches.
+template <class DiffMoves, class CSR>
+double ExtendedOptimiser::move_nodes_queue_dispatch(MutableVertexPartition* partition, DiffMoves* batch_diff_move, vector<bool> const& is_membership_fixed,
+                                                    CSR const& out_graph, CSR const& in_graph, CSR const& all_graph,
+                                                    int consider_comms, size_t max_comm_size, uint64_t seed)
+{
+  Graph* graph = partition->get_graph();
+  if (graph->is_directed() && graph->is_weighted())
+    return this->move_nodes_queue_loop<true, true>(partition, batch_diff_move, is_membership_fixed,
+                                                   out_graph, in_graph, all_graph, consider_comms, max_comm_size, seed);
+  else if (graph->is_directed())
+    return this->move_nodes_queue_loop<true, false>(partition, batch_diff_move, is_membership_fixed,
+                                                    out_graph, in_graph, all_graph, consider_comms, max_comm_size, seed);
+  else if (graph->is_weighted())
+    return this->move_nodes_queue_loop<false, true>(partition, batch_diff_move, is_membership_fixed,
+                                                    out_graph, in_graph, all_graph, consider_comms, max_comm_size, seed);
+  return this->move_nodes_queue_loop<false, false>(partition, batch_diff_move, is_membership_fixed,
+                                                   out_graph, in_graph, all_graph, consider_comms, max_comm_size, seed);
+}
+
+template <bool IS_DIRECTED, bool IS_WEIGHTED, class DiffMoves, class CSR>
+double ExtendedOptimiser::move_nodes_queue_loop(MutableVertexPartition* partition, DiffMoves* batch_diff_move, vector<bool> const& is_membership_fixed,
+                                                CSR const& out_graph, CSR const& in_graph, CSR const& all_graph,
+                                                int consider_comms, size_t max_comm_size, uint64_t seed)
+{
+  MoveScratch& scratch = this->scratch[0];
+  NodeQueue& queue = this->queue;
+  size_t check_interval = std::max((size_t)1, this->check_interval);
+  double total_improv = 0.0;
+
+  for (size_t n_visits = 0; !queue.empty(); n_visits++)
+  {
+    // Leave the remaining nodes where they are once the deadline expired
+    if (n_visits % check_interval == 0 && this->deadline.expired())
+      break;
+
+    size_t v = queue.pop();
+    this->n_visits += 1;
+
+    size_t comm;
+    bool is_empty_comm;
+    scratch.neighbours.compute<IS_DIRECTED, IS_WEIGHTED>(v, partition->get_membership(), out_graph, in_graph);
+    double improv = propose_move(partition, v, all_graph, batch_diff_move, scratch,
+                                 consider_comms, this->consider_empty_community,
+                                 max_comm_size, seed + this->n_visits,
+                                 comm, is_empty_comm);
+
+    if (comm != partition->membership(v))
+    {
+      partition->move_node(v, comm);
+      total_improv += improv;
+      this->n_moves += 1;
+
+      // Revisit neighbours that are not in the new community
+      for (typename CSR::Neighbour const& neighbour : all_graph.neighbours(v))
+      {
+        size_t u = neighbour.node;
+        if (!is_membership_fixed[u] && partition->membership(u) != comm)
+          queue.push(u);
+      }
+    }
+  }
+
+  return total_improv;
+}
+
+// Build the CSR layouts once per call, in the layout selected by csr_layout.
+double ExtendedOptimiser::move_nodes_parallel(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size)
+{
+  double improv = 0.0;
+  switch (this->csr_layout(partition->get_graph()))
+  {
+    case COMPACT_FLOAT_CSR:
+      improv = this->move_nodes_parallel_csr<CompactFloatCSRGraph>(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, max_comm_size);
+      break;
+    case COMPACT_CSR:
+      improv = this->move_nodes_parallel_csr<CompactCSRGraph>(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, max_comm_size);
+      break;
+    case FULL_CSR:
+    default:
+      improv = this->move_nodes_parallel_csr<CSRGraph>(partition, is_membership_fixed, consider_comms, renumber_fixed_nodes, max_comm_size);
+      break;
+  }
+  this->collect_diff_moves();
+  return improv;
+}
+
+/*****************************************************************************
+  Move nodes to other communities using multiple threads.
+
+  Moves are evaluated speculatively. The nodes are visited in a random order,
+  in batches of batch_size nodes, however many threads there are. All nodes
+  of a batch are evaluated in parallel against the partition as it was at the
+  start of the batch. The proposed moves are then committed serially, in the
+  order of the batch, after checking that the move still improves the
+  partition, which resolves any conflicts within the batch. Nodes whose
+  neighbours moved are visited again, until no more nodes can be moved.
+
+  A single parallel region runs for the whole call: the first thread commits
+  each batch and sets up the next one, while the other threads wait at a
+  barrier, after which all threads evaluate their part of the batch. Since
+  the commits are serial and random choices only depend on the node and the
+  index of the batch, the result is deterministic for a given seed and does
+  not depend on the number of threads.
+
+  Linear quality functions are evaluated from the totals of the partition
+  only (see LinearBatchDiffMove), so all threads read the partition itself.
+  Other quality functions use diff_move, which is not thread safe, so every
+  thread other than the first uses its own replica of the partition and of
+  the graph, which replays the moves of each batch. Memory use then grows
+  linearly with the number of threads.
+*****************************************************************************/
+template <class CSR>
+double ExtendedOptimiser::move_nodes_parallel_csr(MutableVertexPartition* partition, vector<bool> const& is_membership_fixed, int consider_comms, bool renumber_fixed_nodes, size_t max_comm_size)
+{
+  Graph* graph = partition->get_graph();
+  size_t n = graph->vcount();
+
+  if (is_membership_fixed.size() != n)
+    throw Exception("Node fixed vector not same size as number of nodes.");
+
+  vector<size_t> fixed_nodes;
+  vector<size_t> fixed_membership(n);
+  if (renumber_fixed_nodes)
+  {
+    for (size_t v = 0; v < n; v++)
+    {
+      if (is_membership_fixed[v])
+      {
+        fixed_nodes.push_back(v);
+        fixed_membership[v] = partition->membership(v);
+      }
+    }
+  }
+
+  // Queue of nodes to visit, in random order
+  vector<size_t> queue;
+  vector<bool> is_node_queued(n, false);
+  for (size_t v = 0; v < n; v++)
+  {
+    if (!is_membership_fixed[v])
+    {
+      queue.push_back(v);
+      is_node_queued[v] = true;
+    }
+  }
+  this->shuffle(queue);
+
+  CSRNeighbourhoods<CSR> csr(graph);
+
+  // The batches and their seeds do not depend on the number of threads
+  size_t n_threads = std::max((size_t)1, std::min(this->n_threads, queue.size()));
+  size_t batch_size = std::max((size_t)1, this->batch_size);
+  uint64_t seed = this->random_seed();
+
+  this->reserve_scratch(n_threads, partition, csr.all.max_degree(), consider_comms);
+
+  // Linear quality functions only read the totals of the partition, so all
+  // threads evaluate the partition itself. Otherwise diff_move uses the caches
+  // of the partition and the graph, and the threads other than the first use
+  // replicas of both.
+  int null_model;
+  double resolution_parameter;
+  double scale;
+  bool is_linear = linear_parameters(partition, null_model, resolution_parameter, scale);
+
+  vector<MutableVertexPartition*> replicas(n_threads, partition);
+  vector<BatchDiffMove*> batch_diff_moves(n_threads, NULL);
+  double total_improv = 0.0;
+
+  auto delete_replicas = [&]()
+  {
+    for (BatchDiffMove* batch_diff_move : batch_diff_moves)
+      delete batch_diff_move;
+    for (MutableVertexPartition* replica : replicas)
+      if (replica != partition)
+        delete replica;
+    if (!this->keep_replica_graphs)
+      this->delete_replica_graphs();
+  };
+
+  try
+  {
+    if (!is_linear)
+      this->replicate_graphs(graph, n_threads - 1);
+    parallel_for(n_threads, n_threads, [&](size_t thread, size_t)
+    {
+      if (!is_linear && thread > 0)
+        replicas[thread] = partition->create(this->replica_graphs[thread - 1], partition->get_membership());
+      batch_diff_moves[thread] = BatchDiffMove::create(replicas[thread]);
+      batch_diff_moves[thread]->reserve(this->scratch[thread].diffs.size());
+    });
+
+    vector<size_t> proposed_comm(batch_size);
+    vector<double> proposed_improv(batch_size);
+    // Not vector<bool>, since elements are written concurrently
+    vector<char> is_proposed_empty(batch_size);
+    vector< pair<size_t, size_t> > moves;
+    moves.reserve(batch_size);
+    vector<size_t> next_queue;
+
+    // Index of the last batch in which a node moved into or out of each community
+    vector<size_t> comm_batch(partition->n_communities(), 0);
+    size_t batch_idx = 0;
+    size_t batch_begin = 0;
+    size_t batch_end = 0;
+    uint64_t batch_seed = 0;
+
+    // Commit the proposed moves of the batch in order, provided they still
+    // improve. The improvement is computed again from the CSR, unless neither
+    // community changed during the batch: a linear quality function then has
+    // the same improvement as when the move was proposed.
+    auto commit_batch = [&]()
+    {
+      moves.clear();
+      for (size_t pos = batch_begin; pos < batch_end; pos++)
+      {
+        size_t idx = pos - batch_begin;
+        size_t v = queue[pos];
+        is_node_queued[v] = false;
+        this->n_visits += 1;
+
+        size_t v_comm = partition->membership(v);
+        size_t comm = proposed_comm[idx];
+        if (is_proposed_empty[idx])
+        {
+          if (partition->cnodes(v_comm) <= 1)
+            continue;
+          comm = partition->get_empty_community();
+        }
+        else if (comm == v_comm)
+          continue;
+        else if (max_comm_size > 0 && max_comm_size < partition->csize(comm) + graph->node_size(v))
+          continue;
+
+        if (comm_batch.size() < partition->n_communities())
+          comm_batch.resize(partition->n_communities(), 0);
+
+        double improv = proposed_improv[idx];
+        if (!is_linear || comm_batch[v_comm] == batch_idx || comm_batch[comm] == batch_idx)
+        {
+          MoveScratch& scratch = this->scratch[0];
+          scratch.neighbours.compute(v, partition->get_membership(), csr.out_graph(), csr.in_graph());
+          batch_diff_moves[0]->diff_moves(v, scratch.neighbours, &comm, 1, &improv);
+          this->n_diff_moves += 1;
+        }
+
+        // Nodes in communities that are too large should always move
+        bool is_comm_too_large = (0 < max_comm_size && max_comm_size < partition->csize(v_comm));
+        if (improv > 0 || is_comm_too_large)
+        {
+          partition->move_node(v, comm);
+          moves.push_back(make_pair(v, comm));
+          comm_batch[v_comm] = batch_idx;
+          comm_batch[comm] = batch_idx;
+          total_improv += improv;
+          this->n_moves += 1;
+
+          // Revisit neighbours that are not in the new community
+          for (typename CSR::Neighbour const& neighbour : csr.all.neighbours(v))
+          {
+            size_t u = neighbour.node;
+            if (!is_node_queued[u] && !is_membership_fixed[u] && partition->membership(u) != comm)
+            {
+              next_queue.push_back(u);
+              is_node_queued[u] = true;
+            }
+          }
+        }
+      }
+    };
+
+    // Set up the next batch, continuing with the revisited nodes once the
+    // queue is done. Returns false if there are no more nodes to visit.
+    auto next_batch = [&]()
+    {
+      batch_begin = batch_end;
+      if (batch_begin >= queue.size())
+      {
+        queue.swap(next_queue);
+        next_queue.clear();
+        batch_begin = 0;
+      }
+
+      // Keep the moves committed so far once the deadline expired
+      if (queue.empty() || this->deadline.expired())
+        return false;
+
+      batch_end = std::min(queue.size(), batch_begin + batch_size);
+      batch_seed = splitmix64(seed + batch_idx);
+      batch_idx += 1;
+
+      // Proposing a move to an empty community should not modify the partition
+      if (this->consider_empty_community)
+        partition->get_empty_community();
+      return true;
+    };
+
+    // Alternate between committing (first thread only) and evaluating (all
+    // threads). Threads that fail still take part in the barriers.
+    Barrier barrier(n_threads);
+    vector<std::exception_ptr> errors(n_threads);
+    bool is_done = false;
+
+    parallel_for(n_threads, n_threads, [&](size_t thread, size_t)
+    {
+      while (true)
+      {
+        if (thread == 0)
+        {
+          try
+          {
+            commit_batch();
+            is_done = !next_batch();
+          }
+          catch (...)
+          {
+            errors[thread] = std::current_exception();
+          }
+          for (std::exception_ptr& error : errors)
+            if (error)
+              is_done = true;
+        }
+        barrier.wait();
+        if (is_done)
+          break;
+
+        try
+        {
+          // Replicas only replay the moves of the previous batch
+          if (replicas[thread] != partition)
+            for (pair<size_t, size_t> const& move : moves)
+              replicas[thread]->move_node(move.first, move.second);
+
+          size_t block_size = (batch_end - batch_begin + n_threads - 1)/n_threads;
+          size_t block_begin = std::min(batch_end, batch_begin + thread*block_size);
+          size_t block_end = std::min(batch_end, block_begin + block_size);
+          MoveScratch& scratch = this->scratch[thread];
+          for (size_t pos = block_begin; pos < block_end; pos++)
+          {
+            size_t idx = pos - batch_begin;
+            size_t v = queue[pos];
+            size_t best_comm;
+            bool is_empty_comm;
+            scratch.neighbours.compute(v, replicas[thread]->get_membership(), csr.out_graph(), csr.in_graph());
+            proposed_improv[idx] = propose_move(replicas[thread], v, csr.all, batch_diff_moves[thread], scratch,
+                                                consider_comms, this->consider_empty_community,
+                                                max_comm_size, batch_seed,
+                                                best_comm, is_empty_comm);
+            proposed_comm[idx] = best_comm;
+            is_proposed_empty[idx] = is_empty_comm;
+          }
+        }
+        catch (...)
+        {
+          errors[thread] = std::current_exception();
+        }
+        barrier.wait();
+      }
+    });
+
+    for (std::exception_ptr& error : errors)
+      if (error)
+        std::rethrow_exception(error);
+  }
+  catch (...)
+  {
+    delete_replicas();
+    throw;
+  }
+
+  delete_replicas();
+
+  partition->renumber_communities();
+  if (renumber_fixed_nodes && fixed_nodes.size() > 0)
+    partition->renumber_communities(fixed_nodes, fixed_membership);
+
+  return total_improv;
+}
+
+/*****************************************************************************
+  Determine the best community for node v within its constrained community,
+  in the same way as propose_move does.
+
+  The partition should have started from singletons, and nodes only move to
+  communities of other nodes in the same constrained community. Hence the
+  identifier of every community is a node of the constrained community it
+  lies in, which is used to restrict the candidates. Empty communities are
+  never considered.
+*****************************************************************************/
+template <class CSR>
+static double propose_constrained_move(MutableVertexPartition* partition, size_t v,
+                                       vector<size_t> const& constrained_membership,
+                                       vector<size_t> const& comm_nodes,
+                                       CSR const& csr,
+                                       BatchDiffMove* batch_diff_move, MoveScratch& scratch,
+                                       int consider_comms, size_t max_comm_size, uint64_t seed,
+                                       size_t& best_comm)
+{
+  Graph* graph = partition->get_graph();
+  size_t v_comm = partition->membership(v);
+  size_t v_constrained_comm = constrained_membership[v];
+  double v_size = graph->node_size(v);
+
+  vector<size_t>& comms = scratch.comms;
+  comms.clear();
+
+  auto add_candidate = [&](size_t comm)
+  {
+    if (comm == v_comm)
+      return;
+    if (max_comm_size > 0 && max_comm_size < partition->csize(comm) + v_size)
+      return;
+    comms.push_back(comm);
+  };
+
+  if (consider_comms == Optimiser::ALL_COMMS)
+  {
+    for (size_t u : comm_nodes)
+      if (partition->cnodes(u) > 0)
+        add_candidate(u);
+  }
+  else if (consider_comms == Optimiser::ALL_NEIGH_COMMS)
+  {
+    for (size_t comm : scratch.neighbours.comms())
+      if (constrained_membership[comm] == v_constrained_comm)
+        add_candidate(comm);
+  }
+  else if (consider_comms == Optimiser::RAND_COMM)
+  {
+    add_candidate(partition->membership(comm_nodes[random_index(seed, v, comm_nodes.size())]));
+  }
+  else if (consider_comms == Optimiser::RAND_NEIGH_COMM)
+  {
+    // Community of a random neighbour within the same constrained community
+    typename CSR::NeighbourSpan neighbours = csr.neighbours(v);
+    size_t n_constrained_neighbours = 0;
+    for (typename CSR::Neighbour const& neighbour : neighbours)
+      if (constrained_membership[neighbour.node] == v_constrained_comm)
+        n_constrained_neighbours += 1;
+    if (n_constrained_neighbours > 0)
+    {
+      size_t rand_idx = random_index(seed, v, n_constrained_neighbours);
+      for (typename CSR::Neighbour const& neighbour : neighbours)
+      {
+        if (constrained_membership[neighbour.node] != v_constrained_comm)
+          continue;
+        if (rand_idx-- == 0)
+        {
+          add_candidate(partition->membership(neighbour.node));
+          break;
+        }
+      }
+    }
+  }
+
+  best_comm = v_comm;
+  double max_improv = (0.0 < max_comm_size && max_comm_size < partition->csize(v_comm)) ? -INFINITY : 0.0;
+
+  if (comms.empty())
+    return 0.0;
+
+  batch_diff_move->diff_moves(v, scratch.neighbours, comms.data(), comms.size(), scratch.diffs.data());
+  scratch.n_diff_moves += comms.size();
+
+  for (size_t idx = 0; idx < comms.size(); idx++)
+  {
+    if (scratch.diffs[idx] > max_improv)
+    {
+      best_comm = comms[idx];
+      max_improv = scratch.diffs[idx];
+    }
+  }
+
+  return best_comm != v_comm ? max_improv : 0.0;
+}
+
+/*****************************************************************************
+  Whether moving nodes within constraints uses refine_parallel, i.e. with
+  n_threads > 1 or use_queue, for a singleton partition whose communities can
+  be refined independently (see has_local_diff_move). The result of
+  refine_parallel does not depend on the number of threads, including one.
+  Otherwise, for Surprise and for partitions that are not singletons, the
+  refinement of libleidenalg is used.
+*****************************************************************************/
+bool ExtendedOptimiser::refines_in_parallel(MutableVertexPartition* partition)
+{
+  if (!(this->n_threads > 1 || this->use_queue) || !has_local_diff_move(partition))
+    return false;
+  for (size_t v = 0; v < partition->get_graph()->vcount(); v++)
+    if (partition->membership(v) != v)
+      return false;
+  return true;
+}
+
+double ExtendedOptimiser::move_nodes_constrained(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition)
+{
+  return this->move_nodes_constrained(partition, consider_comms, constrained_partition, this->max_comm_size);
+}
+
+double ExtendedOptimiser::move_nodes_constrained(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size)
+{
+  if (this->refines_in_parallel(partition))
+    return this->move_nodes_constrained_parallel(partition, consider_comms, constrained_partition, max_comm_size);
+  return Optimiser::move_nodes_constrained(partition, consider_comms, constrained_partition, max_comm_size);
+}
+
+double ExtendedOptimiser::merge_nodes_constrained(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition)
+{
+  return this->merge_nodes_constrained(partition, consider_comms, constrained_partition, this->max_comm_size);
+}
+
+double ExtendedOptimiser::merge_nodes_constrained(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size)
+{
+  if (this->refines_in_parallel(partition))
+    return this->merge_nodes_constrained_parallel(partition, consider_comms, constrained_partition, max_comm_size);
+  return Optimiser::merge_nodes_constrained(partition, consider_comms, constrained_partition, max_comm_size);
+}
+
+double ExtendedOptimiser::move_nodes_constrained_parallel(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size)
+{
+  return this->refine_parallel(partition, false, consider_comms, constrained_partition, max_comm_size);
+}
+
+double ExtendedOptimiser::merge_nodes_constrained_parallel(MutableVertexPartition* partition, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size)
+{
+  return this->refine_parallel(partition, true, consider_comms, constrained_partition, max_comm_size);
+}
+
+// Build the CSR layouts once per call, in the layout selected by csr_layout.
+double ExtendedOptimiser::refine_parallel(MutableVertexPartition* partition, bool merge_only, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size)
+{
+  double improv = 0.0;
+  switch (this->csr_layout(partition->get_graph()))
+  {
+    case COMPACT_FLOAT_CSR:
+      improv = this->refine_parallel_csr<CompactFloatCSRGraph>(partition, merge_only, consider_comms, constrained_partition, max_comm_size);
+      break;
+    case COMPACT_CSR:
+      improv = this->refine_parallel_csr<CompactCSRGraph>(partition, merge_only, consider_comms, constrained_partition, max_comm_size);
+      break;
+    case FULL_CSR:
+    default:
+      improv = this->refine_parallel_csr<CSRGraph>(partition, merge_only, consider_comms, constrained_partition, max_comm_size);
+      break;
+  }
+  this->collect_diff_moves();
+  return improv;
+}
+
+/*****************************************************************************
+  Refine a singleton partition within the communities of the constrained
+  partition, refining each constrained community in a separate task.
+
+  Since nodes only move within their constrained community, the tasks are
+  independent. Each thread refines its tasks on its own replica of the
+  partition, largest communities first. Every task shuffles its nodes and
+  makes its random choices using its own random stream, derived from a single
+  seed and the constrained community. Because diff_move only depends on the
+  communities within the task, the result does not depend on which thread
+  refined which community, nor on the number of threads.
+
+  When merging, only nodes that are still on their own are moved, as in
+  merge_nodes_constrained. Otherwise, nodes whose neighbours within the same
+  constrained community moved are revisited, as in move_nodes_constrained.
+*****************************************************************************/
+template <class CSR>
+double ExtendedOptimiser::refine_parallel_csr(MutableVertexPartition* partition, bool merge_only, int consider_comms, MutableVertexPartition* constrained_partition, size_t max_comm_size)
+{
+  Graph* graph = partition->get_graph();
+  size_t n = graph->vcount();
+
+  if (constrained_partition->get_graph()->vcount() != n)
+    throw Exception("Constrained partition not defined on the same graph.");
+  for (size_t v = 0; v < n; v++)
+    if (partition->membership(v) != v)
+      throw Exception("Parallel refinement requires a singleton partition.");
+
+  vector<size_t> const& constrained_membership = constrained_partition->get_membership();
+  vector< vector<size_t> > constrained_comms = constrained_partition->get_communities();
+
+  // Refine the largest communities first, which balances the threads best
+  vector<size_t> order(constrained_comms.size());
+  for (size_t c = 0; c < order.size(); c++)
+    order[c] = c;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+  {
+    return constrained_comms[a].size() > constrained_comms[b].size();
+  });
+  size_t n_tasks = 0;
+  while (n_tasks < order.size() && constrained_comms[order[n_tasks]].size() > 1)
+    n_tasks += 1;
+
+  CSRNeighbourhoods<CSR> csr(graph);
+
+  size_t n_threads = std::max((size_t)1, std::min(this->n_threads, n_tasks));
+  this->reserve_scratch(n_threads, partition, csr.all.max_degree(), consider_comms);
+  if (!merge_only)
+  {
+    if (this->refine_queues.size() < n_threads)
+    {
+      this->refine_queues.resize(n_threads);
+      this->n_scratch_allocations += 1;
+    }
+    for (size_t thread = 0; thread < n_threads; thread++)
+      if (this->refine_queues[thread].reset(n))
+        this->n_scratch_allocations += 1;
+  }
+
+  // The first thread refines the partition itself, on the graph itself, so
+  // that only the other threads need a replica of the graph
+  vector<MutableVertexPartition*> replicas(n_threads, NULL);
+  vector<BatchDiffMove*> batch_diff_moves(n_threads, NULL);
+  vector<size_t> refined_membership(n);
+  vector<double> improvs(constrained_comms.size(), 0.0);
+  uint64_t seed = this->random_seed();
+  size_t check_interval = std::max((size_t)1, this->check_interval);
+
+  try
+  {
+    this->replicate_graphs(graph, n_threads - 1);
+    parallel_for(n_threads, n_threads, [&](size_t thread, size_t)
+    {
+      if (thread == 0)
+        replicas[thread] = partition;
+      else
+        replicas[thread] = partition->create(this->replica_graphs[thread - 1], partition->get_membership());
+      batch_diff_moves[thread] = BatchDiffMove::create(replicas[thread]);
+      batch_diff_moves[thread]->reserve(this->scratch[thread].diffs.size());
+    });
+
+    parallel_for_dynamic(n_tasks, n_threads, [&](size_t task, size_t thread)
+    {
+      size_t c = order[task];
+      vector<size_t>& comm_nodes = constrained_comms[c];
+      MutableVertexPartition* replica = replicas[thread];
+      MoveScratch& scratch = this->scratch[thread];
+      uint64_t comm_seed = splitmix64(seed + c);
+      uint64_t move_seed = splitmix64(comm_seed);
+
+      // Shuffle the nodes using the random stream of this community
+      for (size_t idx = comm_nodes.size() - 1; idx > 0; idx--)
+        std::swap(comm_nodes[idx], comm_nodes[random_index(comm_seed, idx, idx + 1)]);
+
+      auto visit = [&](size_t v, size_t n_visits)
+      {
+        size_t comm;
+        scratch.neighbours.compute(v, replica->get_membership(), csr.out_graph(), csr.in_graph());
+        double improv = propose_constrained_move(replica, v, constrained_membership, comm_nodes,
+                                                 csr.all, batch_diff_moves[thread], scratch,
+                                                 consider_comms, max_comm_size,
+                                                 move_seed + n_visits, comm);
+        if (comm != replica->membership(v))
+        {
+          replica->move_node(v, comm);
+          improvs[c] += improv;
+          return true;
+        }
+        return false;
+      };
+
+      // Nodes that are not visited once the deadline expired stay on their own
+      if (merge_only)
+      {
+        size_t n_visits = 0;
+        for (size_t idx = 0; idx < comm_nodes.size(); idx++)
+        {
+          if (idx % check_interval == 0 && this->deadline.expired())
+            break;
+          size_t v = comm_nodes[idx];
+          if (replica->cnodes(replica->membership(v)) == 1)
+            visit(v, n_visits++);
+        }
+      }
+      else
+      {
+        NodeQueue& queue = this->refine_queues[thread];
+        for (size_t v : comm_nodes)
+          queue.push(v);
+
+        size_t n_visits = 0;
+        while (!queue.empty())
+        {
+          if (n_visits % check_interval == 0 && this->deadline.expired())
+          {
+            // Empty the queue for the next task of this thread
+            while (!queue.empty())
+              queue.pop();
+            break;
+          }
+
+          size_t v = queue.pop();
+          if (visit(v, n_visits++))
+          {
+            // Revisit neighbours in the same constrained community, but not in the new community
+            size_t comm = replica->membership(v);
+            for (typename CSR::Neighbour const& neighbour : csr.all.neighbours(v))
+            {
+              size_t u = neighbour.node;
+              if (constrained_membership[u] == c && replica->membership(u) != comm)
+                queue.push(u);
+            }
+          }
+        }
+      }
+
+      for (size_t v : comm_nodes)
+        refined_membership[v] = replica->membership(v);
+    });
+
+    // Nodes that are alone in their constrained community stay on their own
+    for (size_t task = n_tasks; task < order.size(); task++)
+      for (size_t v : constrained_comms[order[task]])
+        refined_membership[v] = v;
+  }
+  catch (...)
+  {
+    for (BatchDiffMove* batch_diff_move : batch_diff_moves)
+      delete batch_diff_move;
+    for (size_t thread = 1; thread < n_threads; thread++)
+      delete replicas[thread];
+    if (!this->keep_replica_graphs)
+      this->delete_replica_graphs();
+    throw;
+  }
+
+  for (BatchDiffMove* batch_diff_move : batch_diff_moves)
+    delete batch_diff_move;
+  for (size_t thread = 1; thread < n_threads; thread++)
+    delete replicas[thread];
+  if (!this->keep_replica_graphs)
+    this->delete_replica_graphs();
+
+  partition->set_membership(refined_membership);
+  partition->renumber_communities();
+
+  double total_improv = 0.0;
+  for (double improv : improvs)
+    total_improv += improv;
+  return total_improv;
+}
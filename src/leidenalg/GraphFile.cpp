@@ -0,0 +1,277 @@
+#include "GraphFile.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+static const char GRAPH_FILE_MAGIC[8] = {'L', 'E', 'I', 'D', 'E', 'N', 'G', 'F'};
+
+/*****************************************************************************
+  Number of bytes of a file with n nodes and m edges, or 0 if that does not
+  fit in size_t.
+*****************************************************************************/
+static size_t graph_file_size(uint64_t n, uint64_t m, bool is_weighted)
+{
+  const uint64_t max_count = SIZE_MAX/64;
+  if (n >= max_count || m >= max_count)
+    return 0;
+  return sizeof(GraphFileHeader) + sizeof(uint64_t)*(n + 1) +
+         sizeof(uint64_t)*m + (is_weighted ? sizeof(double)*m : 0) +
+         4*sizeof(double)*n;
+}
+
+GraphFile::GraphFile(string const& path)
+{
+  this->_data = NULL;
+  this->_size = 0;
+
+  #ifdef _WIN32
+    this->_mapping = NULL;
+    this->_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (this->_file == INVALID_HANDLE_VALUE)
+    {
+      this->_file = NULL;
+      throw Exception("Could not open graph file.");
+    }
+
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx((HANDLE)this->_file, &file_size) && file_size.QuadPart > 0)
+    {
+      this->_size = (size_t)file_size.QuadPart;
+      this->_mapping = CreateFileMappingA((HANDLE)this->_file, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (this->_mapping != NULL)
+        this->_data = MapViewOfFile((HANDLE)this->_mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+  #else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw Exception("Could not open graph file.");
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+    {
+      this->_size = (size_t)file_stat.st_size;
+      void* data = mmap(NULL, this->_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (data != MAP_FAILED)
+        this->_data = data;
+    }
+    // The mapping remains valid after closing the file
+    close(fd);
+  #endif
+
+  if (this->_data == NULL)
+  {
+    this->unmap();
+    throw Exception("Could not map graph file.");
+  }
+
+  // Validate the header and the size of the file
+  GraphFileHeader const* header = (GraphFileHeader const*)this->_data;
+  const char* error = NULL;
+  if (this->_size < sizeof(GraphFileHeader) || memcmp(header->magic, GRAPH_FILE_MAGIC, sizeof(GRAPH_FILE_MAGIC)) != 0)
+    error = "Not a graph file.";
+  else if (header->version != GraphFile::VERSION)
+    error = "Unsupported version of graph file.";
+  else if (header->flags & ~(uint32_t)(DIRECTED | WEIGHTED | CORRECT_SELF_LOOPS))
+    error = "Unsupported flags in graph file.";
+  else if (graph_file_size(header->n, header->m, header->flags & WEIGHTED) != this->_size)
+    error = "Size of graph file does not match its header.";
+  if (error != NULL)
+  {
+    this->unmap();
+    throw Exception(error);
+  }
+
+  size_t n = header->n;
+  size_t m = header->m;
+  char const* data = (char const*)this->_data + sizeof(GraphFileHeader);
+  this->_header = header;
+  this->_offsets = (uint64_t const*)data; data += sizeof(uint64_t)*(n + 1);
+  this->_targets = (uint64_t const*)data; data += sizeof(uint64_t)*m;
+  this->_weights = NULL;
+  if (this->is_weighted())
+  {
+    this->_weights = (double const*)data; data += sizeof(double)*m;
+  }
+  this->_node_sizes = (double const*)data; data += sizeof(double)*n;
+  this->_node_self_weights = (double const*)data; data += sizeof(double)*n;
+  this->_strength_out = (double const*)data; data += sizeof(double)*n;
+  this->_strength_in = (double const*)data;
+
+  if (this->_offsets[0] != 0 || this->_offsets[n] != m)
+  {
+    this->unmap();
+    throw Exception("Offsets of graph file do not match its number of edges.");
+  }
+}
+
+GraphFile::~GraphFile()
+{
+  this->unmap();
+}
+
+void GraphFile::unmap()
+{
+  #ifdef _WIN32
+    if (this->_data != NULL)
+      UnmapViewOfFile(this->_data);
+    if (this->_mapping != NULL)
+      CloseHandle((HANDLE)this->_mapping);
+    if (this->_file != NULL)
+      CloseHandle((HANDLE)this->_file);
+    this->_mapping = NULL;
+    this->_file = NULL;
+  #else
+    if (this->_data != NULL)
+      munmap(this->_data, this->_size);
+  #endif
+  this->_data = NULL;
+}
+
+template <class T>
+static bool write_array(FILE* file, T const* values, size_t count)
+{
+  return count == 0 || fwrite(values, sizeof(T), count, file) == count;
+}
+
+/*****************************************************************************
+  Write the graph, sorting the edges on their source with a counting sort, so
+  that the edges of each node remain in the order of their identifiers.
+*****************************************************************************/
+void GraphFile::write(Graph* graph, string const& path)
+{
+  size_t n = graph->vcount();
+  size_t m = graph->ecount();
+  const igraph_t* g = graph->get_igraph();
+
+  GraphFileHeader header;
+  memset(&header, 0, sizeof(GraphFileHeader));
+  memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(GRAPH_FILE_MAGIC));
+  header.version = GraphFile::VERSION;
+  header.flags = (graph->is_directed() ? DIRECTED : 0) |
+                 (graph->is_weighted() ? WEIGHTED : 0) |
+                 (graph->correct_self_loops() ? CORRECT_SELF_LOOPS : 0);
+  header.n = n;
+  header.m = m;
+  header.total_weight = graph->total_weight();
+  header.total_size = graph->total_size();
+
+  vector<uint64_t> offsets(n + 1, 0);
+  for (size_t e = 0; e < m; e++)
+    offsets[IGRAPH_FROM(g, e) + 1] += 1;
+  for (size_t v = 0; v < n; v++)
+    offsets[v + 1] += offsets[v];
+
+  vector<uint64_t> position(offsets.begin(), offsets.end() - 1);
+  vector<uint64_t> targets(m);
+  vector<double> weights(graph->is_weighted() ? m : 0);
+  for (size_t e = 0; e < m; e++)
+  {
+    size_t idx = position[IGRAPH_FROM(g, e)]++;
+    targets[idx] = IGRAPH_TO(g, e);
+    if (graph->is_weighted())
+      weights[idx] = graph->edge_weight(e);
+  }
+
+  vector<double> node_sizes(n);
+  vector<double> node_self_weights(n);
+  vector<double> strength_out(n);
+  vector<double> strength_in(n);
+  for (size_t v = 0; v < n; v++)
+  {
+    node_sizes[v] = graph->node_size(v);
+    node_self_weights[v] = graph->node_self_weight(v);
+    strength_out[v] = graph->strength(v, IGRAPH_OUT);
+    strength_in[v] = graph->strength(v, IGRAPH_IN);
+  }
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == NULL)
+    throw Exception("Could not open graph file for writing.");
+
+  bool is_written = write_array(file, &header, 1) &&
+                    write_array(file, offsets.data(), offsets.size()) &&
+                    write_array(file, targets.data(), targets.size()) &&
+                    write_array(file, weights.data(), weights.size()) &&
+                    write_array(file, node_sizes.data(), n) &&
+                    write_array(file, node_self_weights.data(), n) &&
+                    write_array(file, strength_out.data(), n) &&
+                    write_array(file, strength_in.data(), n);
+  is_written = (fclose(file) == 0) && is_written;
+
+  if (!is_written)
+    throw Exception("Could not write graph file.");
+}
+
+/*****************************************************************************
+  Create a Graph from the mapped arrays. The offsets and targets are checked
+  while reading them.
+*****************************************************************************/
+Graph* GraphFile::create_graph() const
+{
+  size_t n = this->vcount();
+  size_t m = this->ecount();
+
+  igraph_vector_int_t edges;
+  igraph_vector_int_init(&edges, 2*m);
+  for (size_t v = 0; v < n; v++)
+  {
+    size_t begin = this->_offsets[v];
+    size_t end = this->_offsets[v + 1];
+    if (end < begin || end > m)
+    {
+      igraph_vector_int_destroy(&edges);
+      throw Exception("Offsets of graph file are not increasing.");
+    }
+    for (size_t idx = begin; idx < end; idx++)
+    {
+      if (this->_targets[idx] >= n)
+      {
+        igraph_vector_int_destroy(&edges);
+        throw Exception("Edge of graph file to node outside of the graph.");
+      }
+      VECTOR(edges)[2*idx] = v;
+      VECTOR(edges)[2*idx + 1] = this->_targets[idx];
+    }
+  }
+
+  igraph_t* g = new igraph_t;
+  igraph_error_t status = igraph_create(g, &edges, n, this->is_directed());
+  igraph_vector_int_destroy(&edges);
+  if (status != IGRAPH_SUCCESS)
+  {
+    delete g;
+    throw Exception("Could not create graph from graph file.");
+  }
+
+  vector<double> node_sizes(this->_node_sizes, this->_node_sizes + n);
+  Graph* graph = NULL;
+  try
+  {
+    if (this->is_weighted())
+    {
+      vector<double> edge_weights(this->_weights, this->_weights + m);
+      vector<double> node_self_weights(this->_node_self_weights, this->_node_self_weights + n);
+      graph = new Graph(g, edge_weights, node_sizes, node_self_weights, this->correct_self_loops());
+    }
+    else
+      graph = Graph::GraphFromNodeSizes(g, node_sizes, this->correct_self_loops());
+  }
+  catch (...)
+  {
+    igraph_destroy(g);
+    delete g;
+    throw;
+  }
+  return graph;
+}
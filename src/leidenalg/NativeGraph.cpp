@@ -0,0 +1,179 @@
+#include "NativeGraph.h"
+
+#include <algorithm>
+#include <cmath>
+
+Graph* create_graph_from_edges(size_t n,
+                               vector<size_t> const& from,
+                               vector<size_t> const& to,
+                               vector<double> const& weights,
+                               vector<double> const& node_sizes,
+                               bool is_directed,
+                               bool correct_self_loops)
+{
+  size_t m = from.size();
+  if (to.size() != m)
+    throw Exception("Number of sources and targets of edges differ.");
+  if (!weights.empty() && weights.size() != m)
+    throw Exception("Weight vector not the same size as the number of edges.");
+  if (!node_sizes.empty() && node_sizes.size() != n)
+    throw Exception("Node size vector not the same size as the number of nodes.");
+
+  for (size_t e = 0; e < weights.size(); e++)
+  {
+    if (std::isnan(weights[e]))
+      throw Exception("Cannot accept NaN weights.");
+    if (!std::isfinite(weights[e]))
+      throw Exception("Cannot accept infinite weights.");
+  }
+
+  igraph_vector_int_t edges;
+  igraph_vector_int_init(&edges, 2*m);
+  for (size_t e = 0; e < m; e++)
+  {
+    if (from[e] >= n || to[e] >= n)
+    {
+      igraph_vector_int_destroy(&edges);
+      throw Exception("Edge to node outside of the graph.");
+    }
+    VECTOR(edges)[2*e] = from[e];
+    VECTOR(edges)[2*e + 1] = to[e];
+  }
+
+  igraph_t* g = new igraph_t;
+  igraph_error_t status = igraph_create(g, &edges, n, is_directed);
+  igraph_vector_int_destroy(&edges);
+  if (status != IGRAPH_SUCCESS)
+  {
+    delete g;
+    throw Exception("Could not create graph from edges.");
+  }
+
+  Graph* graph = NULL;
+  try
+  {
+    if (!node_sizes.empty())
+    {
+      if (!weights.empty())
+        graph = new Graph(g, weights, node_sizes, correct_self_loops);
+      else
+        graph = Graph::GraphFromNodeSizes(g, node_sizes, correct_self_loops);
+    }
+    else
+    {
+      if (!weights.empty())
+        graph = Graph::GraphFromEdgeWeights(g, weights, correct_self_loops);
+      else
+        graph = new Graph(g, correct_self_loops);
+    }
+  }
+  catch (...)
+  {
+    igraph_destroy(g);
+    delete g;
+    throw;
+  }
+  return graph;
+}
+
+Graph* create_graph_with_delta(Graph* graph,
+                               size_t n,
+                               vector<size_t> const& added_from,
+                               vector<size_t> const& added_to,
+                               vector<double> const& added_weights,
+                               vector<size_t> const& removed_from,
+                               vector<size_t> const& removed_to)
+{
+  size_t n_old = graph->vcount();
+  size_t m_old = graph->ecount();
+  bool is_directed = graph->is_directed();
+
+  if (n < n_old)
+    throw Exception("Nodes cannot be removed from a graph.");
+  if (added_to.size() != added_from.size() || removed_to.size() != removed_from.size())
+    throw Exception("Number of sources and targets of edges differ.");
+  if (!added_weights.empty() && added_weights.size() != added_from.size())
+    throw Exception("Weight vector not the same size as the number of added edges.");
+
+  // Number of edges to remove between each pair of end points, ordered by
+  // the end points, which are ordered themselves for undirected graphs.
+  vector< pair<size_t, size_t> > removed;
+  removed.reserve(removed_from.size());
+  for (size_t idx = 0; idx < removed_from.size(); idx++)
+  {
+    size_t from = removed_from[idx];
+    size_t to = removed_to[idx];
+    if (!is_directed && to < from)
+      std::swap(from, to);
+    removed.push_back(std::make_pair(from, to));
+  }
+  std::sort(removed.begin(), removed.end());
+  vector<size_t> n_removed(removed.size(), 0);
+  size_t n_pairs = 0;
+  for (size_t idx = 0; idx < removed.size(); idx++)
+  {
+    if (n_pairs == 0 || removed[idx] != removed[n_pairs - 1])
+      removed[n_pairs++] = removed[idx];
+    n_removed[n_pairs - 1] += 1;
+  }
+  removed.resize(n_pairs);
+
+  bool is_weighted = graph->is_weighted() || !added_weights.empty();
+  size_t m = m_old + added_from.size();
+  vector<size_t> from;
+  vector<size_t> to;
+  vector<double> weights;
+  from.reserve(m);
+  to.reserve(m);
+  if (is_weighted)
+    weights.reserve(m);
+
+  igraph_t const* g = graph->get_igraph();
+  for (size_t e = 0; e < m_old; e++)
+  {
+    size_t v = IGRAPH_FROM(g, e);
+    size_t u = IGRAPH_TO(g, e);
+    if (!removed.empty())
+    {
+      pair<size_t, size_t> key = (!is_directed && u < v) ? std::make_pair(u, v) : std::make_pair(v, u);
+      vector< pair<size_t, size_t> >::iterator it = std::lower_bound(removed.begin(), removed.end(), key);
+      if (it != removed.end() && *it == key && n_removed[it - removed.begin()] > 0)
+      {
+        n_removed[it - removed.begin()] -= 1;
+        continue;
+      }
+    }
+    from.push_back(v);
+    to.push_back(u);
+    if (is_weighted)
+      weights.push_back(graph->edge_weight(e));
+  }
+
+  for (size_t idx = 0; idx < n_pairs; idx++)
+    if (n_removed[idx] > 0)
+      throw Exception("Removed edge is not in the graph.");
+
+  from.insert(from.end(), added_from.begin(), added_from.end());
+  to.insert(to.end(), added_to.begin(), added_to.end());
+  if (is_weighted)
+  {
+    if (added_weights.empty())
+      weights.resize(from.size(), 1.0);
+    else
+      weights.insert(weights.end(), added_weights.begin(), added_weights.end());
+  }
+
+  vector<double> node_sizes(n, 1.0);
+  for (size_t v = 0; v < n_old; v++)
+    node_sizes[v] = graph->node_size(v);
+
+  return create_graph_from_edges(n, from, to, weights, node_sizes, is_directed, graph->correct_self_loops());
+}
+
+void delete_native_graph(Graph* graph)
+{
+  igraph_t* g = (igraph_t*)graph->get_igraph();
+  delete graph;
+  igraph_destroy(g);
+  delete g;
+}
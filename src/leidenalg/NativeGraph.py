@@ -0,0 +1,193 @@
+import os
+from . import _c_leiden
+from .functions import _get_py_capsule, _as_buffer_or_list
+
+class NativeGraph(object):
+  """ Graph that is only held by the C++ extension, without an igraph Graph.
+
+  Constructing an :class:`ig.Graph` and a partition on it can take much
+  longer than the optimisation itself for very large graphs. A
+  :class:`NativeGraph` is read directly from a binary graph file (see
+  :func:`from_file`) or created from arrays of edges (see :func:`from_edges`),
+  and can be optimised using :func:`Optimiser.optimise_graph`, which returns
+  the membership instead of a partition.
+
+  Binary graph files are versioned, and contain the graph in compressed
+  sparse row format, together with the edge weights, node sizes and
+  precomputed strengths. The file is memory-mapped read-only, so that several
+  processes reading the same file share a single copy of it in memory. Files
+  are written in the native byte order of the machine.
+
+  Edges are stored ordered by their source node, so the edges of a graph read
+  from a file may be in a different order than in the graph that was written.
+  The nodes are the same.
+
+  Examples
+  --------
+  >>> G = ig.Graph.Famous('Zachary')
+  >>> NativeGraph.write_file(G, 'zachary.graph')
+  >>> graph = NativeGraph.from_file('zachary.graph')
+  >>> membership, quality = Optimiser().optimise_graph(graph, ModularityVertexPartition)
+
+  Graphs can also be created from NumPy arrays, for example read from Arrow or
+  Parquet files, without constructing an igraph Graph:
+
+  >>> sources = np.array([0, 1, 2, 0])
+  >>> targets = np.array([1, 2, 0, 3])
+  >>> graph = NativeGraph.from_edges(4, sources, targets)
+  """
+  def __init__(self, graph):
+    """ Use :func:`from_file` or :func:`from_edges` to construct a graph. """
+    self._graph = graph
+
+  @classmethod
+  def from_file(cls, path):
+    """ Read a graph from a binary graph file.
+
+    Parameters
+    ----------
+    path : str or path-like
+      The file to read, as written by :func:`write_file`.
+
+    Returns
+    -------
+    :class:`NativeGraph`
+      The graph.
+    """
+    return cls(_c_leiden._new_NativeGraph_from_file(os.fspath(path)))
+
+  @classmethod
+  def from_edges(cls, n, sources, targets, weights=None, node_sizes=None, directed=False, correct_self_loops=False):
+    """ Create a graph from arrays of edges.
+
+    Arrays that support the buffer protocol, such as NumPy arrays, are read
+    directly by the extension, without converting them to Python objects.
+    Edge ``e`` runs from ``sources[e]`` to ``targets[e]``, and keeps ``e`` as
+    its identifier.
+
+    Parameters
+    ----------
+    n : int
+      Number of nodes.
+    sources : array or list of int
+      Source node of each edge.
+    targets : array or list of int
+      Target node of each edge.
+    weights : array or list of double
+      Weights of edges. All edges have weight 1 if not given. Weights should
+      be non-negative for quality functions that require it.
+    node_sizes : array or list of double
+      Sizes of nodes, which are used by some quality functions. All nodes have
+      size 1 if not given.
+    directed : bool
+      Whether the graph is directed.
+    correct_self_loops : bool
+      Whether to correct for self-loops, as in :class:`CPMVertexPartition`.
+
+    Returns
+    -------
+    :class:`NativeGraph`
+      The graph.
+    """
+    sources = _as_buffer_or_list(sources)
+    targets = _as_buffer_or_list(targets)
+    if weights is not None:
+      weights = _as_buffer_or_list(weights)
+    if node_sizes is not None:
+      node_sizes = _as_buffer_or_list(node_sizes)
+    return cls(_c_leiden._new_NativeGraph_from_edges(
+        n, sources, targets, weights, node_sizes, directed, correct_self_loops))
+
+  def apply_edge_delta(self, added_sources=(), added_targets=(), added_weights=None,
+                       removed_sources=(), removed_targets=(), n=None):
+    """ Create a new graph in which some edges are added and removed.
+
+    The graph itself is not changed, and the new graph is created in time
+    linear in its size. Together with
+    :func:`Optimiser.optimise_graph_changed_nodes` this allows to update a
+    clustering when only few edges of a graph change.
+
+    Parameters
+    ----------
+    added_sources, added_targets : array or list of int
+      End points of the edges to add, which are appended after the remaining
+      edges.
+    added_weights : array or list of double
+      Weights of the added edges. Added edges have weight 1 if not given.
+    removed_sources, removed_targets : array or list of int
+      End points of the edges to remove. Every pair removes a single edge
+      between these nodes, in either direction for undirected graphs.
+    n : int
+      Number of nodes of the new graph, which may be larger than that of this
+      graph to add nodes. If :obj:`None`, the number of nodes stays the same.
+
+    Returns
+    -------
+    :class:`NativeGraph`
+      The new graph.
+
+    Examples
+    --------
+    >>> new_graph = graph.apply_edge_delta(added_sources=[0], added_targets=[33],
+    ...                                    removed_sources=[0], removed_targets=[1])
+    >>> membership, quality = Optimiser().optimise_graph_changed_nodes(
+    ...     new_graph, ModularityVertexPartition, membership, changed_nodes=[0, 1, 33])
+    """
+    if added_weights is not None:
+      added_weights = _as_buffer_or_list(added_weights)
+    return NativeGraph(_c_leiden._NativeGraph_apply_edge_delta(
+        self._graph,
+        -1 if n is None else n,
+        _as_buffer_or_list(added_sources),
+        _as_buffer_or_list(added_targets),
+        added_weights,
+        _as_buffer_or_list(removed_sources),
+        _as_buffer_or_list(removed_targets)))
+
+  @staticmethod
+  def write_file(graph, path, weights=None, node_sizes=None, correct_self_loops=False):
+    """ Write an igraph Graph to a binary graph file.
+
+    Parameters
+    ----------
+    graph : :class:`ig.Graph` or :class:`NativeGraph`
+      The graph to write.
+    path : str or path-like
+      The file to write.
+    weights : list of double, or edge attribute
+      Weights of edges. Can be either an iterable or an edge attribute. Not
+      used for a :class:`NativeGraph`.
+    node_sizes : list of int, or vertex attribute
+      Sizes of nodes, which are used by some quality functions. Not used for a
+      :class:`NativeGraph`.
+    correct_self_loops : bool
+      Whether to correct for self-loops, as in :class:`CPMVertexPartition`.
+      Not used for a :class:`NativeGraph`.
+    """
+    path = os.fspath(path)
+    if isinstance(graph, NativeGraph):
+      _c_leiden._NativeGraph_write_file(graph._graph, path)
+      return
+
+    if weights is not None:
+      if isinstance(weights, str):
+        weights = graph.es[weights]
+      weights = _as_buffer_or_list(weights)
+    if node_sizes is not None:
+      if isinstance(node_sizes, str):
+        node_sizes = graph.vs[node_sizes]
+      node_sizes = _as_buffer_or_list(node_sizes)
+
+    _c_leiden._write_graph_file(_get_py_capsule(graph), path, weights, node_sizes, correct_self_loops)
+
+  def vcount(self):
+    """ Number of nodes. """
+    return _c_leiden._NativeGraph_vcount(self._graph)
+
+  def ecount(self):
+    """ Number of edges. """
+    return _c_leiden._NativeGraph_ecount(self._graph)
+
+  def is_directed(self):
+    """ Whether the graph is directed. """
+    return _c_leiden._NativeGraph_is_directed(self._graph)
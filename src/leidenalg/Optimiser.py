@@ -1,7 +1,64 @@
 from . import _c_leiden
 from .VertexPartition import LinearResolutionParameterVertexPartition
-from collections import namedtuple
+from .functions import _as_buffer_or_list
+from copy import deepcopy
 from math import log, sqrt
+import os
+import time
+
+class PartitionHierarchy(object):
+  """ Nested partitions at each level of the hierarchy, as returned by
+  :func:`Optimiser.optimise_partition_hierarchical`.
+
+  Only the mapping from the communities of each level to the communities of
+  the next level is stored, rather than a partition for each level. Accessing
+  a level, for example ``hierarchy[-1]`` for the final level, constructs a
+  partition of the same type and on the same graph as the partition that was
+  optimised. Use :func:`membership` to only obtain the membership.
+  """
+  def __init__(self, hierarchy, partition):
+    self._hierarchy = hierarchy
+    self._partition = partition
+
+  def __len__(self):
+    return _c_leiden._PartitionHierarchy_get_n_levels(self._hierarchy)
+
+  def __getitem__(self, level):
+    if isinstance(level, slice):
+      return [self[l] for l in range(*level.indices(len(self)))]
+    partition = deepcopy(self._partition)
+    partition.set_membership(self.membership(level))
+    return partition
+
+  def __iter__(self):
+    for level in range(len(self)):
+      yield self[level]
+
+  def membership(self, level):
+    """ Membership of all nodes at the given level.
+
+    Parameters
+    ----------
+    level : int
+      The level, where negative levels count from the last level.
+
+    Returns
+    -------
+    memoryview
+      The membership, which can be converted to a NumPy array without
+      copying using ``numpy.asarray``.
+    """
+    n_levels = len(self)
+    if level < 0:
+      level += n_levels
+    if level < 0 or level >= n_levels:
+      raise IndexError('Level does not exist in hierarchy.')
+    return _c_leiden._PartitionHierarchy_get_membership(self._hierarchy, level)
+
+  @property
+  def memory_usage(self):
+    """ Number of bytes used to store the hierarchy. """
+    return _c_leiden._PartitionHierarchy_get_memory_usage(self._hierarchy)
 
 class Optimiser(object):
   r""" Class for doing community detection using the Leiden algorithm.
@@ -49,6 +106,10 @@ class Optimiser(object):
   refinement, you essentially get the Louvain algorithm with a fast local move.
   Finally, the Optimiser class provides a routine to construct a
   :func:`resolution_profile` on a resolution parameter.
+  The optimisation routines release the Python GIL while running, so that
+  independent partitions can be optimised concurrently from multiple Python
+  threads. Each thread should then use its own :class:`Optimiser`, and a
+  partition should not be used by other threads while it is being optimised.
   References
   ----------
   .. [1] Traag, V.A., Waltman. L., Van Eck, N.-J. (2018). From Louvain to
@@ -62,6 +123,7 @@ class Optimiser(object):
   def __init__(self):
     """ Create a new Optimiser object """
     self._optimiser = _c_leiden._new_Optimiser()
+    self._converged = False
   #########################################################3
   # consider_comms
   @property
@@ -192,6 +254,216 @@ class Optimiser(object):
     if value < 0:
         raise ValueError("negative max_comm_size: %s" % value)
     _c_leiden._Optimiser_set_max_comm_size(self._optimiser, value)
+
+  #########################################################3
+  # n_threads
+  @property
+  def n_threads(self):
+    """ Number of threads used for moving nodes.
+    By default (one), nodes are moved using a single thread. If this is set to
+    a larger value, nodes are evaluated in parallel, which is only used when
+    optimising a single partition. Setting this to zero uses all available
+    hardware threads. For a given seed, the result does not depend on the
+    number of threads, but it may differ from the single-threaded result.
+    """
+    return _c_leiden._Optimiser_get_n_threads(self._optimiser)
+  @n_threads.setter
+  def n_threads(self, value):
+    if value < 0:
+        raise ValueError("negative n_threads: %s" % value)
+    _c_leiden._Optimiser_set_n_threads(self._optimiser, value)
+
+  #########################################################3
+  # use_queue
+  @property
+  def use_queue(self):
+    """ boolean: if ``True`` only revisit nodes whose neighbourhood changed when
+    moving nodes.
+    Nodes are then kept in a queue, and only the neighbours of a node that
+    moved are queued again, instead of repeatedly visiting all nodes until no
+    node moves anymore. When using multiple threads (see :attr:`n_threads`) a
+    queue is always used.
+    """
+    return _c_leiden._Optimiser_get_use_queue(self._optimiser)
+  @use_queue.setter
+  def use_queue(self, value):
+    _c_leiden._Optimiser_set_use_queue(self._optimiser, int(value))
+
+  #########################################################3
+  # compact_indices
+  @property
+  def compact_indices(self):
+    """ boolean: if ``True`` use a compact layout of the neighbourhoods when
+    moving nodes using a queue (see :attr:`use_queue`) or multiple threads
+    (see :attr:`n_threads`).
+    Node ids are then stored using 32 bits instead of 64 bits, and edge
+    weights as single instead of double precision if that represents all
+    weights exactly. This halves the memory used by the neighbourhoods, and
+    gives exactly the same results. Graphs that do not fit in 32-bit ids use
+    the full layout.
+    """
+    return _c_leiden._Optimiser_get_compact_indices(self._optimiser)
+  @compact_indices.setter
+  def compact_indices(self, value):
+    _c_leiden._Optimiser_set_compact_indices(self._optimiser, int(value))
+
+  #########################################################3
+  # check_interval
+  @property
+  def check_interval(self):
+    """ int: number of nodes visited between checks of the time limit (see
+    the ``timeout`` of :func:`optimise_partition`) and of :func:`cancel`.
+    Checking is cheap, but not free, and a smaller interval stops more
+    promptly. This is only checked when using a queue (see
+    :attr:`use_queue`) or multiple threads (see :attr:`n_threads`);
+    otherwise the optimisation can only stop between the levels of the
+    aggregated graphs. The default is 1000.
+    """
+    return _c_leiden._Optimiser_get_check_interval(self._optimiser)
+  @check_interval.setter
+  def check_interval(self, value):
+    _c_leiden._Optimiser_set_check_interval(self._optimiser, int(value))
+
+  #########################################################3
+  # profiling
+  @property
+  def profiling(self):
+    """ boolean: if ``True`` record counters and timings of every level of
+    :func:`optimise_partition`, see :attr:`profile`.
+    This is only recorded when using a queue (see :attr:`use_queue`) or
+    multiple threads (see :attr:`n_threads`), and costs nothing when
+    disabled, which is the default.
+    """
+    return _c_leiden._Optimiser_get_profiling(self._optimiser)
+  @profiling.setter
+  def profiling(self, value):
+    _c_leiden._Optimiser_set_profiling(self._optimiser, int(value))
+
+  #########################################################3
+  # n_visits, n_moves
+  @property
+  def n_visits(self):
+    """ Number of nodes visited when moving nodes.
+    This is only counted when using a queue (see :attr:`use_queue`) or multiple
+    threads (see :attr:`n_threads`), and accumulates over calls.
+    """
+    return _c_leiden._Optimiser_get_n_visits(self._optimiser)
+
+  @property
+  def n_moves(self):
+    """ Number of nodes moved when moving nodes.
+    This is only counted when using a queue (see :attr:`use_queue`) or multiple
+    threads (see :attr:`n_threads`), and accumulates over calls.
+    """
+    return _c_leiden._Optimiser_get_n_moves(self._optimiser)
+
+  @property
+  def n_diff_moves(self):
+    """ Number of moves evaluated when moving nodes and refining, i.e. the
+    number of candidate communities for which the difference in quality was
+    computed.
+    This is only counted when using a queue (see :attr:`use_queue`) or multiple
+    threads (see :attr:`n_threads`), and accumulates over calls.
+    """
+    return _c_leiden._Optimiser_get_n_diff_moves(self._optimiser)
+
+  @property
+  def n_scratch_allocations(self):
+    """ Number of times the buffers used for moving nodes had to be allocated.
+    When using a queue (see :attr:`use_queue`) or multiple threads (see
+    :attr:`n_threads`), these buffers are kept by the optimiser and reused, so
+    that visiting a node does not allocate memory. They are only allocated
+    again when a larger graph is encountered. This accumulates over calls.
+    """
+    return _c_leiden._Optimiser_get_n_scratch_allocations(self._optimiser)
+
+  @property
+  def converged(self):
+    """ boolean: whether the last call to :func:`optimise_partition` or
+    :func:`optimise_graph` converged, meaning that its last iteration did not
+    improve the partition, rather than stopping because the number of
+    iterations was reached, the time limit expired, or it was cancelled. For
+    :func:`optimise_ensemble` this holds if all runs converged.
+    """
+    return self._converged
+
+  def cancel(self):
+    """ Cancel a running optimisation.
+    This may be called from another thread while :func:`optimise_partition`
+    or :func:`optimise_graph` runs, which then stops soon afterwards (see
+    :attr:`check_interval`), and returns the partition found so far, with
+    :attr:`converged` set to ``False``. Pressing Ctrl-C cancels the
+    optimisation in the same way, after which ``KeyboardInterrupt`` is
+    raised.
+
+    Only the call that is running is cancelled: every call of the optimiser
+    starts afresh, without the cancellation or the timeout of an earlier
+    call. Calling :func:`cancel` while the optimiser is idle has no effect.
+    """
+    _c_leiden._Optimiser_cancel(self._optimiser)
+
+  @property
+  def profile(self):
+    """ dict: counters and timings recorded while :attr:`profiling`.
+    The entry ``'levels'`` is a list with a dict for every level of every
+    iteration of :func:`optimise_partition`, in order, containing
+
+    - ``level``: the level within the iteration, starting at 0,
+    - ``n_nodes``, ``n_edges``: the size of the graph of the level,
+    - ``n_communities_before``, ``n_communities_after``: the number of
+      communities before and after moving nodes,
+    - ``n_visits``, ``n_moves``, ``n_diff_moves``: see :attr:`n_visits`,
+      :attr:`n_moves` and :attr:`n_diff_moves`,
+    - ``move_time``, ``refine_time``, ``collapse_time``: the wall time in
+      seconds of moving nodes, refining the partition and aggregating the
+      graph,
+    - ``n_aggregate_nodes``, ``n_aggregate_edges``: the size of the
+      aggregate graph.
+
+    The other entries are the totals of the counters and times over all
+    levels. The profile accumulates over calls, until :func:`clear_profile`
+    is called.
+
+    Examples
+    --------
+    >>> G = ig.Graph.Famous('Zachary')
+    >>> optimiser = la.Optimiser()
+    >>> optimiser.use_queue = True
+    >>> optimiser.profiling = True
+    >>> partition = la.ModularityVertexPartition(G)
+    >>> diff = optimiser.optimise_partition(partition)
+    >>> profile = optimiser.profile
+    >>> profile['levels'][0]['n_nodes']
+    34
+    """
+    levels = _c_leiden._Optimiser_get_profile(self._optimiser)
+    profile = {'levels': levels}
+    for key in ['n_visits', 'n_moves', 'n_diff_moves', 'move_time', 'refine_time', 'collapse_time']:
+      profile[key] = sum(level[key] for level in levels)
+    return profile
+
+  def clear_profile(self):
+    """ Remove all levels recorded in :attr:`profile`. """
+    _c_leiden._Optimiser_clear_profile(self._optimiser)
+
+  @property
+  def arena_peak_bytes(self):
+    """ Peak number of bytes held by the buffers for aggregating the graph.
+    When using a queue (see :attr:`use_queue`) or multiple threads (see
+    :attr:`n_threads`), the buffers that are needed to aggregate the graph are
+    kept by the optimiser and reused for every level and every call. This
+    does not include the aggregate graphs and partitions themselves.
+    """
+    return _c_leiden._Optimiser_get_arena_peak_bytes(self._optimiser)
+
+  @property
+  def arena_bytes_allocated(self):
+    """ Total number of bytes allocated for aggregating the graph.
+    See :attr:`arena_peak_bytes`. Since the buffers are reused, this only
+    increases when a larger graph is aggregated than before. This accumulates
+    over calls.
+    """
+    return _c_leiden._Optimiser_get_arena_bytes_allocated(self._optimiser)
   ##########################################################
   # Set rng seed
   def set_rng_seed(self, value):
@@ -221,9 +493,9 @@ class Optimiser(object):
       which there was no improvement.
     Returns
     -------
-    list of :class:`VertexPartition`
-      A list of all intermediate partitions, where the last one is the final
-      optimised partition.
+    :class:`PartitionHierarchy`
+      All intermediate partitions, where the last one is the final optimised
+      partition. Partitions are only constructed when a level is accessed.
     """
     # For now, n_iterations is handled entirely by the C++ implementation,
     # which runs until no further improvement is possible.
@@ -238,15 +510,10 @@ class Optimiser(object):
         layer_weights,
         is_membership_fixed
     )
-    
-    # The returned hierarchy is a list of C++ partition objects.
-    # We need to convert them back to Python objects.
-    from .VertexPartition import MutableVertexPartition
-    py_hierarchy = [MutableVertexPartition._FromCPartition(p) for p in hierarchy]
 
-    return py_hierarchy
+    return PartitionHierarchy(hierarchy, partition)
 
-  def optimise_partition(self, partition, n_iterations=2, is_membership_fixed=None):
+  def optimise_partition(self, partition, n_iterations=2, is_membership_fixed=None, timeout=None):
     """ Optimise the given partition.
     This function optimises the partition using the Leiden algorithm. It is the
     main function that repeatedly calls the subroutines for moving nodes and
@@ -262,30 +529,325 @@ class Optimiser(object):
     is_membership_fixed: list of boolean
       For each node a boolean indicating if its membership is fixed. If it is
       fixed, it can no longer be changed.
+    timeout : double
+      Time limit in seconds. Once it has passed, the optimisation stops and
+      the partition found so far is returned, which is always a valid
+      partition, with :attr:`converged` set to ``False``. If :obj:`None`
+      there is no time limit.
     Returns
     -------
     double
       The difference in quality function.
+    Notes
+    -----
+    The optimisation can be interrupted with Ctrl-C, which raises
+    ``KeyboardInterrupt`` and leaves the partition as found so far.
     """
+    self._converged = False
+    _c_leiden._Optimiser_set_timeout(self._optimiser, -1.0 if timeout is None else max(timeout, 0.0))
     itr = 0
     diff = 0
     continue_iteration = itr < n_iterations or n_iterations < 0
-    while continue_iteration:
-      diff_inc = _c_leiden._Optimiser_optimise_partition(
-              self._optimiser,
-              partition._partition,
-              is_membership_fixed=is_membership_fixed,
-              )
-      diff += diff_inc
-      itr += 1
-      if n_iterations < 0:
-        continue_iteration = (diff_inc > 0)
-      else:
-        continue_iteration = itr < n_iterations
+    try:
+      while continue_iteration:
+        diff_inc = _c_leiden._Optimiser_optimise_partition(
+                self._optimiser,
+                partition._partition,
+                is_membership_fixed=is_membership_fixed,
+                )
+        diff += diff_inc
+        itr += 1
+        if _c_leiden._Optimiser_has_expired(self._optimiser):
+          break
+        self._converged = (diff_inc <= 0)
+        if n_iterations < 0:
+          continue_iteration = not self._converged
+        else:
+          continue_iteration = itr < n_iterations
+    finally:
+      partition._update_internal_membership()
+    return diff
+
+  def optimise_graph(self, graph, partition_type, initial_membership=None, n_iterations=2, resolution_parameter=1.0, timeout=None):
+    """ Optimise a partition of a :class:`NativeGraph`.
+    This runs the same optimisation as :func:`optimise_partition`, on a
+    partition that only exists in the C++ extension, so that no
+    :class:`ig.Graph` is needed.
+    Parameters
+    ----------
+    graph : :class:`NativeGraph`
+      The graph to optimise a partition for.
+    partition_type : :class:`VertexPartition`
+      Type of partition to use, for example :class:`CPMVertexPartition`.
+      Partitions are constructed with their default settings, apart from the
+      resolution parameter.
+    initial_membership : list of int
+      Initial membership for the partition. If :obj:`None` then defaults to a
+      singleton partition.
+    n_iterations : int
+      Number of iterations to run the Leiden algorithm, see
+      :func:`optimise_partition`.
+    resolution_parameter : double
+      Resolution parameter, for partition types that have one.
+    timeout : double
+      Time limit in seconds, see :func:`optimise_partition`.
+    Returns
+    -------
+    (memoryview, double)
+      The membership of the optimised partition, which can be converted to a
+      NumPy array without copying using ``numpy.asarray``, and its quality.
+    """
+    method = partition_type.__name__
+    if method.endswith('VertexPartition'):
+      method = method[:-len('VertexPartition')]
+    if initial_membership is not None:
+      initial_membership = _as_buffer_or_list(initial_membership)
+    self._converged = False
+    _c_leiden._Optimiser_set_timeout(self._optimiser, -1.0 if timeout is None else max(timeout, 0.0))
+    membership, quality, self._converged = _c_leiden._Optimiser_optimise_graph(
+        self._optimiser,
+        graph._graph,
+        method,
+        initial_membership=initial_membership,
+        resolution_parameter=resolution_parameter,
+        n_iterations=n_iterations)
+    return membership, quality
+
+  def optimise_ensemble(self, partition, n_starts=20, n_threads=None, n_iterations=2, timeout=None):
+    """ Optimise the given partition several times, and keep the best result.
+    The result of :func:`optimise_partition` depends on the random seed, so
+    that it is common to optimise a partition several times and keep the
+    partition with the highest quality. This runs these optimisations in
+    parallel without holding the GIL, using a single copy of the graph for
+    all runs of a thread, instead of converting the graph for every run.
+    Every run starts from the membership of ``partition``, using its own
+    seed, and with the settings of this optimiser (but a single thread per
+    run). The seeds are drawn from this optimiser, so that the result is
+    reproducible using :func:`set_rng_seed`, regardless of ``n_threads``.
+    Parameters
+    ----------
+    partition : :class:`VertexPartition`
+      The partition to optimise, which determines the graph and the quality
+      function. Afterwards it holds the best partition that was found.
+    n_starts : int
+      Number of independent runs.
+    n_threads : int
+      Number of threads to use. If :obj:`None`, the number of CPUs is used.
+    n_iterations : int
+      Number of iterations of every run, see :func:`optimise_partition`.
+    timeout : double
+      Time limit in seconds for all runs together, see
+      :func:`optimise_partition`.
+    Returns
+    -------
+    list of dict
+      Statistics of every run, in the order of their seeds, with the
+      ``seed``, the ``quality`` and ``n_communities`` of the resulting
+      partition, the number of iterations ``n_iterations``, whether the run
+      ``converged``, and the wall ``time`` in seconds.
+    Examples
+    --------
+    >>> G = ig.Graph.Famous('Zachary')
+    >>> optimiser = la.Optimiser()
+    >>> optimiser.set_rng_seed(42)
+    >>> partition = la.ModularityVertexPartition(G)
+    >>> runs = optimiser.optimise_ensemble(partition, n_starts=10)
+    >>> len(runs)
+    10
+    """
+    if n_threads is None:
+      n_threads = os.cpu_count() or 1
+    self._converged = False
+    _c_leiden._Optimiser_set_timeout(self._optimiser, -1.0 if timeout is None else max(timeout, 0.0))
+    try:
+      quality, runs = _c_leiden._Optimiser_optimise_ensemble(
+          self._optimiser,
+          partition._partition,
+          n_starts=n_starts,
+          n_threads=n_threads,
+          n_iterations=n_iterations)
+    finally:
+      partition._update_internal_membership()
+    self._converged = all(run['converged'] for run in runs)
+    return runs
+
+  def optimise_consensus(self, partition, memberships, n_threads=None, max_rounds=10, threshold=0.0, timeout=None):
+    """ Find a consensus of several memberships of the graph of a partition.
+    Every edge is weighted by the fraction of the memberships that put its
+    end points in the same community. This weighted consensus graph is then
+    partitioned again, as often as there are memberships and with the quality
+    function of ``partition``, and the agreement of these new memberships is
+    computed again. This is repeated until all memberships agree on every
+    edge, or for at most ``max_rounds`` rounds. Everything runs in parallel
+    without holding the GIL. Since the consensus graph is weighted, the
+    quality function should support edge weights.
+    Parameters
+    ----------
+    partition : :class:`VertexPartition`
+      The partition that determines the graph and the quality function.
+      Afterwards it holds the final membership with the highest quality.
+    memberships : list of list of int
+      The memberships to combine, for example of several runs of
+      :func:`optimise_partition` with different seeds.
+    n_threads : int
+      Number of threads to use. If :obj:`None`, the number of CPUs is used.
+    max_rounds : int
+      Maximum number of times the consensus graph is partitioned. If 0, only
+      the agreement of ``memberships`` is computed.
+    threshold : double
+      Edges with an agreement of at most this value are left out of the
+      consensus graph.
+    timeout : double
+      Time limit in seconds, see :func:`optimise_partition`.
+    Returns
+    -------
+    dict
+      The ``quality`` of the resulting partition, the number of rounds
+      ``n_rounds``, whether the memberships became ``stable``, i.e. agree on
+      every edge, and the ``agreement`` of the final memberships on every edge.
+    Examples
+    --------
+    >>> G = ig.Graph.Famous('Zachary')
+    >>> optimiser = la.Optimiser()
+    >>> memberships = []
+    >>> for seed in range(5):
+    ...   optimiser.set_rng_seed(seed)
+    ...   partition = la.ModularityVertexPartition(G)
+    ...   diff = optimiser.optimise_partition(partition)
+    ...   memberships.append(partition.membership)
+    >>> partition = la.ModularityVertexPartition(G)
+    >>> result = optimiser.optimise_consensus(partition, memberships)
+    """
+    if n_threads is None:
+      n_threads = os.cpu_count() or 1
+    self._converged = False
+    _c_leiden._Optimiser_set_timeout(self._optimiser, -1.0 if timeout is None else max(timeout, 0.0))
+    try:
+      quality, n_rounds, stable, agreement = _c_leiden._Optimiser_optimise_consensus(
+          self._optimiser,
+          partition._partition,
+          list(memberships),
+          n_threads=n_threads,
+          max_rounds=max_rounds,
+          threshold=threshold)
+    finally:
+      partition._update_internal_membership()
+    self._converged = stable
+    return {'quality': quality,
+            'n_rounds': n_rounds,
+            'stable': stable,
+            'agreement': agreement}
+
+  def is_locally_optimal(self, partition, is_membership_fixed=None):
+    """ Check whether any node can improve the partition by moving.
+    This does not change the partition. It evaluates, for every node that is
+    not fixed, moving it to each of its neighbouring communities (and to an
+    empty community if :attr:`consider_empty_community` is set), and stops at
+    the first move that improves the quality. This is much cheaper than
+    checking whether another iteration of :func:`optimise_partition` improves
+    the partition, and uses :attr:`n_threads` threads.
+    Parameters
+    ----------
+    partition : :class:`VertexPartition`
+      The partition to check.
+    is_membership_fixed: list of boolean
+      For each node a boolean indicating if its membership is fixed. Fixed
+      nodes are not checked.
+    Returns
+    -------
+    bool
+      Whether no node can improve the partition by moving.
+    Examples
+    --------
+    >>> G = ig.Graph.Famous('Zachary')
+    >>> optimiser = la.Optimiser()
+    >>> partition = la.ModularityVertexPartition(G)
+    >>> optimiser.is_locally_optimal(partition)
+    False
+    """
+    return _c_leiden._Optimiser_is_locally_optimal(
+        self._optimiser,
+        partition._partition,
+        is_membership_fixed=is_membership_fixed)
 
+  def optimise_changed_nodes(self, partition, changed_nodes, is_membership_fixed=None):
+    """ Optimise only the nodes near edges that were added or removed.
+    This is much faster than :func:`optimise_partition` when only a small
+    part of the graph changed. The partition should be a partition of the
+    new graph, created with the membership from before the change. Only the
+    changed nodes and the other nodes in their communities are moved, starting
+    from the given membership. Communities of changed nodes that are no longer
+    connected are first split into their connected components. The graph is
+    not aggregated, so the result can be worse than optimising from scratch,
+    which may still be done occasionally.
+    Note that the partition itself is not updated incrementally: creating the
+    partition of the new graph takes time linear in the size of the graph.
+    Parameters
+    ----------
+    partition : :class:`VertexPartition`
+      The partition to update.
+    changed_nodes : list of int
+      The end points of the edges that were added or removed.
+    is_membership_fixed: list of boolean
+      For each node a boolean indicating if its membership is fixed. If it is
+      fixed, it can no longer be changed.
+    Returns
+    -------
+    double
+      The difference in quality function.
+    Examples
+    --------
+    >>> G = ig.Graph.Famous('Zachary')
+    >>> optimiser = la.Optimiser()
+    >>> partition = la.ModularityVertexPartition(G)
+    >>> diff = optimiser.optimise_partition(partition)
+    >>> G.add_edges([(0, 33)])
+    >>> partition = la.ModularityVertexPartition(G, initial_membership=partition.membership)
+    >>> diff = optimiser.optimise_changed_nodes(partition, [0, 33])
+    """
+    diff = _c_leiden._Optimiser_optimise_changed_nodes(
+        self._optimiser,
+        partition._partition,
+        _as_buffer_or_list(changed_nodes),
+        is_membership_fixed=is_membership_fixed)
     partition._update_internal_membership()
     return diff
 
+  def optimise_graph_changed_nodes(self, graph, partition_type, membership, changed_nodes, resolution_parameter=1.0):
+    """ Optimise only the nodes of a :class:`NativeGraph` near changed edges.
+    This is the same as :func:`optimise_changed_nodes`, on a partition that only
+    exists in the C++ extension. Use :func:`NativeGraph.apply_edge_delta` to
+    create the new graph.
+    Parameters
+    ----------
+    graph : :class:`NativeGraph`
+      The new graph.
+    partition_type : :class:`VertexPartition`
+      Type of partition to use, see :func:`optimise_graph`.
+    membership : list of int
+      The membership from before the change. Nodes that were added to the
+      graph, and are hence not in the membership, start in a community of
+      their own.
+    changed_nodes : list of int
+      The end points of the edges that were added or removed.
+    resolution_parameter : double
+      Resolution parameter, for partition types that have one.
+    Returns
+    -------
+    (memoryview, double)
+      The updated membership and its quality, as for :func:`optimise_graph`.
+    """
+    method = partition_type.__name__
+    if method.endswith('VertexPartition'):
+      method = method[:-len('VertexPartition')]
+    return _c_leiden._Optimiser_optimise_graph_changed_nodes(
+        self._optimiser,
+        graph._graph,
+        method,
+        _as_buffer_or_list(membership),
+        _as_buffer_or_list(changed_nodes),
+        resolution_parameter=resolution_parameter)
+
   def optimise_partition_multiplex(self, partitions, layer_weights=None, n_iterations=2, is_membership_fixed=None):
     """ Optimise a multiplex partition.
     This function optimises the multiplex partition using the Leiden algorithm. It
@@ -364,7 +926,10 @@ class Optimiser(object):
     improvement in the quality function. It will only move a node if the
     quality function improves. The order of the nodes is randomised. In contrast
     to :func:`move_nodes`, this function moves nodes only within the communities
-    as specified in `constrained_partition`.
+    as specified in `constrained_partition`. When using multiple threads (see
+    :attr:`n_threads`) or a queue (see :attr:`use_queue`), a singleton
+    partition is refined one constrained community per task, with a result
+    that does not depend on the number of threads.
     Parameters
     ----------
     partition : :class:`VertexPartition`
@@ -417,7 +982,9 @@ class Optimiser(object):
     to :func:`merge_nodes`, this function moves nodes only within the communities
     as specified in `constrained_partition`. This function in contrast to
     :func:`move_nodes_constrained` merges nodes together in communities, which is
-    much faster.
+    much faster. As for :func:`move_nodes_constrained`, a singleton partition
+    is refined one constrained community per task when using multiple threads
+    or a queue.
     Parameters
     ----------
     partition : :class:`VertexPartition`
@@ -441,132 +1008,175 @@ class Optimiser(object):
         partition_type,
         resolution_range,
         weights=None,
-        bisect_func=lambda p: p.bisect_value(),
+        bisect_func=None,
         min_diff_bisect_value=1,
         min_diff_resolution=1e-3,
         linear_bisection=False,
         number_iterations=1,
+        n_threads=None,
+        timeout=None,
         **kwargs
         ):
+    """ Use bisectioning on the resolution parameter to find the partitions
+    that are optimal for a range of resolution parameters.
+    The range is bisected in rounds until the partitions at the ends of each
+    interval have (nearly) the same bisect value, i.e. the total weight within
+    communities, or the resolutions differ by less than
+    ``min_diff_resolution``. All midpoints of a round are optimised in
+    parallel without holding the GIL, each starting from the partition at the
+    end of its interval that is best at the midpoint. Afterwards only the
+    partitions that are best for at least one of the evaluated resolutions
+    are kept.
+    Parameters
+    ----------
+    graph : :class:`ig.Graph`
+      The graph for which to construct the resolution profile.
+    partition_type
+      The type of :class:`~leidenalg.VertexPartition.LinearResolutionParameterVertexPartition`
+      used.
+    resolution_range : tuple of float
+      The range of resolution parameters (minimum, maximum).
+    weights : list of float or str
+      Edge weights, passed to ``partition_type``.
+    bisect_func : function
+      Function of a partition that gives the value on which to bisect. If
+      :obj:`None`, the total weight within communities is used and the
+      bisection runs natively in parallel. Otherwise the bisection runs in
+      Python, calling ``bisect_func`` on every optimised partition, and
+      optimises the midpoints one at a time.
+    min_diff_bisect_value : float
+      Intervals whose bisect values differ by less than this are not
+      bisected further.
+    min_diff_resolution : float
+      Intervals whose resolutions differ by less than this are not bisected
+      further.
+    linear_bisection : bool
+      Split intervals at the resolution at which the partitions at both ends
+      have the same quality, instead of at the middle of the interval.
+    number_iterations : int
+      Number of iterations at every resolution, see
+      :func:`optimise_partition`.
+    n_threads : int
+      Number of threads to use. If :obj:`None`, the number of CPUs is used.
+    timeout : double
+      Time limit in seconds, see :func:`optimise_partition`. Once it expires,
+      no further intervals are bisected.
+    **kwargs
+      Remaining keyword arguments, passed to ``partition_type``.
+    Returns
+    -------
+    list of :class:`~leidenalg.VertexPartition.LinearResolutionParameterVertexPartition`
+      The partitions of the profile, in order of their resolution parameter.
+      The attribute ``is_stable`` of each partition tells whether it was
+      locally optimal at its resolution when it was evaluated, see
+      :func:`is_locally_optimal`.
+    Examples
+    --------
+    >>> G = ig.Graph.Famous('Zachary')
+    >>> optimiser = la.Optimiser()
+    >>> profile = optimiser.resolution_profile(G, la.CPMVertexPartition,
+    ...                                        resolution_range=(0,1))
+    """
     if not issubclass(partition_type, LinearResolutionParameterVertexPartition):
       raise TypeError("Partition type should be a resolution parameter partition.")
     if not (isinstance(resolution_range, tuple) and len(resolution_range) == 2):
       raise TypeError("Resolution range should be a tuple of length 2.")
-    Bisect = namedtuple('Bisect', ['partition', 'is_stable'])
-    bisect_values = {}
-    def expand_profile(resolution, min_res_diff=1e-3):
-      if resolution not in bisect_values:
-        kwargs_res = kwargs.copy()
-        kwargs_res['resolution_parameter'] = resolution
-        partition = partition_type(graph, weights=weights, **kwargs_res)
-        self.optimise_partition(partition, n_iterations=number_iterations)
-        is_stable = (self.optimise_partition(partition, n_iterations=1) == 0)
-        bisect_values[resolution] = Bisect(partition, is_stable)
-        return True
-      else:
-        return False
-    def build_profile(min_res, max_res, min_res_diff=1e-3):
-      # Are these two resolutions basically the same within machine precision?
-      if (max_res - min_res) < min_res_diff:
-        return
-      # Did we already calculate this?
-      if min_res in bisect_values and max_res in bisect_values and \
-        bisect_values[min_res].partition.membership == bisect_values[max_res].partition.membership:
-        return
-      mid_res = (min_res + max_res)/2.
-      if linear_bisection:
-        min_p = bisect_values[min_res].partition
-        max_p = bisect_values[max_res].partition
-        mid_res = (max_p.bisect_value() - min_p.bisect_value())/(max_res - min_res)
-      expand_profile(mid_res, min_res_diff)
-      # Is there a sufficient difference between the bisection values?
-      diff_bisect_value = abs(bisect_func(bisect_values[min_res].partition) - bisect_func(bisect_values[max_res].partition))
-      if diff_bisect_value < min_diff_bisect_value:
-        return
-      # build profile recursively.
-      build_profile(min_res, mid_res, min_res_diff)
-      build_profile(mid_res, max_res, min_res_diff)
     min_res, max_res = resolution_range
-    expand_profile(min_res)
-    expand_profile(max_res)
-    build_profile(min_res, max_res)
-    # Post-processing of profile
-    def clean_stepwise(bisect_values):
-      # Check best partition for each resolution parameter
-      for res, bisect in bisect_values.items():
-        max_q = -float('inf')
-        best_p = None
-        for res_other, bisect_other in bisect_values.items():
-          q = bisect_other.partition.quality(resolution_parameter=res)
-          if q > max_q:
-            max_q = q
-            best_p = bisect_other.partition
-        bisect_values[res] = Bisect(best_p, False)
-      # Check for unique partitions
-      unique_partitions = {}
-      for res, bisect in sorted(bisect_values.items()):
-        # Make membership hashable
-        bisect.partition.renumber_communities()
-        m = tuple(bisect.partition.membership)
-        if m not in unique_partitions:
-          unique_partitions[m] = bisect.partition
-      return sorted(unique_partitions.values(), key=lambda p: p.resolution_parameter)
-    def ensure_monotonicity(bisect_values, new_res):
-      # First check if this partition improves on any other partition
-      for res, bisect in bisect_values.items():
-        if new_res.quality(res) > bisect.partition.quality(res):
-          # We found a better partition, let's keep it.
-          break
-      else:
-        # We couldn't find a better partition, so just return
-        return
-      # There is some resolution for which this partition is better, so let's
-      # add it to the list of partitions.
-      bisect_values[new_res.resolution_parameter] = Bisect(new_res, False)
-    def find_partition(self, graph, partition_type, weights=None, **kwargs):
-      # Store current settings of optimiser
-      refine_partition = self.refine_partition
-      # Set settings for finding partitions
-      self.refine_partition = False
-      partition = partition_type(graph, weights=weights, **kwargs)
-      self.optimise_partition(partition, n_iterations=number_iterations)
-      is_stable = (self.optimise_partition(partition, n_iterations=1) == 0)
-      # Restore settings
-      self.refine_partition = refine_partition
-      return Bisect(partition, is_stable)
-    # Make sure we do at least some iterations of moving nodes.
-    kwargs_min = kwargs.copy()
-    kwargs_min['resolution_parameter'] = min_res
-    bisect_min = find_partition(self, graph, partition_type, weights, **kwargs_min)
-    bisect_values[bisect_min.partition.resolution_parameter] = bisect_min.partition
-    kwargs_max = kwargs.copy()
-    kwargs_max['resolution_parameter'] = max_res
-    bisect_max = find_partition(self, graph, partition_type, weights, **kwargs_max)
-    bisect_values[bisect_max.partition.resolution_parameter] = bisect_max.partition
-    min_b = bisect_func(bisect_min.partition)
-    max_b = bisect_func(bisect_max.partition)
-    while abs(min_b - max_b) > min_diff_bisect_value and \
-          abs(bisect_min.partition.resolution_parameter - bisect_max.partition.resolution_parameter) > min_diff_resolution:
-      if linear_bisection:
-        mid_res = bisect_min.partition.resolution_parameter - \
-          (bisect_func(bisect_min.partition) - 0.0) * \
-          (bisect_max.partition.resolution_parameter - bisect_min.partition.resolution_parameter) / \
-          (bisect_func(bisect_max.partition) - bisect_func(bisect_min.partition))
-        if mid_res < bisect_min.partition.resolution_parameter or \
-           mid_res > bisect_max.partition.resolution_parameter:
-          mid_res = (bisect_min.partition.resolution_parameter + bisect_max.partition.resolution_parameter)/2.0
-      else:
-          mid_res = (bisect_min.partition.resolution_parameter + bisect_max.partition.resolution_parameter)/2.0
-      kwargs_mid = kwargs.copy()
-      kwargs_mid['resolution_parameter'] = mid_res
-      bisect_mid = find_partition(self, graph, partition_type, weights, **kwargs_mid)
-      ensure_monotonicity(bisect_values, bisect_mid.partition)
-      mid_b = bisect_func(bisect_mid.partition)
-      if mid_b > 0:
-        bisect_max = bisect_mid
-        max_b = mid_b
-      else:
-        bisect_min = bisect_mid
-        min_b = mid_b
-    return sorted((bisect.partition for res, bisect in
-      bisect_values.items()), key=lambda x: x.resolution_parameter)
\ No newline at end of file
+    if bisect_func is not None:
+      return self._bisect_resolution_profile(graph, partition_type, min_res, max_res, weights,
+                                             bisect_func, min_diff_bisect_value, min_diff_resolution,
+                                             linear_bisection, number_iterations, timeout, kwargs)
+    if n_threads is None:
+      n_threads = os.cpu_count() or 1
+    kwargs_res = kwargs.copy()
+    kwargs_res['resolution_parameter'] = min_res
+    partition = partition_type(graph, weights=weights, **kwargs_res)
+    _c_leiden._Optimiser_set_timeout(self._optimiser, -1.0 if timeout is None else max(timeout, 0.0))
+    profile = _c_leiden._Optimiser_resolution_profile(
+        self._optimiser,
+        partition._partition,
+        min_res,
+        max_res,
+        min_diff_bisect_value=min_diff_bisect_value,
+        min_diff_resolution=min_diff_resolution,
+        linear_bisection=linear_bisection,
+        n_iterations=number_iterations,
+        n_threads=n_threads)
+    partitions = []
+    for point in profile:
+      kwargs_res['resolution_parameter'] = point['resolution']
+      partition = partition_type(graph,
+                                 initial_membership=point['membership'],
+                                 weights=weights,
+                                 **kwargs_res)
+      partition.is_stable = point['is_stable']
+      partitions.append(partition)
+    return partitions
+
+  def _bisect_resolution_profile(self, graph, partition_type, min_res, max_res, weights,
+                                 bisect_func, min_diff_bisect_value, min_diff_resolution,
+                                 linear_bisection, number_iterations, timeout, kwargs):
+    """ Resolution profile for a user-supplied ``bisect_func``.
+    This bisects in the same way as the native :func:`resolution_profile`, but
+    calls ``bisect_func`` on every optimised partition, which requires the
+    GIL. Hence the midpoints are optimised one at a time. The arguments are
+    those of :func:`resolution_profile`.
+    """
+    if not min_res <= max_res:
+      raise ValueError("Minimum resolution should not exceed the maximum resolution.")
+    deadline = None if timeout is None else time.monotonic() + max(timeout, 0.0)
+    def has_expired():
+      return deadline is not None and time.monotonic() >= deadline
+    def canonical(membership):
+      labels = {}
+      return [labels.setdefault(c, len(labels)) for c in membership]
+    # A point is (resolution, partition, bisect value, quality at 0, slope)
+    def evaluate(resolution, initial_membership):
+      kwargs_res = kwargs.copy()
+      kwargs_res['resolution_parameter'] = resolution
+      partition = partition_type(graph, initial_membership=initial_membership,
+                                 weights=weights, **kwargs_res)
+      self.optimise_partition(partition, n_iterations=number_iterations,
+                              timeout=None if deadline is None else max(deadline - time.monotonic(), 0.0))
+      partition.is_stable = not has_expired() and self.is_locally_optimal(partition)
+      quality_at_zero = partition.quality(0.0)
+      return (resolution, partition, bisect_func(partition),
+              quality_at_zero, partition.quality(1.0) - quality_at_zero)
+    def quality(point, resolution):
+      return point[3] + point[4]*resolution
+
+    points = [evaluate(min_res, None)]
+    if min_res < max_res:
+      points.append(evaluate(max_res, None))
+    intervals = [(points[0], points[1])] if len(points) > 1 else []
+    while intervals and not has_expired():
+      low, high = intervals.pop()
+      if high[0] - low[0] < min_diff_resolution or \
+         abs(high[2] - low[2]) < min_diff_bisect_value or \
+         canonical(low[1].membership) == canonical(high[1].membership):
+        continue
+      mid_res = (low[0] + high[0])/2.0
+      if linear_bisection and low[4] != high[4]:
+        crossing = (high[3] - low[3])/(low[4] - high[4])
+        if low[0] < crossing < high[0]:
+          mid_res = crossing
+      # Warm start from the end that is best at the midpoint
+      start = low if quality(low, mid_res) >= quality(high, mid_res) else high
+      mid = evaluate(mid_res, start[1].membership)
+      points.append(mid)
+      intervals.extend([(mid, high), (low, mid)])
+
+    # Keep the best point at every evaluated resolution, once per partition
+    points.sort(key=lambda point: point[0])
+    selected = set()
+    for point in points:
+      best = max(points, key=lambda other: quality(other, point[0]))
+      selected.add(id(best))
+    profile = []
+    memberships = set()
+    for point in points:
+      membership = tuple(canonical(point[1].membership))
+      if id(point) in selected and membership not in memberships:
+        memberships.add(membership)
+        profile.append(point[1])
+    return profile
@@ -0,0 +1,66 @@
+#include "PartitionHierarchy.h"
+
+void PartitionHierarchy::add_level(vector<size_t> const& membership)
+{
+  size_t n = membership.size();
+  if (n > INT32_MAX)
+    throw Exception("Number of nodes exceeds the maximum for a hierarchy.");
+
+  size_t n_communities = 0;
+  for (size_t c : membership)
+  {
+    if (c >= INT32_MAX)
+      throw Exception("Community exceeds the maximum for a hierarchy.");
+    if (c + 1 > n_communities)
+      n_communities = c + 1;
+  }
+
+  if (this->_maps.empty())
+  {
+    this->_n_nodes = n;
+    this->_maps.push_back(vector<int32_t>(membership.begin(), membership.end()));
+  }
+  else
+  {
+    if (n != this->_n_nodes)
+      throw Exception("Membership vector not the same size as the number of nodes.");
+
+    // Map each community of the previous level to its community in this level
+    vector<size_t> previous_membership = this->membership(this->n_levels() - 1);
+    vector<int32_t> map(this->_n_communities.back(), -1);
+    for (size_t v = 0; v < n; v++)
+    {
+      int32_t& c = map[previous_membership[v]];
+      if (c < 0)
+        c = (int32_t)membership[v];
+      else if ((size_t)c != membership[v])
+        throw Exception("Membership is not nested in the previous level of the hierarchy.");
+    }
+    this->_maps.push_back(map);
+  }
+  this->_n_communities.push_back(n_communities);
+}
+
+vector<size_t> PartitionHierarchy::membership(size_t level) const
+{
+  if (level >= this->n_levels())
+    throw Exception("Level does not exist in hierarchy.");
+
+  vector<int32_t> const& first = this->_maps[0];
+  vector<size_t> result(first.begin(), first.end());
+  for (size_t l = 1; l <= level; l++)
+  {
+    vector<int32_t> const& map = this->_maps[l];
+    for (size_t v = 0; v < this->_n_nodes; v++)
+      result[v] = map[result[v]];
+  }
+  return result;
+}
+
+size_t PartitionHierarchy::memory_usage() const
+{
+  size_t memory_usage = this->_n_communities.capacity()*sizeof(size_t);
+  for (vector<int32_t> const& map : this->_maps)
+    memory_usage += map.capacity()*sizeof(int32_t);
+  return memory_usage;
+}
@@ -1,6 +1,6 @@
 import igraph as _ig
 from . import _c_leiden
-from .functions import _get_py_capsule
+from .functions import _get_py_capsule, _as_buffer_or_list
 
 class MutableVertexPartition(_ig.VertexClustering):
   """ Contains a partition of a graph, derives from
@@ -109,17 +109,51 @@ class MutableVertexPartition(_ig.VertexClustering):
     new_partition = cls(partition.graph, partition.membership, **kwargs)
     return new_partition
 
+  # The membership is retrieved from the C++ partition as a buffer, and only
+  # converted to a list when the list is actually used.
+  _membership_list = None
+  _membership_buffer = None
+
+  @property
+  def _membership(self):
+    if self._membership_list is None and self._membership_buffer is not None:
+      self._membership_list = self._membership_buffer.tolist()
+    return self._membership_list
+
+  @_membership.setter
+  def _membership(self, membership):
+    self._membership_list = membership
+    self._membership_buffer = None
+
   def _update_internal_membership(self):
-    self._membership = _c_leiden._MutableVertexPartition_get_membership(self._partition)
+    membership, n_communities = _c_leiden._MutableVertexPartition_get_membership_buffer(self._partition)
+    self._membership = None
+    self._membership_buffer = membership
     # Reset the length of the object, i.e. the number of communities
-    if len(self._membership)>0:
-        self._len = max(m for m in self._membership if m is not None)+1
-    else:
-        self._len = 0
+    self._len = n_communities
+
+  def membership_buffer(self):
+    """ Return the membership as a :class:`memoryview` of unsigned integers.
+
+    Unlike :attr:`membership`, this does not create a Python integer for
+    each node, which makes it much faster for large graphs. It can be
+    converted to a NumPy array without copying using ``numpy.asarray``.
+
+    Returns
+    -------
+    memoryview
+      A copy of the membership, which does not change when the partition
+      changes.
+    """
+    membership, _ = _c_leiden._MutableVertexPartition_get_membership_buffer(self._partition)
+    return membership
 
   def set_membership(self, membership):
-    """ Set membership. """
-    _c_leiden._MutableVertexPartition_set_membership(self._partition, list(membership))
+    """ Set membership.
+
+    The membership can be any iterable, or a buffer of integers, such as a
+    NumPy array, which is read directly. """
+    _c_leiden._MutableVertexPartition_set_membership(self._partition, _as_buffer_or_list(membership))
     self._update_internal_membership()
 
   # Calculate improvement *if* we move this node
@@ -470,13 +504,13 @@ class ModularityVertexPartition(MutableVertexPartition):
       if isinstance(weights, str):
         weights = graph.es[weights]
       else:
-        # Make sure it is a list
-        weights = list(weights)
+        # Make sure it is a buffer or a list
+        weights = _as_buffer_or_list(weights)
 
     self._partition = _c_leiden._new_ModularityVertexPartition(pygraph_t,
         initial_membership, weights)
     self._update_internal_membership()
-    if (weights != None):
+    if (weights is not None):
       self.weights = weights
     else:
       self.weights = 'weight'
@@ -558,24 +592,24 @@ class SurpriseVertexPartition(MutableVertexPartition):
       if isinstance(weights, str):
         weights = graph.es[weights]
       else:
-        # Make sure it is a list
-        weights = list(weights)
+        # Make sure it is a buffer or a list
+        weights = _as_buffer_or_list(weights)
 
     if node_sizes is not None:
       if isinstance(node_sizes, str):
         node_sizes = graph.vs[node_sizes]
       else:
-        # Make sure it is a list
-        node_sizes = list(node_sizes)
+        # Make sure it is a buffer or a list
+        node_sizes = _as_buffer_or_list(node_sizes)
 
     self._partition = _c_leiden._new_SurpriseVertexPartition(pygraph_t,
         initial_membership, weights, node_sizes)
     self._update_internal_membership()
-    if (weights != None):
+    if (weights is not None):
       self.weights = weights
     else:
       self.weights = 'weight'
-    if (node_sizes != None):
+    if (node_sizes is not None):
       self.node_sizes = node_sizes
     else:
       self.node_sizes = None
@@ -651,12 +685,12 @@ class SignificanceVertexPartition(MutableVertexPartition):
       if isinstance(node_sizes, str):
         node_sizes = graph.vs[node_sizes]
       else:
-        # Make sure it is a list
-        node_sizes = list(node_sizes)
+        # Make sure it is a buffer or a list
+        node_sizes = _as_buffer_or_list(node_sizes)
 
     self._partition = _c_leiden._new_SignificanceVertexPartition(pygraph_t, initial_membership, node_sizes)
     self._update_internal_membership()
-    if (node_sizes != None):
+    if (node_sizes is not None):
       self.node_sizes = node_sizes
     else:
       self.node_sizes = None
@@ -783,15 +817,15 @@ class RBERVertexPartition(LinearResolutionParameterVertexPartition):
       if isinstance(weights, str):
         weights = graph.es[weights]
       else:
-        # Make sure it is a list
-        weights = list(weights)
+        # Make sure it is a buffer or a list
+        weights = _as_buffer_or_list(weights)
 
     if node_sizes is not None:
       if isinstance(node_sizes, str):
         node_sizes = graph.vs[node_sizes]
       else:
-        # Make sure it is a list
-        node_sizes = list(node_sizes)
+        # Make sure it is a buffer or a list
+        node_sizes = _as_buffer_or_list(node_sizes)
 
     self._partition = _c_leiden._new_RBERVertexPartition(pygraph_t,
         initial_membership, weights, node_sizes, resolution_parameter)
@@ -885,8 +919,8 @@ class RBConfigurationVertexPartition(LinearResolutionParameterVertexPartition):
       if isinstance(weights, str):
         weights = graph.es[weights]
       else:
-        # Make sure it is a list
-        weights = list(weights)
+        # Make sure it is a buffer or a list
+        weights = _as_buffer_or_list(weights)
 
     self._partition = _c_leiden._new_RBConfigurationVertexPartition(pygraph_t,
         initial_membership, weights, resolution_parameter)
@@ -981,15 +1015,15 @@ class CPMVertexPartition(LinearResolutionParameterVertexPartition):
       if isinstance(weights, str):
         weights = graph.es[weights]
       else:
-        # Make sure it is a list
-        weights = list(weights)
+        # Make sure it is a buffer or a list
+        weights = _as_buffer_or_list(weights)
 
     if node_sizes is not None:
       if isinstance(node_sizes, str):
         node_sizes = graph.vs[node_sizes]
       else:
-        # Make sure it is a list
-        node_sizes = list(node_sizes)
+        # Make sure it is a buffer or a list
+        node_sizes = _as_buffer_or_list(node_sizes)
 
     if correct_self_loops is None:
       correct_self_loops = any(graph.is_loop())
@@ -50,6 +50,8 @@ from .functions import slices_to_layers
 from .functions import time_slices_to_layers
 
 from .Optimiser import Optimiser
+from .Optimiser import PartitionHierarchy
+from .NativeGraph import NativeGraph
 from .VertexPartition import ModularityVertexPartition
 from .VertexPartition import SurpriseVertexPartition
 from .VertexPartition import SignificanceVertexPartition
@@ -15,6 +15,16 @@ from collections import Counter
 def _get_py_capsule(graph):
   return graph.__graph_as_capsule()
 
+def _as_buffer_or_list(values):
+  """ Return values unchanged if it supports the buffer protocol (such as a
+  NumPy array), so that it can be read without copying, and as a list
+  otherwise. """
+  try:
+    memoryview(values)
+    return values
+  except TypeError:
+    return list(values)
+
 from .VertexPartition import *
 from .Optimiser import *
 
@@ -113,8 +123,8 @@ def find_partition_hierarchical(graph, partition_type, n_iterations=-1,
     Returns
     -------
     (final_partition, hierarchy)
-        A tuple containing the final optimised partition and a list of all
-        intermediate partitions.
+        A tuple containing the final optimised partition and a
+        :class:`PartitionHierarchy` of all intermediate partitions.
     """
     partition = partition_type(graph, **kwargs)
     optimiser = Optimiser()
@@ -0,0 +1,398 @@
+#include "python_graph_interface.h"
+
+PyObject* capsule_NativeGraph(Graph* graph)
+{
+  PyObject* py_graph = PyCapsule_New(graph, "leidenalg.NativeGraph", del_NativeGraph);
+  return py_graph;
+}
+
+Graph* decapsule_NativeGraph(PyObject* py_graph)
+{
+  Graph* graph = (Graph*) PyCapsule_GetPointer(py_graph, "leidenalg.NativeGraph");
+  return graph;
+}
+
+void del_NativeGraph(PyObject* py_graph)
+{
+  Graph* graph = decapsule_NativeGraph(py_graph);
+  delete_native_graph(graph);
+}
+
+// Read a vector of node indices from a buffer or a list.
+vector<size_t> read_node_vector(PyObject* py_list)
+{
+  vector<size_t> result;
+  if (read_buffer(py_list, result))
+    return result;
+
+  if (!PyList_Check(py_list))
+    throw Exception("Expected a list or a buffer of node indices.");
+  size_t n = PyList_Size(py_list);
+  result.resize(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    PyObject* py_item = PyList_GetItem(py_list, i);
+    if (!PyLong_Check(py_item))
+      throw Exception("Expected integer values for node indices.");
+    result[i] = PyLong_AsSize_t(py_item);
+    if (PyErr_Occurred())
+    {
+      PyErr_Clear();
+      throw Exception("Expected non-negative integer values for node indices.");
+    }
+  }
+  return result;
+}
+
+// Read a vector of doubles from a buffer or a list, or an empty vector for None.
+vector<double> read_double_vector(PyObject* py_list)
+{
+  vector<double> result;
+  if (py_list == NULL || py_list == Py_None)
+    return result;
+  if (read_buffer(py_list, result))
+    return result;
+
+  if (!PyList_Check(py_list))
+    throw Exception("Expected a list or a buffer of numerical values.");
+  size_t n = PyList_Size(py_list);
+  result.resize(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    PyObject* py_item = PyList_GetItem(py_list, i);
+    if (!PyNumber_Check(py_item))
+      throw Exception("Expected numerical values for weights and node sizes.");
+    result[i] = PyFloat_AsDouble(py_item);
+  }
+  return result;
+}
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+  PyObject* _new_NativeGraph_from_file(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    const char* path = NULL;
+    static const char* kwlist[] = {"path", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "s", (char**) kwlist,
+                                     &path))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "new_NativeGraph_from_file(" << path << ");" << endl;
+    #endif
+
+    Graph* graph = NULL;
+    string error_message;
+    bool has_error = false;
+    string file_path(path);
+    // Reading the file does not touch any Python objects
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+      GraphFile file(file_path);
+      graph = file.create_graph();
+    }
+    catch (std::exception& e)
+    {
+      error_message = "Could not read graph file: " + string(e.what());
+      has_error = true;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (has_error)
+    {
+      PyErr_SetString(PyExc_ValueError, error_message.c_str());
+      return NULL;
+    }
+
+    #ifdef DEBUG
+      cerr << "Created graph " << graph << " with " << graph->vcount() << " nodes and " << graph->ecount() << " edges." << endl;
+    #endif
+
+    return capsule_NativeGraph(graph);
+  }
+
+  PyObject* _new_NativeGraph_from_edges(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    Py_ssize_t n = 0;
+    PyObject* py_sources = NULL;
+    PyObject* py_targets = NULL;
+    PyObject* py_weights = NULL;
+    PyObject* py_node_sizes = NULL;
+    int directed = false;
+    int correct_self_loops = false;
+    static const char* kwlist[] = {"n", "sources", "targets", "weights", "node_sizes", "directed", "correct_self_loops", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "nOO|OOpp", (char**) kwlist,
+                                     &n, &py_sources, &py_targets, &py_weights, &py_node_sizes, &directed, &correct_self_loops))
+        return NULL;
+
+    if (n < 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "Number of nodes cannot be negative.");
+      return NULL;
+    }
+
+    vector<size_t> sources;
+    vector<size_t> targets;
+    vector<double> weights;
+    vector<double> node_sizes;
+    try
+    {
+      sources = read_node_vector(py_sources);
+      targets = read_node_vector(py_targets);
+      weights = read_double_vector(py_weights);
+      node_sizes = read_double_vector(py_node_sizes);
+    }
+    catch (std::exception& e)
+    {
+      PyErr_SetString(PyExc_ValueError, e.what());
+      return NULL;
+    }
+
+    #ifdef DEBUG
+      cerr << "new_NativeGraph_from_edges(" << n << ", " << sources.size() << " edges);" << endl;
+    #endif
+
+    Graph* graph = NULL;
+    string error_message;
+    bool has_error = false;
+    // Creating the graph does not touch any Python objects
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+      graph = create_graph_from_edges(n, sources, targets, weights, node_sizes, directed, correct_self_loops);
+    }
+    catch (std::exception& e)
+    {
+      error_message = "Could not create graph: " + string(e.what());
+      has_error = true;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (has_error)
+    {
+      PyErr_SetString(PyExc_ValueError, error_message.c_str());
+      return NULL;
+    }
+
+    return capsule_NativeGraph(graph);
+  }
+
+  PyObject* _NativeGraph_write_file(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_graph = NULL;
+    const char* path = NULL;
+    static const char* kwlist[] = {"graph", "path", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Os", (char**) kwlist,
+                                     &py_graph, &path))
+        return NULL;
+
+    Graph* graph = decapsule_NativeGraph(py_graph);
+    if (graph == NULL)
+      return NULL;
+
+    #ifdef DEBUG
+      cerr << "write_file(" << path << ");" << endl;
+    #endif
+
+    try
+    {
+      GraphFile::write(graph, path);
+    }
+    catch (std::exception& e)
+    {
+      PyErr_SetString(PyExc_ValueError, e.what());
+      return NULL;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  PyObject* _NativeGraph_apply_edge_delta(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_graph = NULL;
+    Py_ssize_t n = -1;
+    PyObject* py_added_sources = NULL;
+    PyObject* py_added_targets = NULL;
+    PyObject* py_added_weights = NULL;
+    PyObject* py_removed_sources = NULL;
+    PyObject* py_removed_targets = NULL;
+    static const char* kwlist[] = {"graph", "n", "added_sources", "added_targets", "added_weights", "removed_sources", "removed_targets", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OnOOOOO", (char**) kwlist,
+                                     &py_graph, &n, &py_added_sources, &py_added_targets, &py_added_weights,
+                                     &py_removed_sources, &py_removed_targets))
+        return NULL;
+
+    Graph* graph = decapsule_NativeGraph(py_graph);
+    if (graph == NULL)
+      return NULL;
+
+    if (n < 0)
+      n = graph->vcount();
+
+    vector<size_t> added_sources;
+    vector<size_t> added_targets;
+    vector<double> added_weights;
+    vector<size_t> removed_sources;
+    vector<size_t> removed_targets;
+    try
+    {
+      added_sources = read_node_vector(py_added_sources);
+      added_targets = read_node_vector(py_added_targets);
+      added_weights = read_double_vector(py_added_weights);
+      removed_sources = read_node_vector(py_removed_sources);
+      removed_targets = read_node_vector(py_removed_targets);
+    }
+    catch (std::exception& e)
+    {
+      PyErr_SetString(PyExc_ValueError, e.what());
+      return NULL;
+    }
+
+    #ifdef DEBUG
+      cerr << "apply_edge_delta(" << added_sources.size() << " added, " << removed_sources.size() << " removed);" << endl;
+    #endif
+
+    Graph* new_graph = NULL;
+    string error_message;
+    bool has_error = false;
+    Py_BEGIN_ALLOW_THREADS
+    try
+    {
+      new_graph = create_graph_with_delta(graph, n, added_sources, added_targets, added_weights, removed_sources, removed_targets);
+    }
+    catch (std::exception& e)
+    {
+      error_message = "Could not apply edge delta: " + string(e.what());
+      has_error = true;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (has_error)
+    {
+      PyErr_SetString(PyExc_ValueError, error_message.c_str());
+      return NULL;
+    }
+
+    return capsule_NativeGraph(new_graph);
+  }
+
+  PyObject* _NativeGraph_vcount(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_graph = NULL;
+    static const char* kwlist[] = {"graph", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_graph))
+        return NULL;
+
+    Graph* graph = decapsule_NativeGraph(py_graph);
+    if (graph == NULL)
+      return NULL;
+
+    return PyLong_FromSize_t(graph->vcount());
+  }
+
+  PyObject* _NativeGraph_ecount(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_graph = NULL;
+    static const char* kwlist[] = {"graph", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_graph))
+        return NULL;
+
+    Graph* graph = decapsule_NativeGraph(py_graph);
+    if (graph == NULL)
+      return NULL;
+
+    return PyLong_FromSize_t(graph->ecount());
+  }
+
+  PyObject* _NativeGraph_is_directed(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_graph = NULL;
+    static const char* kwlist[] = {"graph", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_graph))
+        return NULL;
+
+    Graph* graph = decapsule_NativeGraph(py_graph);
+    if (graph == NULL)
+      return NULL;
+
+    return PyBool_FromLong(graph->is_directed());
+  }
+
+  PyObject* _write_graph_file(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_obj_graph = NULL;
+    const char* path = NULL;
+    PyObject* py_weights = NULL;
+    PyObject* py_node_sizes = NULL;
+    int correct_self_loops = false;
+    static const char* kwlist[] = {"graph", "path", "weights", "node_sizes", "correct_self_loops", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Os|OOp", (char**) kwlist,
+                                     &py_obj_graph, &path, &py_weights, &py_node_sizes, &correct_self_loops))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "write_graph_file(" << path << ");" << endl;
+    #endif
+
+    try
+    {
+      Graph* graph = create_graph_from_py(py_obj_graph, py_node_sizes, py_weights, false, correct_self_loops);
+      try
+      {
+        GraphFile::write(graph, path);
+      }
+      catch (...)
+      {
+        delete graph;
+        throw;
+      }
+      delete graph;
+    }
+    catch (std::exception& e)
+    {
+      string s = "Could not write graph file: " + string(e.what());
+      PyErr_SetString(PyExc_ValueError, s.c_str());
+      return NULL;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+#ifdef __cplusplus
+}
+#endif
@@ -1,22 +1,117 @@
 #include "python_optimiser_interface.h"
 
-  PyObject* capsule_Optimiser(Optimiser* optimiser)
+  PyObject* capsule_Optimiser(ExtendedOptimiser* optimiser)
   {
     PyObject* py_optimiser = PyCapsule_New(optimiser, "leidenalg.Optimiser", del_Optimiser);
     return py_optimiser;
   }
 
-  Optimiser* decapsule_Optimiser(PyObject* py_optimiser)
+  ExtendedOptimiser* decapsule_Optimiser(PyObject* py_optimiser)
   {
-    Optimiser* optimiser = (Optimiser*) PyCapsule_GetPointer(py_optimiser, "leidenalg.Optimiser");
+    ExtendedOptimiser* optimiser = (ExtendedOptimiser*) PyCapsule_GetPointer(py_optimiser, "leidenalg.Optimiser");
     return optimiser;
   }
 
   void del_Optimiser(PyObject* py_optimiser)
   {
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     delete optimiser;
   }
+
+  PyObject* capsule_PartitionHierarchy(PartitionHierarchy* hierarchy)
+  {
+    PyObject* py_hierarchy = PyCapsule_New(hierarchy, "leidenalg.PartitionHierarchy", del_PartitionHierarchy);
+    return py_hierarchy;
+  }
+
+  PartitionHierarchy* decapsule_PartitionHierarchy(PyObject* py_hierarchy)
+  {
+    PartitionHierarchy* hierarchy = (PartitionHierarchy*) PyCapsule_GetPointer(py_hierarchy, "leidenalg.PartitionHierarchy");
+    return hierarchy;
+  }
+
+  void del_PartitionHierarchy(PyObject* py_hierarchy)
+  {
+    PartitionHierarchy* hierarchy = decapsule_PartitionHierarchy(py_hierarchy);
+    delete hierarchy;
+  }
+
+  // Thread state of the calling thread while the GIL is released, and whether
+  // a signal handler raised an exception.
+  struct SignalPoll
+  {
+    PyThreadState* thread_state;
+    bool is_interrupted;
+  };
+
+  // Poll function of the deadline: briefly take the GIL to run the signal
+  // handlers, and cancel the deadline if one of them raised an exception.
+  static void check_signals(Deadline* deadline, void* data)
+  {
+    SignalPoll* poll = (SignalPoll*)data;
+    PyEval_RestoreThread(poll->thread_state);
+    if (PyErr_CheckSignals() < 0)
+    {
+      poll->is_interrupted = true;
+      deadline->cancel();
+    }
+    poll->thread_state = PyEval_SaveThread();
+  }
+
+  /****************************************************************************
+    Runs an optimisation on the calling thread without holding the GIL, while
+    remaining responsive to signals. Every 50ms, the deadline checks of the
+    optimiser run the Python signal handlers (see check_signals). If a handler
+    raises an exception (KeyboardInterrupt on Ctrl-C), the deadline is
+    cancelled, so that the optimisation stops at its next check, and that
+    exception is returned. Returns false if an exception was set, and
+    exceptions of the optimisation are set as a ValueError.
+  ****************************************************************************/
+  template <class Function>
+  static bool run_interruptible(ExtendedOptimiser* optimiser, Function const& run)
+  {
+    string error_message;
+    bool has_error = false;
+
+    SignalPoll poll;
+    poll.is_interrupted = false;
+    poll.thread_state = PyEval_SaveThread();
+    optimiser->deadline.set_poll(check_signals, &poll, 0.05);
+    try
+    {
+      run();
+    }
+    catch (std::exception& e)
+    {
+      error_message = e.what();
+      has_error = true;
+    }
+    optimiser->deadline.set_poll(NULL, NULL, 0.0);
+    PyEval_RestoreThread(poll.thread_state);
+
+    if (poll.is_interrupted)
+      return false;
+    if (has_error)
+    {
+      PyErr_SetString(PyExc_ValueError, error_message.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  /****************************************************************************
+    As run_interruptible, for entry points without a timeout. These start
+    without a time limit, so that neither the timeout nor a cancellation of
+    an earlier call carries over. Entry points with a timeout instead start
+    the deadline in _Optimiser_set_timeout.
+  ****************************************************************************/
+  template <class Function>
+  static bool run_untimed(ExtendedOptimiser* optimiser, Function const& run)
+  {
+    optimiser->deadline.reset(-1.0);
+    return run_interruptible(optimiser, run);
+  }
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -30,7 +125,7 @@ extern "C"
       return NULL;
     }
 
-    Optimiser* optimiser = new Optimiser();
+    ExtendedOptimiser* optimiser = new ExtendedOptimiser();
     PyObject* py_optimiser = capsule_Optimiser(optimiser);
     return py_optimiser;
   }
@@ -59,7 +154,7 @@ extern "C"
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
@@ -80,30 +175,28 @@ extern "C"
         cerr << "Reading is_membership_fixed." << endl;
       #endif
 
-      size_t nb_is_membership_fixed = PyList_Size(py_is_membership_fixed);
-      if (nb_is_membership_fixed != n)
+      try
       {
-        PyErr_SetString(PyExc_ValueError, "Node size vector not the same size as the number of nodes.");
+        is_membership_fixed = create_bool_vector(py_is_membership_fixed);
+      }
+      catch (std::exception& e)
+      {
+        PyErr_SetString(PyExc_TypeError, e.what());
         return NULL;
       }
 
-      for (size_t v = 0; v < n; v++)
+      if (is_membership_fixed.size() != n)
       {
-        PyObject* py_item = PyList_GetItem(py_is_membership_fixed, v);
-        is_membership_fixed[v] = PyObject_IsTrue(py_item);
+        PyErr_SetString(PyExc_ValueError, "Node size vector not the same size as the number of nodes.");
+        return NULL;
       }
     }
 
     double q = 0.0;
-    try
-    {
-      q = optimiser->optimise_partition(partition, is_membership_fixed);
-    }
-    catch (std::exception& e)
-    {
-      PyErr_SetString(PyExc_ValueError, e.what());
+    // The optimisation does not touch any Python objects, so it runs without
+    // the GIL, and can be interrupted by Ctrl-C.
+    if (!run_interruptible(optimiser, [&]() { q = optimiser->optimise_partition(partition, is_membership_fixed); }))
       return NULL;
-    }
     return PyFloat_FromDouble(q);
   }
 
@@ -185,17 +278,20 @@ extern "C"
         cerr << "Reading is_membership_fixed." << endl;
       #endif
 
-      size_t nb_is_membership_fixed = PyList_Size(py_is_membership_fixed);
-      if (nb_is_membership_fixed != n)
+      try
       {
-        PyErr_SetString(PyExc_TypeError, "Node size vector not the same size as the number of nodes.");
+        is_membership_fixed = create_bool_vector(py_is_membership_fixed);
+      }
+      catch (std::exception& e)
+      {
+        PyErr_SetString(PyExc_TypeError, e.what());
         return NULL;
       }
 
-      for (size_t v = 0; v < n; v++)
+      if (is_membership_fixed.size() != n)
       {
-        PyObject* py_item = PyList_GetItem(py_is_membership_fixed, v);
-        is_membership_fixed[v] = PyObject_IsTrue(py_item);
+        PyErr_SetString(PyExc_TypeError, "Node size vector not the same size as the number of nodes.");
+        return NULL;
       }
     }
 
@@ -203,21 +299,14 @@ extern "C"
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
     double q = 0.0;
-    try
-    {
-      q = optimiser->optimise_partition(partitions, layer_weights, is_membership_fixed);
-    }
-    catch (std::exception& e)
-    {
-      PyErr_SetString(PyExc_ValueError, e.what());
+    if (!run_untimed(optimiser, [&]() { q = optimiser->optimise_partition(partitions, layer_weights, is_membership_fixed); }))
       return NULL;
-    }
     return PyFloat_FromDouble(q);
   }
 
@@ -274,41 +363,35 @@ extern "C"
     vector<bool> is_membership_fixed(n, false);
     if (py_is_membership_fixed != NULL && py_is_membership_fixed != Py_None)
     {
-      size_t nb_is_membership_fixed = PyList_Size(py_is_membership_fixed);
-      if (nb_is_membership_fixed != n)
+      try
       {
-        PyErr_SetString(PyExc_TypeError, "Node size vector not the same size as the number of nodes.");
+        is_membership_fixed = create_bool_vector(py_is_membership_fixed);
+      }
+      catch (std::exception& e)
+      {
+        PyErr_SetString(PyExc_TypeError, e.what());
         return NULL;
       }
 
-      for (size_t v = 0; v < n; v++)
+      if (is_membership_fixed.size() != n)
       {
-        PyObject* py_item = PyList_GetItem(py_is_membership_fixed, v);
-        is_membership_fixed[v] = PyObject_IsTrue(py_item);
+        PyErr_SetString(PyExc_TypeError, "Node size vector not the same size as the number of nodes.");
+        return NULL;
       }
     }
 
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
 
-    vector<MutableVertexPartition*> hierarchy;
+    PartitionHierarchy* hierarchy = new PartitionHierarchy();
     double q = 0.0;
-    try
-    {
-      q = optimiser->optimise_partition_hierarchical(partitions, layer_weights, is_membership_fixed, hierarchy);
-    }
-    catch (std::exception& e)
+    if (!run_untimed(optimiser, [&]() { q = optimiser->optimise_partition_hierarchical(partitions, layer_weights, is_membership_fixed, *hierarchy); }))
     {
-      PyErr_SetString(PyExc_ValueError, e.what());
+      delete hierarchy;
       return NULL;
     }
-    
-    PyObject* py_hierarchy = PyList_New(hierarchy.size());
-    for(size_t i = 0; i < hierarchy.size(); i++)
-    {
-        PyObject* py_partition = capsule_MutableVertexPartition(hierarchy[i]);
-        PyList_SetItem(py_hierarchy, i, py_partition);
-    }
-    
+
+    PyObject* py_hierarchy = capsule_PartitionHierarchy(hierarchy);
+
     PyObject* result = PyTuple_New(2);
     PyTuple_SetItem(result, 0, PyFloat_FromDouble(q));
     PyTuple_SetItem(result, 1, py_hierarchy);
@@ -316,313 +399,1437 @@ extern "C"
     return result;
   }
 
-  PyObject* _Optimiser_move_nodes(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_optimise_graph(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
-    PyObject* py_partition = NULL;
-    PyObject* py_is_membership_fixed = NULL;
-    int consider_comms = -1;
+    PyObject* py_graph = NULL;
+    char* method = NULL;
+    PyObject* py_initial_membership = NULL;
+    double resolution_parameter = 1.0;
+    Py_ssize_t n_iterations = 2;
 
-    static const char* kwlist[] = {"optimiser", "partition", "is_membership_fixed", "consider_comms", NULL};
+    static const char* kwlist[] = {"optimiser", "graph", "method", "initial_membership", "resolution_parameter", "n_iterations", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OO|Oi", (char**) kwlist,
-                                     &py_optimiser, &py_partition,
-                                     &py_is_membership_fixed, &consider_comms))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OOs|Odn", (char**) kwlist,
+                                     &py_optimiser, &py_graph, &method,
+                                     &py_initial_membership, &resolution_parameter, &n_iterations))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "optimise_partition(" << py_partition << ");" << endl;
+      cerr << "optimise_graph(" << py_graph << ", " << method << ", n_iterations=" << n_iterations << ");" << endl;
     #endif
 
-    #ifdef DEBUG
-      cerr << "Capsule optimiser at address " << py_optimiser << endl;
-    #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
-    #ifdef DEBUG
-      cerr << "Using optimiser at address " << optimiser << endl;
-    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    Graph* graph = decapsule_NativeGraph(py_graph);
+    if (optimiser == NULL || graph == NULL)
+      return NULL;
+
+    MutableVertexPartition* partition = NULL;
+    try
+    {
+      if (py_initial_membership != NULL && py_initial_membership != Py_None)
+      {
+        vector<size_t> initial_membership = create_size_t_vector(py_initial_membership);
+        partition = create_partition(graph, method, &initial_membership, resolution_parameter);
+      }
+      else
+        partition = create_partition(graph, method, NULL, resolution_parameter);
+    }
+    catch (std::exception& e)
+    {
+      string s = "Could not construct partition: " + string(e.what());
+      PyErr_SetString(PyExc_ValueError, s.c_str());
+      return NULL;
+    }
+
+    vector<bool> is_membership_fixed(graph->vcount(), false);
+    double q = 0.0;
+    bool is_converged = false;
+    // As in Optimiser.optimise_partition, a negative number of iterations
+    // runs until an iteration does not improve the partition, and the
+    // iterations stop once the deadline of the optimiser has expired.
+    bool is_success = run_interruptible(optimiser, [&]()
+    {
+      for (Py_ssize_t itr = 0; itr < n_iterations || n_iterations < 0; itr++)
+      {
+        double diff = optimiser->optimise_partition(partition, is_membership_fixed);
+        if (optimiser->deadline.has_expired())
+        {
+          is_converged = false;
+          break;
+        }
+        is_converged = (diff <= 0);
+        if (n_iterations < 0 && is_converged)
+          break;
+      }
+      q = partition->quality();
+    });
+
+    if (!is_success)
+    {
+      delete partition;
+      return NULL;
+    }
+
+    PyObject* py_membership = create_buffer(partition->get_membership());
+    delete partition;
+    if (py_membership == NULL)
+      return NULL;
+
+    PyObject* result = PyTuple_New(3);
+    PyTuple_SetItem(result, 0, py_membership);
+    PyTuple_SetItem(result, 1, PyFloat_FromDouble(q));
+    PyTuple_SetItem(result, 2, PyBool_FromLong(is_converged));
+    return result;
+  }
+
+  PyObject* _Optimiser_optimise_ensemble(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    PyObject* py_partition = NULL;
+    Py_ssize_t n_starts = 20;
+    Py_ssize_t n_threads = 1;
+    int n_iterations = 2;
+
+    static const char* kwlist[] = {"optimiser", "partition", "n_starts", "n_threads", "n_iterations", NULL};
 
     #ifdef DEBUG
-      cerr << "Capsule partition at address " << py_partition << endl;
+      cerr << "Parsing arguments..." << endl;
     #endif
-    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OO|nni", (char**) kwlist,
+                                     &py_optimiser, &py_partition,
+                                     &n_starts, &n_threads, &n_iterations))
+        return NULL;
+
     #ifdef DEBUG
-      cerr << "Using partition at address " << partition << endl;
+      cerr << "optimise_ensemble(" << py_partition << ", n_starts=" << n_starts << ", n_threads=" << n_threads << ");" << endl;
     #endif
 
-    size_t n = partition->get_graph()->vcount();
-    vector<bool> is_membership_fixed(n, false);
-    if (py_is_membership_fixed != NULL && py_is_membership_fixed != Py_None)
+    if (n_starts <= 0)
     {
-      #ifdef DEBUG
-        cerr << "Reading is_membership_fixed." << endl;
-      #endif
+      PyErr_SetString(PyExc_ValueError, "The number of starts should be positive.");
+      return NULL;
+    }
+    if (n_threads <= 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "The number of threads should be positive.");
+      return NULL;
+    }
+
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
 
-      size_t nb_is_membership_fixed = PyList_Size(py_is_membership_fixed);
-      if (nb_is_membership_fixed != n)
+    double q = 0.0;
+    vector<EnsembleRun> runs;
+    if (!run_interruptible(optimiser, [&]() { q = optimiser->optimise_ensemble(partition, n_starts, n_threads, n_iterations, runs); }))
+      return NULL;
+
+    PyObject* py_runs = PyList_New(runs.size());
+    if (py_runs == NULL)
+      return NULL;
+    for (size_t idx = 0; idx < runs.size(); idx++)
+    {
+      EnsembleRun const& run = runs[idx];
+      PyObject* py_run = Py_BuildValue("{s:K,s:d,s:n,s:n,s:O,s:d}",
+                                       "seed", (unsigned long long)run.seed,
+                                       "quality", run.quality,
+                                       "n_communities", (Py_ssize_t)run.n_communities,
+                                       "n_iterations", (Py_ssize_t)run.n_iterations,
+                                       "converged", run.converged ? Py_True : Py_False,
+                                       "time", run.time);
+      if (py_run == NULL)
       {
-        PyErr_SetString(PyExc_TypeError, "Node size vector not the same size as the number of nodes.");
+        Py_DECREF(py_runs);
         return NULL;
       }
+      PyList_SET_ITEM(py_runs, idx, py_run);
+    }
 
-      for (size_t v = 0; v < n; v++)
-      {
-        PyObject* py_item = PyList_GetItem(py_is_membership_fixed, v);
-        is_membership_fixed[v] = PyObject_IsTrue(py_item);
-      }
+    PyObject* result = PyTuple_New(2);
+    PyTuple_SetItem(result, 0, PyFloat_FromDouble(q));
+    PyTuple_SetItem(result, 1, py_runs);
+    return result;
+  }
+
+  PyObject* _Optimiser_optimise_consensus(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    PyObject* py_partition = NULL;
+    PyObject* py_memberships = NULL;
+    Py_ssize_t n_threads = 1;
+    Py_ssize_t max_rounds = 10;
+    double threshold = 0.0;
+
+    static const char* kwlist[] = {"optimiser", "partition", "memberships", "n_threads", "max_rounds", "threshold", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OOO|nnd", (char**) kwlist,
+                                     &py_optimiser, &py_partition, &py_memberships,
+                                     &n_threads, &max_rounds, &threshold))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "optimise_consensus(" << py_partition << ", n_threads=" << n_threads << ", max_rounds=" << max_rounds << ");" << endl;
+    #endif
+
+    if (n_threads <= 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "The number of threads should be positive.");
+      return NULL;
+    }
+    if (max_rounds < 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "The maximum number of rounds should not be negative.");
+      return NULL;
+    }
+    if (!PyList_Check(py_memberships))
+    {
+      PyErr_SetString(PyExc_TypeError, "Expected a list of memberships.");
+      return NULL;
     }
 
-    if (consider_comms < 0)
-      consider_comms = optimiser->consider_comms;
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
 
-    double q  = 0.0;
+    vector< vector<size_t> > memberships(PyList_Size(py_memberships));
     try
     {
-      q = optimiser->move_nodes(partition, is_membership_fixed, consider_comms, true);
+      for (size_t idx = 0; idx < memberships.size(); idx++)
+        memberships[idx] = read_node_vector(PyList_GetItem(py_memberships, idx));
     }
     catch (std::exception& e)
     {
       PyErr_SetString(PyExc_ValueError, e.what());
       return NULL;
     }
-    return PyFloat_FromDouble(q);
+
+    double q = 0.0;
+    vector<double> agreement;
+    size_t n_rounds = 0;
+    if (!run_interruptible(optimiser, [&]() { q = optimiser->optimise_consensus(partition, memberships, n_threads, max_rounds, threshold, agreement, n_rounds); }))
+      return NULL;
+
+    PyObject* py_agreement = create_buffer(agreement);
+    if (py_agreement == NULL)
+      return NULL;
+
+    PyObject* result = PyTuple_New(4);
+    PyTuple_SetItem(result, 0, PyFloat_FromDouble(q));
+    PyTuple_SetItem(result, 1, PyLong_FromSize_t(n_rounds));
+    PyTuple_SetItem(result, 2, PyBool_FromLong(is_agreement_stable(agreement)));
+    PyTuple_SetItem(result, 3, py_agreement);
+    return result;
   }
 
-  PyObject* _Optimiser_merge_nodes(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_resolution_profile(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
     PyObject* py_partition = NULL;
-    PyObject* py_is_membership_fixed = NULL;
-    int consider_comms = -1;
+    double min_resolution = 0.0;
+    double max_resolution = 1.0;
+    double min_diff_bisect_value = 1.0;
+    double min_diff_resolution = 1e-3;
+    int linear_bisection = false;
+    int n_iterations = 1;
+    Py_ssize_t n_threads = 1;
 
-    static const char* kwlist[] = {"optimiser", "partition", "is_membership_fixed", "consider_comms", NULL};
+    static const char* kwlist[] = {"optimiser", "partition", "min_resolution", "max_resolution",
+                                   "min_diff_bisect_value", "min_diff_resolution", "linear_bisection",
+                                   "n_iterations", "n_threads", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OO|Oi", (char**) kwlist,
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OOdd|ddpin", (char**) kwlist,
                                      &py_optimiser, &py_partition,
-                                     &py_is_membership_fixed, &consider_comms))
+                                     &min_resolution, &max_resolution,
+                                     &min_diff_bisect_value, &min_diff_resolution,
+                                     &linear_bisection, &n_iterations, &n_threads))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "optimise_partition(" << py_partition << ");" << endl;
+      cerr << "resolution_profile(" << py_partition << ", " << min_resolution << ", " << max_resolution << ", n_threads=" << n_threads << ");" << endl;
     #endif
 
-    #ifdef DEBUG
-      cerr << "Capsule optimiser at address " << py_optimiser << endl;
-    #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
-    #ifdef DEBUG
-      cerr << "Using optimiser at address " << optimiser << endl;
-    #endif
+    if (n_threads <= 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "The number of threads should be positive.");
+      return NULL;
+    }
 
-    #ifdef DEBUG
-      cerr << "Capsule partition at address " << py_partition << endl;
-    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
-    #ifdef DEBUG
-      cerr << "Using partition at address " << partition << endl;
-    #endif
 
-    size_t n = partition->get_graph()->vcount();
-    vector<bool> is_membership_fixed(n, false);
-    if (py_is_membership_fixed != NULL && py_is_membership_fixed != Py_None)
-    {
-      #ifdef DEBUG
-        cerr << "Reading is_membership_fixed." << endl;
-      #endif
+    vector<ProfilePoint> profile;
+    if (!run_interruptible(optimiser, [&]() { optimiser->resolution_profile(partition, min_resolution, max_resolution,
+                                                                            min_diff_bisect_value, min_diff_resolution, linear_bisection,
+                                                                            n_iterations, n_threads, profile); }))
+      return NULL;
 
-      size_t nb_is_membership_fixed = PyList_Size(py_is_membership_fixed);
-      if (nb_is_membership_fixed != n)
+    PyObject* py_profile = PyList_New(profile.size());
+    if (py_profile == NULL)
+      return NULL;
+    for (size_t idx = 0; idx < profile.size(); idx++)
+    {
+      ProfilePoint const& point = profile[idx];
+      PyObject* py_membership = create_buffer(point.membership);
+      if (py_membership == NULL)
       {
-        PyErr_SetString(PyExc_TypeError, "Node size vector not the same size as the number of nodes.");
+        Py_DECREF(py_profile);
         return NULL;
       }
-
-      for (size_t v = 0; v < n; v++)
+      PyObject* py_point = Py_BuildValue("{s:d,s:N,s:d,s:d,s:O}",
+                                         "resolution", point.resolution,
+                                         "membership", py_membership,
+                                         "bisect_value", point.bisect_value,
+                                         "quality", point.quality(point.resolution),
+                                         "is_stable", point.is_stable ? Py_True : Py_False);
+      if (py_point == NULL)
       {
-        PyObject* py_item = PyList_GetItem(py_is_membership_fixed, v);
-        is_membership_fixed[v] = PyObject_IsTrue(py_item);
+        Py_DECREF(py_profile);
+        return NULL;
       }
+      PyList_SET_ITEM(py_profile, idx, py_point);
     }
-
-    if (consider_comms < 0)
-      consider_comms = optimiser->consider_comms;
-
-    double q = 0.0;
-    try
-    {
-      q = optimiser->merge_nodes(partition, is_membership_fixed, consider_comms, true);
-    }
-    catch (std::exception& e)
-    {
-      PyErr_SetString(PyExc_ValueError, e.what());
-      return NULL;
-    }
-    return PyFloat_FromDouble(q);
+    return py_profile;
   }
 
-  PyObject* _Optimiser_move_nodes_constrained(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_is_locally_optimal(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
     PyObject* py_partition = NULL;
-    PyObject* py_constrained_partition = NULL;
-    int consider_comms = -1;
+    PyObject* py_is_membership_fixed = NULL;
 
-    static const char* kwlist[] = {"optimiser", "partition", "constrained_partition", "consider_comms", NULL};
+    static const char* kwlist[] = {"optimiser", "partition", "is_membership_fixed", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OOO|i", (char**) kwlist,
-                                     &py_optimiser, &py_partition, &py_constrained_partition, &consider_comms))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OO|O", (char**) kwlist,
+                                     &py_optimiser, &py_partition,
+                                     &py_is_membership_fixed))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "optimise_partition(" << py_partition << ");" << endl;
+      cerr << "is_locally_optimal(" << py_partition << ", is_membership_fixed=" << py_is_membership_fixed << ");" << endl;
+    #endif
+
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
+
+    size_t n = partition->get_graph()->vcount();
+    vector<bool> is_membership_fixed(n, false);
+    if (py_is_membership_fixed != NULL && py_is_membership_fixed != Py_None)
+    {
+      try
+      {
+        is_membership_fixed = create_bool_vector(py_is_membership_fixed);
+      }
+      catch (std::exception& e)
+      {
+        PyErr_SetString(PyExc_TypeError, e.what());
+        return NULL;
+      }
+
+      if (is_membership_fixed.size() != n)
+      {
+        PyErr_SetString(PyExc_ValueError, "Node size vector not the same size as the number of nodes.");
+        return NULL;
+      }
+    }
+
+    bool is_optimal = false;
+    if (!run_untimed(optimiser, [&]() { is_optimal = optimiser->is_locally_optimal(partition, is_membership_fixed); }))
+      return NULL;
+    return PyBool_FromLong(is_optimal);
+  }
+
+  PyObject* _Optimiser_optimise_changed_nodes(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    PyObject* py_partition = NULL;
+    PyObject* py_changed_nodes = NULL;
+    PyObject* py_is_membership_fixed = NULL;
+
+    static const char* kwlist[] = {"optimiser", "partition", "changed_nodes", "is_membership_fixed", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OOO|O", (char**) kwlist,
+                                     &py_optimiser, &py_partition,
+                                     &py_changed_nodes, &py_is_membership_fixed))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "optimise_changed_nodes(" << py_partition << ");" << endl;
+    #endif
+
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
+
+    size_t n = partition->get_graph()->vcount();
+    vector<bool> is_membership_fixed(n, false);
+    if (py_is_membership_fixed != NULL && py_is_membership_fixed != Py_None)
+    {
+      try
+      {
+        is_membership_fixed = create_bool_vector(py_is_membership_fixed);
+      }
+      catch (std::exception& e)
+      {
+        PyErr_SetString(PyExc_TypeError, e.what());
+        return NULL;
+      }
+
+      if (is_membership_fixed.size() != n)
+      {
+        PyErr_SetString(PyExc_TypeError, "Node size vector not the same size as the number of nodes.");
+        return NULL;
+      }
+    }
+
+    vector<size_t> changed_nodes;
+    try
+    {
+      changed_nodes = read_node_vector(py_changed_nodes);
+    }
+    catch (std::exception& e)
+    {
+      PyErr_SetString(PyExc_ValueError, e.what());
+      return NULL;
+    }
+
+    double q = 0.0;
+    if (!run_untimed(optimiser, [&]() { q = optimiser->optimise_changed_nodes(partition, changed_nodes, is_membership_fixed); }))
+      return NULL;
+    return PyFloat_FromDouble(q);
+  }
+
+  PyObject* _Optimiser_optimise_graph_changed_nodes(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    PyObject* py_graph = NULL;
+    char* method = NULL;
+    PyObject* py_membership = NULL;
+    PyObject* py_changed_nodes = NULL;
+    double resolution_parameter = 1.0;
+
+    static const char* kwlist[] = {"optimiser", "graph", "method", "membership", "changed_nodes", "resolution_parameter", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OOsOO|d", (char**) kwlist,
+                                     &py_optimiser, &py_graph, &method,
+                                     &py_membership, &py_changed_nodes, &resolution_parameter))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "optimise_graph_changed_nodes(" << py_graph << ", " << method << ");" << endl;
+    #endif
+
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    Graph* graph = decapsule_NativeGraph(py_graph);
+    if (optimiser == NULL || graph == NULL)
+      return NULL;
+
+    size_t n = graph->vcount();
+    MutableVertexPartition* partition = NULL;
+    vector<size_t> changed_nodes;
+    try
+    {
+      // Nodes that were added to the graph start in a community of their own
+      vector<size_t> membership = create_size_t_vector(py_membership);
+      if (membership.size() > n)
+        throw Exception("Membership vector has more elements than the number of nodes.");
+      size_t n_old = membership.size();
+      for (size_t v = n_old; v < n; v++)
+        membership.push_back(v);
+
+      changed_nodes = read_node_vector(py_changed_nodes);
+      partition = create_partition(graph, method, &membership, resolution_parameter);
+    }
+    catch (std::exception& e)
+    {
+      string s = "Could not construct partition: " + string(e.what());
+      PyErr_SetString(PyExc_ValueError, s.c_str());
+      return NULL;
+    }
+
+    vector<bool> is_membership_fixed(n, false);
+    double q = 0.0;
+    bool is_success = run_untimed(optimiser, [&]()
+    {
+      optimiser->optimise_changed_nodes(partition, changed_nodes, is_membership_fixed);
+      q = partition->quality();
+    });
+    if (!is_success)
+    {
+      delete partition;
+      return NULL;
+    }
+
+    PyObject* py_new_membership = create_buffer(partition->get_membership());
+    delete partition;
+    if (py_new_membership == NULL)
+      return NULL;
+
+    PyObject* result = PyTuple_New(2);
+    PyTuple_SetItem(result, 0, py_new_membership);
+    PyTuple_SetItem(result, 1, PyFloat_FromDouble(q));
+    return result;
+  }
+
+  PyObject* _Optimiser_move_nodes(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    PyObject* py_partition = NULL;
+    PyObject* py_is_membership_fixed = NULL;
+    int consider_comms = -1;
+
+    static const char* kwlist[] = {"optimiser", "partition", "is_membership_fixed", "consider_comms", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OO|Oi", (char**) kwlist,
+                                     &py_optimiser, &py_partition,
+                                     &py_is_membership_fixed, &consider_comms))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "optimise_partition(" << py_partition << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule partition at address " << py_partition << endl;
+    #endif
+    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
+    #ifdef DEBUG
+      cerr << "Using partition at address " << partition << endl;
+    #endif
+
+    size_t n = partition->get_graph()->vcount();
+    vector<bool> is_membership_fixed(n, false);
+    if (py_is_membership_fixed != NULL && py_is_membership_fixed != Py_None)
+    {
+      #ifdef DEBUG
+        cerr << "Reading is_membership_fixed." << endl;
+      #endif
+
+      try
+      {
+        is_membership_fixed = create_bool_vector(py_is_membership_fixed);
+      }
+      catch (std::exception& e)
+      {
+        PyErr_SetString(PyExc_TypeError, e.what());
+        return NULL;
+      }
+
+      if (is_membership_fixed.size() != n)
+      {
+        PyErr_SetString(PyExc_TypeError, "Node size vector not the same size as the number of nodes.");
+        return NULL;
+      }
+    }
+
+    if (consider_comms < 0)
+      consider_comms = optimiser->consider_comms;
+
+    double q = 0.0;
+    if (!run_untimed(optimiser, [&]() { q = optimiser->move_nodes(partition, is_membership_fixed, consider_comms, true); }))
+      return NULL;
+    return PyFloat_FromDouble(q);
+  }
+
+  PyObject* _Optimiser_merge_nodes(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    PyObject* py_partition = NULL;
+    PyObject* py_is_membership_fixed = NULL;
+    int consider_comms = -1;
+
+    static const char* kwlist[] = {"optimiser", "partition", "is_membership_fixed", "consider_comms", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OO|Oi", (char**) kwlist,
+                                     &py_optimiser, &py_partition,
+                                     &py_is_membership_fixed, &consider_comms))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "optimise_partition(" << py_partition << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule partition at address " << py_partition << endl;
+    #endif
+    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
+    #ifdef DEBUG
+      cerr << "Using partition at address " << partition << endl;
+    #endif
+
+    size_t n = partition->get_graph()->vcount();
+    vector<bool> is_membership_fixed(n, false);
+    if (py_is_membership_fixed != NULL && py_is_membership_fixed != Py_None)
+    {
+      #ifdef DEBUG
+        cerr << "Reading is_membership_fixed." << endl;
+      #endif
+
+      try
+      {
+        is_membership_fixed = create_bool_vector(py_is_membership_fixed);
+      }
+      catch (std::exception& e)
+      {
+        PyErr_SetString(PyExc_TypeError, e.what());
+        return NULL;
+      }
+
+      if (is_membership_fixed.size() != n)
+      {
+        PyErr_SetString(PyExc_TypeError, "Node size vector not the same size as the number of nodes.");
+        return NULL;
+      }
+    }
+
+    if (consider_comms < 0)
+      consider_comms = optimiser->consider_comms;
+
+    double q = 0.0;
+    if (!run_untimed(optimiser, [&]() { q = optimiser->merge_nodes(partition, is_membership_fixed, consider_comms, true); }))
+      return NULL;
+    return PyFloat_FromDouble(q);
+  }
+
+  PyObject* _Optimiser_move_nodes_constrained(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    PyObject* py_partition = NULL;
+    PyObject* py_constrained_partition = NULL;
+    int consider_comms = -1;
+
+    static const char* kwlist[] = {"optimiser", "partition", "constrained_partition", "consider_comms", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OOO|i", (char**) kwlist,
+                                     &py_optimiser, &py_partition, &py_constrained_partition, &consider_comms))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "optimise_partition(" << py_partition << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule partition at address " << py_partition << endl;
+    #endif
+    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
+    #ifdef DEBUG
+      cerr << "Using partition at address " << partition << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule constrained partition at address " << py_constrained_partition << endl;
+    #endif
+    MutableVertexPartition* constrained_partition = decapsule_MutableVertexPartition(py_constrained_partition);
+    #ifdef DEBUG
+      cerr << "Using constrained partition at address " << constrained_partition << endl;
+    #endif
+
+    if (consider_comms < 0)
+      consider_comms = optimiser->refine_consider_comms;
+
+    double q = 0.0;
+    if (!run_untimed(optimiser, [&]() { q = optimiser->move_nodes_constrained(partition, consider_comms, constrained_partition); }))
+      return NULL;
+    return PyFloat_FromDouble(q);
+  }
+
+  PyObject* _Optimiser_merge_nodes_constrained(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    PyObject* py_partition = NULL;
+    PyObject* py_constrained_partition = NULL;
+    int consider_comms = -1;
+
+    static const char* kwlist[] = {"optimiser", "partition", "constrained_partition", "consider_comms", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OOO|i", (char**) kwlist,
+                                     &py_optimiser, &py_partition, &py_constrained_partition, &consider_comms))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "optimise_partition(" << py_partition << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule partition at address " << py_partition << endl;
+    #endif
+    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
+    #ifdef DEBUG
+      cerr << "Using partition at address " << partition << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule constrained partition at address " << py_partition << endl;
+    #endif
+    MutableVertexPartition* constrained_partition = decapsule_MutableVertexPartition(py_constrained_partition);
+    #ifdef DEBUG
+      cerr << "Using constrained partition at address " << partition << endl;
+    #endif
+
+    if (consider_comms < 0)
+      consider_comms = optimiser->refine_consider_comms;
+
+    double q = 0.0;
+    if (!run_untimed(optimiser, [&]() { q = optimiser->merge_nodes_constrained(partition, consider_comms, constrained_partition); }))
+      return NULL;
+    return PyFloat_FromDouble(q);
+  }
+
+  PyObject* _Optimiser_set_consider_comms(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    int consider_comms = Optimiser::ALL_NEIGH_COMMS;
+    static const char* kwlist[] = {"optimiser", "consider_comms", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
+                                     &py_optimiser, &consider_comms))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "set_consider_comms(" << consider_comms << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    optimiser->consider_comms = consider_comms;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  PyObject* _Optimiser_get_consider_comms(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    static const char* kwlist[] = {"optimiser", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "get_consider_comms();" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    return PyLong_FromLong(optimiser->consider_comms);
+  }
+
+  PyObject* _Optimiser_set_refine_consider_comms(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    int refine_consider_comms = Optimiser::ALL_NEIGH_COMMS;
+    static const char* kwlist[] = {"optimiser", "refine_consider_comms", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
+                                     &py_optimiser, &refine_consider_comms))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "set_refine_consider_comms(" << refine_consider_comms << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    optimiser->refine_consider_comms = refine_consider_comms;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  PyObject* _Optimiser_get_refine_consider_comms(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    static const char* kwlist[] = {"optimiser", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "get_refine_consider_comms();" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    return PyLong_FromLong(optimiser->refine_consider_comms);
+  }
+
+  PyObject* _Optimiser_set_optimise_routine(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    int optimise_routine = Optimiser::ALL_NEIGH_COMMS;
+    static const char* kwlist[] = {"optimiser", "optimise_routine", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
+                                     &py_optimiser, &optimise_routine))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "set_optimise_routine(" << optimise_routine << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    optimiser->optimise_routine = optimise_routine;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  PyObject* _Optimiser_get_optimise_routine(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    static const char* kwlist[] = {"optimiser", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "get_optimise_routine();" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    return PyLong_FromLong(optimiser->optimise_routine);
+  }
+
+  PyObject* _Optimiser_set_refine_routine(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    int refine_routine = Optimiser::ALL_NEIGH_COMMS;
+    static const char* kwlist[] = {"optimiser", "refine_routine", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
+                                     &py_optimiser, &refine_routine))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "set_refine_routine(" << refine_routine << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    optimiser->refine_routine = refine_routine;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  PyObject* _Optimiser_get_refine_routine(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    static const char* kwlist[] = {"optimiser", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "get_refine_routine();" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    return PyLong_FromLong(optimiser->refine_routine);
+  }
+
+  PyObject* _Optimiser_set_consider_empty_community(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    int consider_empty_community = true;
+    static const char* kwlist[] = {"optimiser", "consider_empty_community", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
+                                     &py_optimiser, &consider_empty_community))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "set_consider_empty_community(" << consider_empty_community << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Setting consider_empty_community to " << consider_empty_community << endl;
+    #endif
+    optimiser->consider_empty_community = consider_empty_community;
+    #ifdef DEBUG
+      cerr << "Set consider_empty_community to " << optimiser->consider_empty_community << endl;
+    #endif
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  PyObject* _Optimiser_get_consider_empty_community(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    static const char* kwlist[] = {"optimiser", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "get_consider_empty_community();" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+      cerr << "Returning " << optimiser->consider_empty_community << endl;
+    #endif
+
+    return PyBool_FromLong(optimiser->consider_empty_community);
+  }
+
+  PyObject* _Optimiser_set_refine_partition(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    int refine_partition = false;
+    static const char* kwlist[] = {"optimiser", "refine_partition", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
+                                     &py_optimiser, &refine_partition))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "set_refine_partition(" << refine_partition << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    optimiser->refine_partition = refine_partition;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  PyObject* _Optimiser_get_refine_partition(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    static const char* kwlist[] = {"optimiser", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "get_refine_partition();" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    return PyBool_FromLong(optimiser->refine_partition);
+  }
+
+  PyObject* _Optimiser_set_max_comm_size(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    size_t max_comm_size = 0;
+    static const char* kwlist[] = {"optimiser", "max_comm_size", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "On", (char**) kwlist,
+                                     &py_optimiser, &max_comm_size))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "set_max_comm_size(" << max_comm_size << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    optimiser->max_comm_size = max_comm_size;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  PyObject* _Optimiser_get_max_comm_size(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    static const char* kwlist[] = {"optimiser", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "get_max_comm_size();" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    return PyLong_FromSize_t(optimiser->max_comm_size);
+  }
+
+  PyObject* _Optimiser_set_n_threads(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    Py_ssize_t n_threads = 1;
+    static const char* kwlist[] = {"optimiser", "n_threads", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "On", (char**) kwlist,
+                                     &py_optimiser, &n_threads))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "set_n_threads(" << n_threads << ");" << endl;
+    #endif
+
+    if (n_threads < 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "Number of threads should be non-negative.");
+      return NULL;
+    }
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    // Zero means using all available hardware threads
+    optimiser->n_threads = n_threads > 0 ? (size_t)n_threads : default_n_threads();
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  PyObject* _Optimiser_get_n_threads(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    static const char* kwlist[] = {"optimiser", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "get_n_threads();" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    return PyLong_FromSize_t(optimiser->n_threads);
+  }
+
+  PyObject* _Optimiser_set_use_queue(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    int use_queue = 0;
+    static const char* kwlist[] = {"optimiser", "use_queue", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
+                                     &py_optimiser, &use_queue))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "set_use_queue(" << use_queue << ");" << endl;
+    #endif
+
+    #ifdef DEBUG
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
+    #endif
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    #ifdef DEBUG
+      cerr << "Using optimiser at address " << optimiser << endl;
+    #endif
+
+    optimiser->use_queue = use_queue;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  PyObject* _Optimiser_get_use_queue(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    static const char* kwlist[] = {"optimiser", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "get_use_queue();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
+    return PyBool_FromLong(optimiser->use_queue);
+  }
+
+  PyObject* _Optimiser_set_compact_indices(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    int compact_indices = 0;
+    static const char* kwlist[] = {"optimiser", "compact_indices", NULL};
+
     #ifdef DEBUG
-      cerr << "Capsule partition at address " << py_partition << endl;
+      cerr << "Parsing arguments..." << endl;
     #endif
-    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
+                                     &py_optimiser, &compact_indices))
+        return NULL;
+
     #ifdef DEBUG
-      cerr << "Using partition at address " << partition << endl;
+      cerr << "set_compact_indices(" << compact_indices << ");" << endl;
     #endif
 
     #ifdef DEBUG
-      cerr << "Capsule constrained partition at address " << py_constrained_partition << endl;
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    MutableVertexPartition* constrained_partition = decapsule_MutableVertexPartition(py_constrained_partition);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
-      cerr << "Using constrained partition at address " << constrained_partition << endl;
+      cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    if (consider_comms < 0)
-      consider_comms = optimiser->refine_consider_comms;
+    optimiser->compact_indices = compact_indices;
 
-    double q = 0.0;
-    try
-    {
-      q = optimiser->move_nodes_constrained(partition, consider_comms, constrained_partition);
-    }
-    catch (std::exception& e)
-    {
-      PyErr_SetString(PyExc_ValueError, e.what());
-      return NULL;
-    }
-    return PyFloat_FromDouble(q);
+    Py_INCREF(Py_None);
+    return Py_None;
   }
 
-  PyObject* _Optimiser_merge_nodes_constrained(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_set_check_interval(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
-    PyObject* py_partition = NULL;
-    PyObject* py_constrained_partition = NULL;
-    int consider_comms = -1;
-
-    static const char* kwlist[] = {"optimiser", "partition", "constrained_partition", "consider_comms", NULL};
+    Py_ssize_t check_interval = 0;
+    static const char* kwlist[] = {"optimiser", "check_interval", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "OOO|i", (char**) kwlist,
-                                     &py_optimiser, &py_partition, &py_constrained_partition, &consider_comms))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "On", (char**) kwlist,
+                                     &py_optimiser, &check_interval))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "optimise_partition(" << py_partition << ");" << endl;
+      cerr << "set_check_interval(" << check_interval << ");" << endl;
     #endif
 
+    if (check_interval <= 0)
+    {
+      PyErr_SetString(PyExc_ValueError, "The check interval should be positive.");
+      return NULL;
+    }
+
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
+    optimiser->check_interval = check_interval;
+
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+
+  PyObject* _Optimiser_set_profiling(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_optimiser = NULL;
+    int profiling = 0;
+    static const char* kwlist[] = {"optimiser", "profiling", NULL};
+
     #ifdef DEBUG
-      cerr << "Capsule partition at address " << py_partition << endl;
+      cerr << "Parsing arguments..." << endl;
     #endif
-    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
+                                     &py_optimiser, &profiling))
+        return NULL;
+
     #ifdef DEBUG
-      cerr << "Using partition at address " << partition << endl;
+      cerr << "set_profiling(" << profiling << ");" << endl;
     #endif
 
     #ifdef DEBUG
-      cerr << "Capsule constrained partition at address " << py_partition << endl;
+      cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    MutableVertexPartition* constrained_partition = decapsule_MutableVertexPartition(py_constrained_partition);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
-      cerr << "Using constrained partition at address " << partition << endl;
+      cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    if (consider_comms < 0)
-      consider_comms = optimiser->refine_consider_comms;
+    optimiser->profiling = profiling;
 
-    double q = 0.0;
-    try
-    {
-      q = optimiser->merge_nodes_constrained(partition, consider_comms, constrained_partition);
-    }
-    catch (std::exception& e)
-    {
-      PyErr_SetString(PyExc_ValueError, e.what());
-      return NULL;
-    }
-    return PyFloat_FromDouble(q);
+    Py_INCREF(Py_None);
+    return Py_None;
   }
 
-  PyObject* _Optimiser_set_consider_comms(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_get_compact_indices(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
-    int consider_comms = Optimiser::ALL_NEIGH_COMMS;
-    static const char* kwlist[] = {"optimiser", "consider_comms", NULL};
+    static const char* kwlist[] = {"optimiser", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
-                                     &py_optimiser, &consider_comms))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "set_consider_comms(" << consider_comms << ");" << endl;
+      cerr << "get_compact_indices();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    optimiser->consider_comms = consider_comms;
-
-    Py_INCREF(Py_None);
-    return Py_None;
+    return PyBool_FromLong(optimiser->compact_indices);
   }
 
-  PyObject* _Optimiser_get_consider_comms(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_get_check_interval(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
     static const char* kwlist[] = {"optimiser", NULL};
@@ -636,53 +1843,49 @@ extern "C"
         return NULL;
 
     #ifdef DEBUG
-      cerr << "get_consider_comms();" << endl;
+      cerr << "get_check_interval();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    return PyLong_FromLong(optimiser->consider_comms);
+    return PyLong_FromSize_t(optimiser->check_interval);
   }
 
-  PyObject* _Optimiser_set_refine_consider_comms(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_get_profiling(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
-    int refine_consider_comms = Optimiser::ALL_NEIGH_COMMS;
-    static const char* kwlist[] = {"optimiser", "refine_consider_comms", NULL};
+    static const char* kwlist[] = {"optimiser", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
-                                     &py_optimiser, &refine_consider_comms))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "set_refine_consider_comms(" << refine_consider_comms << ");" << endl;
+      cerr << "get_profiling();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    optimiser->refine_consider_comms = refine_consider_comms;
-
-    Py_INCREF(Py_None);
-    return Py_None;
+    return PyBool_FromLong(optimiser->profiling);
   }
 
-  PyObject* _Optimiser_get_refine_consider_comms(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_get_n_visits(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
     static const char* kwlist[] = {"optimiser", NULL};
@@ -696,53 +1899,49 @@ extern "C"
         return NULL;
 
     #ifdef DEBUG
-      cerr << "get_refine_consider_comms();" << endl;
+      cerr << "get_n_visits();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    return PyLong_FromLong(optimiser->refine_consider_comms);
+    return PyLong_FromSize_t(optimiser->n_visits);
   }
 
-  PyObject* _Optimiser_set_optimise_routine(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_get_n_moves(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
-    int optimise_routine = Optimiser::ALL_NEIGH_COMMS;
-    static const char* kwlist[] = {"optimiser", "optimise_routine", NULL};
+    static const char* kwlist[] = {"optimiser", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
-                                     &py_optimiser, &optimise_routine))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "set_optimise_routine(" << optimise_routine << ");" << endl;
+      cerr << "get_n_moves();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    optimiser->optimise_routine = optimise_routine;
-
-    Py_INCREF(Py_None);
-    return Py_None;
+    return PyLong_FromSize_t(optimiser->n_moves);
   }
 
-  PyObject* _Optimiser_get_optimise_routine(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_get_n_diff_moves(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
     static const char* kwlist[] = {"optimiser", NULL};
@@ -756,53 +1955,49 @@ extern "C"
         return NULL;
 
     #ifdef DEBUG
-      cerr << "get_optimise_routine();" << endl;
+      cerr << "get_n_diff_moves();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    return PyLong_FromLong(optimiser->optimise_routine);
+    return PyLong_FromSize_t(optimiser->n_diff_moves);
   }
 
-  PyObject* _Optimiser_set_refine_routine(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_get_n_scratch_allocations(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
-    int refine_routine = Optimiser::ALL_NEIGH_COMMS;
-    static const char* kwlist[] = {"optimiser", "refine_routine", NULL};
+    static const char* kwlist[] = {"optimiser", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
-                                     &py_optimiser, &refine_routine))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "set_refine_routine(" << refine_routine << ");" << endl;
+      cerr << "get_n_scratch_allocations();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    optimiser->refine_routine = refine_routine;
-
-    Py_INCREF(Py_None);
-    return Py_None;
+    return PyLong_FromSize_t(optimiser->n_scratch_allocations);
   }
 
-  PyObject* _Optimiser_get_refine_routine(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_get_arena_peak_bytes(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
     static const char* kwlist[] = {"optimiser", NULL};
@@ -816,120 +2011,113 @@ extern "C"
         return NULL;
 
     #ifdef DEBUG
-      cerr << "get_refine_routine();" << endl;
+      cerr << "get_arena_peak_bytes();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    return PyLong_FromLong(optimiser->refine_routine);
+    return PyLong_FromSize_t(optimiser->arena.peak_bytes);
   }
 
-  PyObject* _Optimiser_set_consider_empty_community(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_get_arena_bytes_allocated(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
-    int consider_empty_community = true;
-    static const char* kwlist[] = {"optimiser", "consider_empty_community", NULL};
+    static const char* kwlist[] = {"optimiser", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
-                                     &py_optimiser, &consider_empty_community))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "set_consider_empty_community(" << consider_empty_community << ");" << endl;
+      cerr << "get_arena_bytes_allocated();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    #ifdef DEBUG
-      cerr << "Setting consider_empty_community to " << consider_empty_community << endl;
-    #endif
-    optimiser->consider_empty_community = consider_empty_community;
-    #ifdef DEBUG
-      cerr << "Set consider_empty_community to " << optimiser->consider_empty_community << endl;
-    #endif
-
-    Py_INCREF(Py_None);
-    return Py_None;
+    return PyLong_FromSize_t(optimiser->arena.total_bytes_allocated);
   }
 
-  PyObject* _Optimiser_get_consider_empty_community(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_set_timeout(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
-    static const char* kwlist[] = {"optimiser", NULL};
+    double timeout = -1.0;
+    static const char* kwlist[] = {"optimiser", "timeout", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
-                                     &py_optimiser))
+    // A negative timeout means no time limit.
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O|d", (char**) kwlist,
+                                     &py_optimiser, &timeout))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "get_consider_empty_community();" << endl;
+      cerr << "set_timeout(" << timeout << ");" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
-      cerr << "Returning " << optimiser->consider_empty_community << endl;
     #endif
 
-    return PyBool_FromLong(optimiser->consider_empty_community);
+    optimiser->deadline.reset(timeout);
+
+    Py_INCREF(Py_None);
+    return Py_None;
   }
 
-  PyObject* _Optimiser_set_refine_partition(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_cancel(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
-    int refine_partition = false;
-    static const char* kwlist[] = {"optimiser", "refine_partition", NULL};
+    static const char* kwlist[] = {"optimiser", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "Oi", (char**) kwlist,
-                                     &py_optimiser, &refine_partition))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "set_refine_partition(" << refine_partition << ");" << endl;
+      cerr << "cancel();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    optimiser->refine_partition = refine_partition;
+    optimiser->deadline.cancel();
 
     Py_INCREF(Py_None);
     return Py_None;
   }
 
-  PyObject* _Optimiser_get_refine_partition(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_has_expired(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
     static const char* kwlist[] = {"optimiser", NULL};
@@ -943,53 +2131,76 @@ extern "C"
         return NULL;
 
     #ifdef DEBUG
-      cerr << "get_refine_partition();" << endl;
+      cerr << "has_expired();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    return PyBool_FromLong(optimiser->refine_partition);
+    return PyBool_FromLong(optimiser->deadline.has_expired());
   }
 
-  PyObject* _Optimiser_set_max_comm_size(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_get_profile(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
-    size_t max_comm_size = 0;
-    static const char* kwlist[] = {"optimiser", "max_comm_size", NULL};
+    static const char* kwlist[] = {"optimiser", NULL};
 
     #ifdef DEBUG
       cerr << "Parsing arguments..." << endl;
     #endif
 
-    if (!PyArg_ParseTupleAndKeywords(args, keywds, "On", (char**) kwlist,
-                                     &py_optimiser, &max_comm_size))
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_optimiser))
         return NULL;
 
     #ifdef DEBUG
-      cerr << "set_max_comm_size(" << max_comm_size << ");" << endl;
+      cerr << "get_profile();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    optimiser->max_comm_size = max_comm_size;
-
-    Py_INCREF(Py_None);
-    return Py_None;
+    PyObject* py_profile = PyList_New(optimiser->profile.size());
+    if (py_profile == NULL)
+      return NULL;
+    for (size_t idx = 0; idx < optimiser->profile.size(); idx++)
+    {
+      LevelProfile const& level = optimiser->profile[idx];
+      PyObject* py_level = Py_BuildValue("{s:n,s:n,s:n,s:n,s:n,s:n,s:n,s:n,s:d,s:d,s:d,s:n,s:n}",
+                                         "level", (Py_ssize_t)level.level,
+                                         "n_nodes", (Py_ssize_t)level.n_nodes,
+                                         "n_edges", (Py_ssize_t)level.n_edges,
+                                         "n_communities_before", (Py_ssize_t)level.n_communities_before,
+                                         "n_communities_after", (Py_ssize_t)level.n_communities_after,
+                                         "n_visits", (Py_ssize_t)level.n_visits,
+                                         "n_moves", (Py_ssize_t)level.n_moves,
+                                         "n_diff_moves", (Py_ssize_t)level.n_diff_moves,
+                                         "move_time", level.move_time,
+                                         "refine_time", level.refine_time,
+                                         "collapse_time", level.collapse_time,
+                                         "n_aggregate_nodes", (Py_ssize_t)level.n_aggregate_nodes,
+                                         "n_aggregate_edges", (Py_ssize_t)level.n_aggregate_edges);
+      if (py_level == NULL)
+      {
+        Py_DECREF(py_profile);
+        return NULL;
+      }
+      PyList_SET_ITEM(py_profile, idx, py_level);
+    }
+    return py_profile;
   }
 
-  PyObject* _Optimiser_get_max_comm_size(PyObject *self, PyObject *args, PyObject *keywds)
+  PyObject* _Optimiser_clear_profile(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_optimiser = NULL;
     static const char* kwlist[] = {"optimiser", NULL};
@@ -1003,18 +2214,21 @@ extern "C"
         return NULL;
 
     #ifdef DEBUG
-      cerr << "get_max_comm_size();" << endl;
+      cerr << "clear_profile();" << endl;
     #endif
 
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
 
-    return PyLong_FromSize_t(optimiser->max_comm_size);
+    optimiser->profile.clear();
+
+    Py_INCREF(Py_None);
+    return Py_None;
   }
 
   PyObject* _Optimiser_set_rng_seed(PyObject *self, PyObject *args, PyObject *keywds)
@@ -1038,7 +2252,7 @@ extern "C"
     #ifdef DEBUG
       cerr << "Capsule optimiser at address " << py_optimiser << endl;
     #endif
-    Optimiser* optimiser = decapsule_Optimiser(py_optimiser);
+    ExtendedOptimiser* optimiser = decapsule_Optimiser(py_optimiser);
     #ifdef DEBUG
       cerr << "Using optimiser at address " << optimiser << endl;
     #endif
@@ -1051,6 +2265,74 @@ extern "C"
     Py_INCREF(Py_None);
     return Py_None;
   }
+
+  PyObject* _PartitionHierarchy_get_n_levels(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_hierarchy = NULL;
+    static const char* kwlist[] = {"hierarchy", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_hierarchy))
+        return NULL;
+
+    PartitionHierarchy* hierarchy = decapsule_PartitionHierarchy(py_hierarchy);
+    if (hierarchy == NULL)
+      return NULL;
+
+    return PyLong_FromSize_t(hierarchy->n_levels());
+  }
+
+  PyObject* _PartitionHierarchy_get_membership(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_hierarchy = NULL;
+    Py_ssize_t level = 0;
+    static const char* kwlist[] = {"hierarchy", "level", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "On", (char**) kwlist,
+                                     &py_hierarchy, &level))
+        return NULL;
+
+    PartitionHierarchy* hierarchy = decapsule_PartitionHierarchy(py_hierarchy);
+    if (hierarchy == NULL)
+      return NULL;
+
+    if (level < 0 || (size_t)level >= hierarchy->n_levels())
+    {
+      PyErr_SetString(PyExc_IndexError, "Level does not exist in hierarchy.");
+      return NULL;
+    }
+
+    return create_buffer(hierarchy->membership(level));
+  }
+
+  PyObject* _PartitionHierarchy_get_memory_usage(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_hierarchy = NULL;
+    static const char* kwlist[] = {"hierarchy", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_hierarchy))
+        return NULL;
+
+    PartitionHierarchy* hierarchy = decapsule_PartitionHierarchy(py_hierarchy);
+    if (hierarchy == NULL)
+      return NULL;
+
+    return PyLong_FromSize_t(hierarchy->memory_usage());
+  }
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,5 +1,8 @@
 #include "python_partition_interface.h"
 
+#include <algorithm>
+#include <cstring>
+
 Graph* create_graph_from_py(PyObject* py_obj_graph, PyObject* py_node_sizes)
 {
   return create_graph_from_py(py_obj_graph, py_node_sizes, NULL, true, false);
@@ -38,23 +41,31 @@ Graph* create_graph_from_py(PyObject* py_obj_graph, PyObject* py_node_sizes, PyO
       cerr << "Reading node_sizes." << endl;
     #endif
 
-    size_t nb_node_size = PyList_Size(py_node_sizes);
-    if (nb_node_size != n)
+    if (read_buffer(py_node_sizes, node_sizes))
     {
-      throw Exception("Node size vector not the same size as the number of nodes.");
+      if (node_sizes.size() != n)
+        throw Exception("Node size vector not the same size as the number of nodes.");
     }
-    node_sizes.resize(n);
-    for (size_t v = 0; v < n; v++)
+    else
     {
-      PyObject* py_item = PyList_GetItem(py_node_sizes, v);
-      if (PyNumber_Check(py_item))
+      size_t nb_node_size = PyList_Size(py_node_sizes);
+      if (nb_node_size != n)
       {
-        double e = PyFloat_AsDouble(py_item);
-        node_sizes[v] = e;
+        throw Exception("Node size vector not the same size as the number of nodes.");
       }
-      else
+      node_sizes.resize(n);
+      for (size_t v = 0; v < n; v++)
       {
-        throw Exception("Expected numerical values for node sizes vector.");
+        PyObject* py_item = PyList_GetItem(py_node_sizes, v);
+        if (PyNumber_Check(py_item))
+        {
+          double e = PyFloat_AsDouble(py_item);
+          node_sizes[v] = e;
+        }
+        else
+        {
+          throw Exception("Expected numerical values for node sizes vector.");
+        }
       }
     }
   }
@@ -64,22 +75,33 @@ Graph* create_graph_from_py(PyObject* py_obj_graph, PyObject* py_node_sizes, PyO
     #ifdef DEBUG
       cerr << "Reading weights." << endl;
     #endif
-    size_t nb_weights = PyList_Size(py_weights);
-    if (nb_weights != m)
-      throw Exception("Weight vector not the same size as the number of edges.");
-    weights.resize(m);
-    for (size_t e = 0; e < m; e++)
+    if (read_buffer(py_weights, weights))
     {
-      PyObject* py_item = PyList_GetItem(py_weights, e);
-      if (PyNumber_Check(py_item))
-      {
-        weights[e] = PyFloat_AsDouble(py_item);
-      }
-      else
+      if (weights.size() != m)
+        throw Exception("Weight vector not the same size as the number of edges.");
+    }
+    else
+    {
+      size_t nb_weights = PyList_Size(py_weights);
+      if (nb_weights != m)
+        throw Exception("Weight vector not the same size as the number of edges.");
+      weights.resize(m);
+      for (size_t e = 0; e < m; e++)
       {
-        throw Exception("Expected floating point value for weight vector.");
+        PyObject* py_item = PyList_GetItem(py_weights, e);
+        if (PyNumber_Check(py_item))
+        {
+          weights[e] = PyFloat_AsDouble(py_item);
+        }
+        else
+        {
+          throw Exception("Expected floating point value for weight vector.");
+        }
       }
+    }
 
+    for (size_t e = 0; e < m; e++)
+    {
       if (check_positive_weight)
         if (weights[e] < 0 )
           throw Exception("Cannot accept negative weights.");
@@ -119,8 +141,18 @@ Graph* create_graph_from_py(PyObject* py_obj_graph, PyObject* py_node_sizes, PyO
 
 vector<size_t> create_size_t_vector(PyObject* py_list)
 {
+    vector<size_t> result;
+    if (read_buffer(py_list, result))
+    {
+      size_t n = result.size();
+      for (size_t i = 0; i < n; i++)
+        if (result[i] >= n)
+          throw Exception("Value cannot exceed length of list.");
+      return result;
+    }
+
     size_t n = PyList_Size(py_list);
-    vector<size_t> result(n);
+    result.resize(n);
     for (size_t i = 0; i < n; i++)
     {
       PyObject* py_item = PyList_GetItem(py_list, i);
@@ -138,6 +170,59 @@ vector<size_t> create_size_t_vector(PyObject* py_list)
     return result;
 }
 
+vector<bool> create_bool_vector(PyObject* py_list)
+{
+    vector<bool> result;
+    if (read_buffer(py_list, result))
+      return result;
+
+    size_t n = PyList_Size(py_list);
+    result.resize(n);
+    for (size_t i = 0; i < n; i++)
+    {
+      PyObject* py_item = PyList_GetItem(py_list, i);
+      result[i] = PyObject_IsTrue(py_item);
+    }
+    return result;
+}
+
+/*****************************************************************************
+  Create a partition of the given method (the name of the partition class
+  without VertexPartition, e.g. "CPM") on graph, which is not deleted with the
+  partition. Without an initial membership the partition is a singleton
+  partition. The resolution parameter is ignored by methods that have none.
+*****************************************************************************/
+MutableVertexPartition* create_partition(Graph* graph, char* method, vector<size_t>* initial_membership, double resolution_parameter)
+{
+  vector<size_t> membership;
+  if (initial_membership != NULL)
+  {
+    if (initial_membership->size() != graph->vcount())
+      throw Exception("Membership vector has incorrect size.");
+    membership = *initial_membership;
+  }
+  else
+  {
+    membership.resize(graph->vcount());
+    for (size_t v = 0; v < membership.size(); v++)
+      membership[v] = v;
+  }
+
+  if (strcmp(method, "Modularity") == 0)
+    return new ModularityVertexPartition(graph, membership);
+  else if (strcmp(method, "Significance") == 0)
+    return new SignificanceVertexPartition(graph, membership);
+  else if (strcmp(method, "Surprise") == 0)
+    return new SurpriseVertexPartition(graph, membership);
+  else if (strcmp(method, "CPM") == 0)
+    return new CPMVertexPartition(graph, membership, resolution_parameter);
+  else if (strcmp(method, "RBER") == 0)
+    return new RBERVertexPartition(graph, membership, resolution_parameter);
+  else if (strcmp(method, "RBConfiguration") == 0)
+    return new RBConfigurationVertexPartition(graph, membership, resolution_parameter);
+  throw Exception("Non-existing method for optimisation specified.");
+}
+
 PyObject* capsule_MutableVertexPartition(MutableVertexPartition* partition)
 {
   PyObject* py_partition = PyCapsule_New(partition, "leidenalg.VertexPartition.MutableVertexPartition", del_MutableVertexPartition);
@@ -646,7 +731,7 @@ extern "C"
   {
     PyObject* py_partition = NULL;
     size_t v;
-    size_t new_comm;
+    Py_ssize_t new_comm;
 
     static const char* kwlist[] = {"partition", "v", "new_comm", NULL};
 
@@ -672,14 +757,14 @@ extern "C"
       cerr << "Using partition at address " << partition << endl;
     #endif
 
-    if (new_comm >= partition->get_graph()->vcount())
+    if (new_comm < 0)
     {
-      PyErr_SetString(PyExc_TypeError, "Community membership cannot exceed number of nodes.");
+      PyErr_SetString(PyExc_TypeError, "Community membership cannot be negative");
       return NULL;
     }
-    else if (new_comm < 0)
+    else if ((size_t)new_comm >= partition->get_graph()->vcount())
     {
-      PyErr_SetString(PyExc_TypeError, "Community membership cannot be negative");
+      PyErr_SetString(PyExc_TypeError, "Community membership cannot exceed number of nodes.");
       return NULL;
     }
 
@@ -1070,6 +1155,42 @@ extern "C"
     return py_membership;
   }
 
+  PyObject* _MutableVertexPartition_get_membership_buffer(PyObject *self, PyObject *args, PyObject *keywds)
+  {
+    PyObject* py_partition = NULL;
+    static const char* kwlist[] = {"partition", NULL};
+
+    #ifdef DEBUG
+      cerr << "Parsing arguments..." << endl;
+    #endif
+
+    if (!PyArg_ParseTupleAndKeywords(args, keywds, "O", (char**) kwlist,
+                                     &py_partition))
+        return NULL;
+
+    #ifdef DEBUG
+      cerr << "get_membership_buffer();" << endl;
+    #endif
+
+    MutableVertexPartition* partition = decapsule_MutableVertexPartition(py_partition);
+
+    #ifdef DEBUG
+      cerr << "Using partition at address " << partition << endl;
+    #endif
+
+    // The number of communities is returned alongside, so that it does not
+    // have to be computed from the buffer in Python.
+    vector<size_t> const& membership = partition->get_membership();
+    size_t n_communities = 0;
+    for (size_t comm : membership)
+      n_communities = std::max(n_communities, comm + 1);
+
+    PyObject* py_membership = create_buffer(membership);
+    if (py_membership == NULL)
+      return NULL;
+    return Py_BuildValue("(Nn)", py_membership, (Py_ssize_t)n_communities);
+  }
+
   PyObject* _MutableVertexPartition_set_membership(PyObject *self, PyObject *args, PyObject *keywds)
   {
     PyObject* py_partition = NULL;
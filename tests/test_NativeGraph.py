@@ -0,0 +1,136 @@
+import unittest
+import igraph as ig
+import leidenalg
+import os
+import tempfile
+from array import array
+
+class NativeGraphTest(unittest.TestCase):
+
+  def setUp(self):
+    self.directory = tempfile.TemporaryDirectory()
+    self.path = os.path.join(self.directory.name, 'graph.bin')
+
+  def tearDown(self):
+    self.directory.cleanup()
+
+  def test_write_read_file(self):
+    G = ig.Graph.Famous('Zachary')
+    leidenalg.NativeGraph.write_file(G, self.path)
+    graph = leidenalg.NativeGraph.from_file(self.path)
+    self.assertEqual(graph.vcount(), G.vcount())
+    self.assertEqual(graph.ecount(), G.ecount())
+    self.assertFalse(graph.is_directed())
+
+  def test_optimise_graph_from_file(self):
+    G = ig.Graph.Famous('Zachary')
+    G.es['weight'] = [1 + (e % 3) for e in range(G.ecount())]
+    leidenalg.NativeGraph.write_file(G, self.path, weights='weight')
+    graph = leidenalg.NativeGraph.from_file(self.path)
+
+    optimiser = leidenalg.Optimiser()
+    optimiser.set_rng_seed(0)
+    membership, quality = optimiser.optimise_graph(
+        graph, leidenalg.RBConfigurationVertexPartition,
+        n_iterations=-1, resolution_parameter=0.5)
+    self.assertEqual(len(membership), G.vcount())
+
+    partition = leidenalg.RBConfigurationVertexPartition(
+        G, initial_membership=list(membership), weights='weight', resolution_parameter=0.5)
+    self.assertAlmostEqual(
+        quality, partition.quality(),
+        msg="Quality of optimising a graph read from a file differs from the same partition of the igraph Graph.")
+
+  def test_write_native_graph(self):
+    G = ig.Graph.Erdos_Renyi(100, p=0.1, directed=True)
+    leidenalg.NativeGraph.write_file(G, self.path)
+    graph = leidenalg.NativeGraph.from_file(self.path)
+
+    other_path = os.path.join(self.directory.name, 'other.bin')
+    leidenalg.NativeGraph.write_file(graph, other_path)
+    with open(self.path, 'rb') as f, open(other_path, 'rb') as g:
+      self.assertEqual(f.read(), g.read())
+
+  def test_from_edges(self):
+    G = ig.Graph.Famous('Zachary')
+    G.es['weight'] = [1 + (e % 3) for e in range(G.ecount())]
+    sources, targets = zip(*G.get_edgelist())
+    graph = leidenalg.NativeGraph.from_edges(
+        G.vcount(), list(sources), list(targets), weights=G.es['weight'])
+    self.assertEqual(graph.vcount(), G.vcount())
+    self.assertEqual(graph.ecount(), G.ecount())
+
+    optimiser = leidenalg.Optimiser()
+    optimiser.set_rng_seed(0)
+    membership, quality = optimiser.optimise_graph(
+        graph, leidenalg.ModularityVertexPartition, n_iterations=-1)
+
+    partition = leidenalg.ModularityVertexPartition(
+        G, initial_membership=list(membership), weights='weight')
+    self.assertAlmostEqual(
+        quality, partition.quality(),
+        msg="Quality of optimising a graph created from edges differs from the same partition of the igraph Graph.")
+
+  def test_from_edges_buffers(self):
+    G = ig.Graph.Erdos_Renyi(100, p=0.1, directed=True)
+    sources, targets = zip(*G.get_edgelist())
+    graph = leidenalg.NativeGraph.from_edges(
+        G.vcount(), array('q', sources), array('i', targets),
+        weights=array('d', [1.0]*G.ecount()), directed=True)
+    self.assertEqual(graph.ecount(), G.ecount())
+    self.assertTrue(graph.is_directed())
+
+  def test_from_edges_invalid(self):
+    with self.assertRaises(ValueError):
+      leidenalg.NativeGraph.from_edges(2, [0, 1], [1, 2])
+    with self.assertRaises(ValueError):
+      leidenalg.NativeGraph.from_edges(3, [0, 1], [1])
+    with self.assertRaises(ValueError):
+      leidenalg.NativeGraph.from_edges(3, [0, 1], [1, 2], weights=[1.0])
+    with self.assertRaises(ValueError):
+      leidenalg.NativeGraph.from_edges(3, [0, -1], [1, 2])
+
+  def test_apply_edge_delta(self):
+    G = ig.Graph.Famous('Zachary')
+    sources, targets = zip(*G.get_edgelist())
+    graph = leidenalg.NativeGraph.from_edges(G.vcount(), sources, targets)
+
+    optimiser = leidenalg.Optimiser()
+    optimiser.set_rng_seed(0)
+    membership, quality = optimiser.optimise_graph(
+        graph, leidenalg.ModularityVertexPartition, n_iterations=-1)
+
+    new_graph = graph.apply_edge_delta(
+        added_sources=[0, 34], added_targets=[33, 0],
+        removed_sources=[1], removed_targets=[0], n=35)
+    self.assertEqual(new_graph.vcount(), 35)
+    self.assertEqual(new_graph.ecount(), G.ecount() + 1)
+    self.assertEqual(graph.ecount(), G.ecount())
+
+    new_membership, new_quality = optimiser.optimise_graph_changed_nodes(
+        new_graph, leidenalg.ModularityVertexPartition, membership, changed_nodes=[0, 1, 33, 34])
+    self.assertEqual(len(new_membership), 35)
+
+    H = G.copy()
+    H.add_vertices(1)
+    H.delete_edges([(0, 1)])
+    H.add_edges([(0, 33), (34, 0)])
+    partition = leidenalg.ModularityVertexPartition(H, initial_membership=list(new_membership))
+    self.assertAlmostEqual(
+        new_quality, partition.quality(),
+        msg="Quality of optimising the changed nodes of a native graph differs from the same partition of the igraph Graph.")
+
+    with self.assertRaises(ValueError):
+      graph.apply_edge_delta(removed_sources=[0], removed_targets=[9])
+
+  def test_invalid_file(self):
+    with open(self.path, 'wb') as f:
+      f.write(b'not a graph file')
+    with self.assertRaises(ValueError):
+      leidenalg.NativeGraph.from_file(self.path)
+
+if __name__ == '__main__':
+  #%%
+  unittest.main(verbosity=3)
+  suite = unittest.TestLoader().discover('.')
+  unittest.TextTestRunner(verbosity=1).run(suite)
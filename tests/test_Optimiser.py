@@ -1,8 +1,28 @@
 import unittest
 import igraph as ig
 import leidenalg
+import os
+import threading
+import time
 
+from array import array
 from functools import reduce
+from concurrent.futures import ThreadPoolExecutor
+
+def optimise_seeded(G, seed):
+  partition = leidenalg.ModularityVertexPartition(G)
+  optimiser = leidenalg.Optimiser()
+  optimiser.set_rng_seed(seed)
+  optimiser.optimise_partition(partition, n_iterations=-1)
+  return partition.membership
+
+def optimise_parallel_seeded(G, seed, n_threads):
+  partition = leidenalg.ModularityVertexPartition(G)
+  optimiser = leidenalg.Optimiser()
+  optimiser.set_rng_seed(seed)
+  optimiser.n_threads = n_threads
+  optimiser.optimise_partition(partition, n_iterations=-1)
+  return partition.membership
 
 class OptimiserTest(unittest.TestCase):
 
@@ -17,6 +37,54 @@ class OptimiserTest(unittest.TestCase):
         partition.sizes(), [100],
         msg="CPMVertexPartition(resolution_parameter=0.5) of complete graph after move nodes incorrect.")
 
+  def test_move_nodes_parallel(self):
+    G = ig.Graph.Full(100)
+    partition = leidenalg.CPMVertexPartition(G, resolution_parameter=0.5)
+    self.optimiser.n_threads = 4
+    self.optimiser.move_nodes(partition, consider_comms=leidenalg.ALL_NEIGH_COMMS)
+    self.assertListEqual(
+        partition.sizes(), [100],
+        msg="CPMVertexPartition(resolution_parameter=0.5) of complete graph after parallel move nodes incorrect.")
+
+  def test_move_nodes_queue(self):
+    G = ig.Graph.Full(100)
+    partition = leidenalg.CPMVertexPartition(G, resolution_parameter=0.5)
+    self.optimiser.use_queue = True
+    self.optimiser.move_nodes(partition, consider_comms=leidenalg.ALL_NEIGH_COMMS)
+    self.assertListEqual(
+        partition.sizes(), [100],
+        msg="CPMVertexPartition(resolution_parameter=0.5) of complete graph after queue-based move nodes incorrect.")
+    self.assertGreater(self.optimiser.n_moves, 0)
+    self.assertGreaterEqual(self.optimiser.n_visits, self.optimiser.n_moves)
+
+  def test_move_nodes_queue_no_allocations(self):
+    # Only the scratch buffers of the optimiser can be observed from Python,
+    # tests/test_allocations.cpp counts the actual allocations per node visit
+    G = ig.Graph.Erdos_Renyi(1000, p=10./1000)
+    self.optimiser.use_queue = True
+    self.optimiser.move_nodes(leidenalg.ModularityVertexPartition(G))
+    n_visits = self.optimiser.n_visits
+    n_scratch_allocations = self.optimiser.n_scratch_allocations
+    self.optimiser.move_nodes(leidenalg.ModularityVertexPartition(G))
+    self.assertGreater(self.optimiser.n_visits, n_visits)
+    self.assertEqual(
+        self.optimiser.n_scratch_allocations, n_scratch_allocations,
+        msg="Moving nodes a second time on the same graph allocated scratch buffers.")
+
+  def test_optimise_partition_reuses_arena(self):
+    G = ig.Graph.Erdos_Renyi(1000, p=10./1000)
+    self.optimiser.use_queue = True
+    self.optimiser.set_rng_seed(0)
+    self.optimiser.optimise_partition(leidenalg.ModularityVertexPartition(G))
+    arena_bytes_allocated = self.optimiser.arena_bytes_allocated
+    self.assertGreater(self.optimiser.arena_peak_bytes, 0)
+    self.assertLessEqual(self.optimiser.arena_peak_bytes, arena_bytes_allocated)
+    self.optimiser.set_rng_seed(0)
+    self.optimiser.optimise_partition(leidenalg.ModularityVertexPartition(G))
+    self.assertEqual(
+        self.optimiser.arena_bytes_allocated, arena_bytes_allocated,
+        msg="Optimising a second time on the same graph allocated aggregation buffers.")
+
   def test_move_nodes_with_max_comm_size(self):
     G = ig.Graph.Full(100)
     partition = leidenalg.CPMVertexPartition(G, resolution_parameter=0.5)
@@ -71,6 +139,24 @@ class OptimiserTest(unittest.TestCase):
           partition.diff_move(v.index, c), 1e-10, # Allow for a small difference up to rounding error.
           msg="Was able to move a node to a better community, violating node optimality.")
 
+  def test_diff_move_node_optimality_queue(self):
+    G = ig.Graph.Erdos_Renyi(100, p=5./100, directed=False, loops=False)
+    G.es['weight'] = [1 + (e.index % 3) for e in G.es]
+    self.optimiser.use_queue = True
+    partitions = [
+      leidenalg.CPMVertexPartition(G, weights='weight', resolution_parameter=0.1),
+      leidenalg.RBERVertexPartition(G, weights='weight', resolution_parameter=0.5),
+      leidenalg.RBConfigurationVertexPartition(G, weights='weight', resolution_parameter=0.5),
+      leidenalg.ModularityVertexPartition(G, weights='weight')]
+    for partition in partitions:
+      while 0 < self.optimiser.move_nodes(partition, consider_comms=leidenalg.ALL_COMMS):
+        pass
+      for v in G.vs:
+        for c in range(len(partition)):
+          self.assertLessEqual(
+            partition.diff_move(v.index, c), 1e-10, # Allow for a small difference up to rounding error.
+            msg="Was able to move a node to a better community after queue-based move nodes for {0}, violating node optimality.".format(type(partition).__name__))
+
   def test_optimiser(self):
     G = reduce(ig.Graph.disjoint_union, (ig.Graph.Tree(10, 3, mode=ig.TREE_UNDIRECTED) for i in range(10)))
     partition = leidenalg.CPMVertexPartition(G, resolution_parameter=0)
@@ -121,6 +207,19 @@ class OptimiserTest(unittest.TestCase):
             msg="After optimising partition with fixed nodes failed to recover initial fixed memberships"
             )
 
+  def test_optimiser_with_is_membership_fixed_buffer(self):
+      G = ig.Graph.Full(3)
+      partition = leidenalg.CPMVertexPartition(
+              G,
+              resolution_parameter=0.01,
+              initial_membership=[2, 1, 0])
+      is_membership_fixed = array('b', [True, False, False])
+      self.optimiser.optimise_partition(partition, is_membership_fixed=is_membership_fixed)
+      self.assertListEqual(
+            partition.membership, [2, 2, 2],
+            msg="After optimising partition with fixed nodes passed as a buffer failed to recover initial fixed memberships"
+            )
+
   def test_optimiser_is_membership_fixed_large_labels(self):
     G = ig.Graph.Erdos_Renyi(n=100, p=5./100, directed=True, loops=True)
 
@@ -163,6 +262,323 @@ class OptimiserTest(unittest.TestCase):
       profile[-1].sizes(), [1]*G.vcount(),
       msg="Resolution profile incorrect: at resolution 1, not equal to a singleton partition for CPM.")
 
+  def test_resolution_profile_bisect_func(self):
+    G = ig.Graph.Famous('Zachary')
+    n_calls = [0]
+    def bisect_func(partition):
+      n_calls[0] += 1
+      return len(partition)
+    profile = self.optimiser.resolution_profile(G, leidenalg.CPMVertexPartition, resolution_range=(0,1),
+                                                bisect_func=bisect_func, min_diff_bisect_value=1)
+    self.assertGreater(n_calls[0], 0, msg="The bisect function was not called.")
+    self.assertListEqual(profile[0].sizes(), [G.vcount()])
+    self.assertListEqual(profile[-1].sizes(), [1]*G.vcount())
+    bisect_values = [p.bisect_value() for p in profile]
+    self.assertListEqual(bisect_values, sorted(bisect_values, reverse=True))
+    for p in profile:
+      self.assertIsInstance(p.is_stable, bool)
+
+  def test_is_locally_optimal(self):
+    G = ig.Graph.Famous('Zachary')
+    partition = leidenalg.CPMVertexPartition(G, resolution_parameter=0.1)
+    self.assertFalse(self.optimiser.is_locally_optimal(partition))
+    self.assertFalse(self.optimiser.is_locally_optimal(partition, is_membership_fixed=[False]*(G.vcount() - 1) + [True]))
+    self.assertTrue(self.optimiser.is_locally_optimal(partition, is_membership_fixed=[True]*G.vcount()))
+    membership = partition.membership
+    self.optimiser.is_locally_optimal(partition)
+    self.assertListEqual(
+        partition.membership, membership,
+        msg="Checking local optimality changed the partition.")
+
+    for partition_type in [leidenalg.ModularityVertexPartition, leidenalg.CPMVertexPartition,
+                           leidenalg.SignificanceVertexPartition]:
+      partition = partition_type(G)
+      self.optimiser.move_nodes(partition)
+      while self.optimiser.move_nodes(partition) > 0:
+        pass
+      self.assertTrue(
+          self.optimiser.is_locally_optimal(partition),
+          msg="Partition of type {0} is not locally optimal after moving nodes.".format(partition_type.__name__))
+
+  def test_resolution_profile_threaded(self):
+    G = ig.Graph.Famous('Zachary')
+    profiles = []
+    for n_threads in [1, 3]:
+      optimiser = leidenalg.Optimiser()
+      optimiser.set_rng_seed(42)
+      profile = optimiser.resolution_profile(G, leidenalg.CPMVertexPartition, resolution_range=(0,1), n_threads=n_threads)
+      resolutions = [p.resolution_parameter for p in profile]
+      self.assertListEqual(resolutions, sorted(resolutions))
+      bisect_values = [p.bisect_value() for p in profile]
+      self.assertListEqual(
+          bisect_values, sorted(bisect_values, reverse=True),
+          msg="Resolution profile incorrect: the weight within communities increases with the resolution.")
+      profiles.append([p.membership for p in profile])
+    self.assertListEqual(
+        profiles[0], profiles[1],
+        msg="The resolution profile depends on the number of threads.")
+
+  def test_optimise_partition_threaded(self):
+    graphs = [ig.Graph.Erdos_Renyi(1000, p=10./1000) for i in range(8)]
+    serial = [optimise_seeded(G, seed) for seed, G in enumerate(graphs)]
+    with ThreadPoolExecutor(max_workers=4) as executor:
+      threaded = list(executor.map(optimise_seeded, graphs, range(len(graphs))))
+    self.assertListEqual(
+      serial, threaded,
+      msg="Optimising independent partitions in threads gives different results than optimising them serially.")
+
+  def test_optimiser_queue(self):
+    G = ig.Graph.Famous('Zachary')
+    partition = leidenalg.ModularityVertexPartition(G)
+    self.optimiser.use_queue = True
+    self.optimiser.set_rng_seed(0)
+    self.optimiser.optimise_partition(partition, n_iterations=-1)
+    self.assertGreater(
+      partition.quality(), 0.4,
+      msg="Modularity of the Zachary karate club after optimising using a queue is too low.")
+
+  def test_optimise_partition_parallel_deterministic(self):
+    G = ig.Graph.Erdos_Renyi(1000, p=10./1000)
+    membership = optimise_parallel_seeded(G, 42, 2)
+    for n_threads in [2, 3, 4]:
+      self.assertListEqual(
+        membership, optimise_parallel_seeded(G, 42, n_threads),
+        msg="Optimising a partition using {0} threads is not deterministic for a given seed.".format(n_threads))
+
+  def test_refine_partition_parallel_deterministic(self):
+    G = ig.Graph.Erdos_Renyi(1000, p=10./1000)
+    # Only the refinement uses threads, the communities to refine are fixed
+    constrained_partition = leidenalg.CPMVertexPartition(G, resolution_parameter=0.01)
+    self.optimiser.set_rng_seed(42)
+    self.optimiser.optimise_partition(constrained_partition)
+    for merge_only in [False, True]:
+      memberships = []
+      for n_threads in [1, 2, 3, 4]:
+        partition = leidenalg.CPMVertexPartition(G, resolution_parameter=0.01)
+        optimiser = leidenalg.Optimiser()
+        optimiser.set_rng_seed(42)
+        optimiser.n_threads = n_threads
+        optimiser.use_queue = True
+        if merge_only:
+          optimiser.merge_nodes_constrained(partition, constrained_partition)
+        else:
+          optimiser.move_nodes_constrained(partition, constrained_partition)
+        memberships.append(partition.membership_buffer().tolist())
+      self.assertLess(len(set(memberships[0])), G.vcount())
+      for membership in memberships[1:]:
+        self.assertListEqual(
+            memberships[0], membership,
+            msg="Refining a partition using multiple threads is not deterministic for a given seed.")
+
+  def test_optimise_partition_compact_indices(self):
+    G = ig.Graph.Erdos_Renyi(1000, p=10./1000)
+    G.es['weight'] = [1 + (e % 3)/4. for e in range(G.ecount())]
+    memberships = []
+    for compact_indices in [False, True]:
+      partition = leidenalg.RBConfigurationVertexPartition(G, weights='weight')
+      optimiser = leidenalg.Optimiser()
+      optimiser.set_rng_seed(42)
+      optimiser.use_queue = True
+      optimiser.compact_indices = compact_indices
+      optimiser.optimise_partition(partition)
+      memberships.append(partition.membership)
+    self.assertListEqual(
+        memberships[0], memberships[1],
+        msg="Optimising a partition using compact indices gives a different result.")
+
+  def test_optimise_changed_nodes(self):
+    G = ig.Graph.SBM(400, [[0.1, 0.005], [0.005, 0.1]], [200, 200])
+    optimiser = leidenalg.Optimiser()
+    optimiser.set_rng_seed(42)
+    partition = leidenalg.ModularityVertexPartition(G)
+    optimiser.optimise_partition(partition, n_iterations=-1)
+
+    # Connect two nodes of different communities, and disconnect another node
+    u = partition.membership.index(0)
+    v = partition.membership.index(1)
+    x = partition.membership.index(0, u + 1)
+    removed = G.incident(x)
+    changed_nodes = [u, v] + [w for e in removed for w in G.es[e].tuple]
+    G.delete_edges(removed)
+    G.add_edges([(u, v)])
+
+    partition = leidenalg.ModularityVertexPartition(G, initial_membership=partition.membership)
+    quality = partition.quality()
+    diff = optimiser.optimise_changed_nodes(partition, changed_nodes)
+    self.assertGreaterEqual(diff, 0)
+    self.assertAlmostEqual(
+        partition.quality(), quality + diff,
+        msg="Difference in quality of optimising the changed nodes is not correct.")
+    self.assertNotIn(
+        partition.membership[x], [partition.membership[w] for w in range(G.vcount()) if w != x],
+        msg="Disconnected node was not split from its community.")
+
+  def test_optimise_partition_timeout(self):
+    G = ig.Graph.Erdos_Renyi(1000, p=10./1000)
+    partition = leidenalg.ModularityVertexPartition(G)
+    optimiser = leidenalg.Optimiser()
+    optimiser.use_queue = True
+    optimiser.check_interval = 1
+    diff = optimiser.optimise_partition(partition, n_iterations=-1, timeout=0)
+    self.assertFalse(
+        optimiser.converged,
+        msg="Optimisation that ran out of time is reported as converged.")
+    self.assertAlmostEqual(
+        diff, 0,
+        msg="Optimisation without any time left changed the partition.")
+    self.assertEqual(len(partition.membership), G.vcount())
+
+    diff = optimiser.optimise_partition(partition, n_iterations=-1, timeout=60)
+    self.assertTrue(
+        optimiser.converged,
+        msg="Optimisation within the time limit is not reported as converged.")
+    self.assertGreater(diff, 0)
+
+  def test_expired_deadline_does_not_carry_over(self):
+    G = ig.Graph.Erdos_Renyi(1000, p=10./1000)
+    optimiser = leidenalg.Optimiser()
+    optimiser.use_queue = True
+    optimiser.check_interval = 1
+    optimiser.optimise_partition(leidenalg.ModularityVertexPartition(G), timeout=0)
+    optimiser.cancel()
+
+    partition = leidenalg.ModularityVertexPartition(G)
+    self.assertGreater(
+        optimiser.move_nodes(partition), 0,
+        msg="Moving nodes after an expired or cancelled call did not move any node.")
+    self.assertGreater(
+        optimiser.optimise_partition_multiplex([leidenalg.ModularityVertexPartition(G)]), 0,
+        msg="Optimising a multiplex partition after an expired or cancelled call did not improve it.")
+
+  def test_optimise_partition_profile(self):
+    G = ig.Graph.Erdos_Renyi(1000, p=10./1000)
+    partition = leidenalg.ModularityVertexPartition(G)
+    optimiser = leidenalg.Optimiser()
+    optimiser.use_queue = True
+    optimiser.optimise_partition(partition, n_iterations=1)
+    self.assertListEqual(
+        optimiser.profile['levels'], [],
+        msg="Levels are profiled while profiling is disabled.")
+
+    optimiser.profiling = True
+    optimiser.optimise_partition(partition, n_iterations=1)
+    levels = optimiser.profile['levels']
+    self.assertGreater(len(levels), 0)
+    self.assertEqual(levels[0]['level'], 0)
+    self.assertEqual(levels[0]['n_nodes'], G.vcount())
+    self.assertEqual(levels[0]['n_edges'], G.ecount())
+    for level, next_level in zip(levels[:-1], levels[1:]):
+      self.assertEqual(
+          level['n_aggregate_nodes'], next_level['n_nodes'],
+          msg="Size of the aggregate graph differs from the size of the next level.")
+    self.assertGreaterEqual(optimiser.profile['n_diff_moves'], optimiser.profile['n_moves'])
+
+    optimiser.clear_profile()
+    self.assertListEqual(optimiser.profile['levels'], [])
+
+  def test_optimise_ensemble(self):
+    G = ig.Graph.Erdos_Renyi(500, p=10./500)
+    memberships = []
+    for n_threads in [1, 3]:
+      partition = leidenalg.ModularityVertexPartition(G)
+      optimiser = leidenalg.Optimiser()
+      optimiser.set_rng_seed(42)
+      runs = optimiser.optimise_ensemble(partition, n_starts=6, n_threads=n_threads, n_iterations=-1)
+      self.assertEqual(len(runs), 6)
+      self.assertAlmostEqual(
+          partition.quality(), max(run['quality'] for run in runs),
+          msg="The partition is not the best partition of the ensemble.")
+      self.assertTrue(optimiser.converged)
+      memberships.append(partition.membership)
+    self.assertListEqual(
+        memberships[0], memberships[1],
+        msg="The best partition of an ensemble depends on the number of threads.")
+
+  def test_optimise_consensus(self):
+    G = ig.Graph.Famous('Zachary')
+    optimiser = leidenalg.Optimiser()
+    memberships = []
+    for seed in range(5):
+      optimiser.set_rng_seed(seed)
+      partition = leidenalg.ModularityVertexPartition(G)
+      optimiser.optimise_partition(partition, n_iterations=-1)
+      memberships.append(partition.membership)
+
+    partition = leidenalg.ModularityVertexPartition(G)
+    result = optimiser.optimise_consensus(partition, [memberships[0]]*3, n_threads=2)
+    self.assertEqual(result['n_rounds'], 0)
+    self.assertTrue(result['stable'])
+    self.assertListEqual(
+        partition.membership, memberships[0],
+        msg="The consensus of identical memberships differs from the memberships.")
+
+    partition = leidenalg.ModularityVertexPartition(G)
+    result = optimiser.optimise_consensus(partition, memberships, n_threads=2)
+    self.assertEqual(len(result['agreement']), G.ecount())
+    self.assertTrue(all(0.0 <= a <= 1.0 for a in result['agreement']))
+    self.assertAlmostEqual(result['quality'], partition.quality())
+    self.assertEqual(result['stable'], all(a in (0.0, 1.0) for a in result['agreement']))
+
+  def test_optimise_partition_releases_gil(self):
+    n_threads = 4
+    graphs = [ig.Graph.Erdos_Renyi(20000, p=10./20000) for i in range(n_threads)]
+    partitions = [leidenalg.ModularityVertexPartition(G) for G in graphs]
+    barrier = threading.Barrier(n_threads)
+
+    def optimise_timed(partition, seed):
+      optimiser = leidenalg.Optimiser()
+      optimiser.set_rng_seed(seed)
+      barrier.wait()
+      start = time.perf_counter()
+      optimiser.optimise_partition(partition, n_iterations=-1)
+      return start, time.perf_counter()
+
+    with ThreadPoolExecutor(max_workers=n_threads) as executor:
+      intervals = list(executor.map(optimise_timed, partitions, range(n_threads)))
+
+    # If the GIL were held while optimising, a thread could only start once
+    # the optimisation in another thread had finished.
+    self.assertLess(
+      max(start for start, end in intervals), min(end for start, end in intervals),
+      msg="Optimising partitions in {0} threads did not run concurrently.".format(n_threads))
+
+  def test_optimise_partition_threaded_stress(self):
+    # Reduced version of test_optimise_partition_threaded_speedup, which runs
+    # more, smaller optimisations concurrently and checks their results
+    # instead of the time they take.
+    n_threads = 4
+    graphs = [ig.Graph.Erdos_Renyi(2000, p=10./2000) for i in range(4*n_threads)]
+    serial = [optimise_seeded(G, seed) for seed, G in enumerate(graphs)]
+
+    with ThreadPoolExecutor(max_workers=n_threads) as executor:
+      threaded = list(executor.map(optimise_seeded, graphs, range(len(graphs))))
+
+    self.assertListEqual(
+      threaded, serial,
+      msg="Optimising partitions in {0} threads gives different results than serially.".format(n_threads))
+
+  @unittest.skipUnless(os.environ.get('LEIDENALG_BENCHMARK'), "set LEIDENALG_BENCHMARK to run timing tests")
+  @unittest.skipUnless((os.cpu_count() or 1) >= 4, "requires at least 4 cores")
+  def test_optimise_partition_threaded_speedup(self):
+    n_threads = 4
+    graphs = [ig.Graph.Erdos_Renyi(20000, p=10./20000) for i in range(n_threads)]
+
+    start = time.perf_counter()
+    for seed, G in enumerate(graphs):
+      optimise_seeded(G, seed)
+    serial_time = time.perf_counter() - start
+
+    start = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=n_threads) as executor:
+      list(executor.map(optimise_seeded, graphs, range(n_threads)))
+    threaded_time = time.perf_counter() - start
+
+    # Only the construction of the partitions holds the GIL, so we should get
+    # close to linear speedup. Leave ample slack for noisy machines.
+    self.assertGreater(
+      serial_time/threaded_time, 0.5*n_threads,
+      msg="Optimising independent partitions in {0} threads is only {1:.2f} times faster than serially.".format(n_threads, serial_time/threaded_time))
+
 #%%
 if __name__ == '__main__':
   #%%
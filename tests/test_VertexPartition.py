@@ -2,6 +2,7 @@ import unittest
 import igraph as ig
 import leidenalg
 import random
+from array import array
 from copy import deepcopy
 
 from ddt import ddt, data, unpack
@@ -147,6 +148,38 @@ class BaseTest:
           s, partition.total_weight_in_all_comms())
         )
 
+    @data(*graphs)
+    def test_buffer_weights(self, graph):
+      if 'weight' not in graph.es.attributes() or self.partition_type == leidenalg.SignificanceVertexPartition:
+        raise unittest.SkipTest('Only weighted graphs')
+
+      partition = self.partition_type(graph, weights=graph.es['weight'])
+      buffer_partition = self.partition_type(graph, weights=array('d', graph.es['weight']))
+      self.assertAlmostEqual(
+        partition.quality(),
+        buffer_partition.quality(),
+        places=5,
+        msg='Quality when passing weights as a buffer ({0}) not equal to quality when passing a list ({1}).'.format(
+          buffer_partition.quality(), partition.quality())
+        )
+
+    @data(*graphs)
+    def test_membership_buffer(self, graph):
+      partition = self.partition_type(graph)
+      self.optimiser.optimise_partition(partition)
+      membership = partition.membership_buffer()
+      self.assertListEqual(
+        membership.tolist(),
+        partition.membership,
+        msg='Membership buffer not equal to membership.')
+
+      partition2 = self.partition_type(graph)
+      partition2.set_membership(array('q', partition.membership))
+      self.assertListEqual(
+        partition2.membership,
+        partition.membership,
+        msg='Membership set from a buffer not equal to original membership.')
+
     @data(*graphs)
     def test_copy(self, graph):
       if 'weight' in graph.es.attributes() and self.partition_type != leidenalg.SignificanceVertexPartition:
@@ -0,0 +1,234 @@
+/*****************************************************************************
+  Check that visiting a node when moving nodes does not allocate memory, and
+  that the batched diff_moves agree with diff_move.
+
+  The Python tests can only observe the scratch buffers of the optimiser
+  (n_scratch_allocations). This program replaces malloc, calloc and realloc,
+  which also underlie operator new and the vectors of igraph, and counts
+  every call while counting is enabled. For every linear quality function, it
+  visits all nodes as the queue-based move_nodes does: it accumulates the
+  weights to the neighbouring communities and scores them using a single
+  call of diff_moves, once using the virtual BatchDiffMove and once using
+  StaticLinearBatchDiffMove. Only the first pass may allocate.
+
+  Every check runs on an undirected and a directed graph, with and without
+  edge weights, which contain self-loops. The undirected weighted graph also
+  corrects for self-loops.
+
+  Replacing malloc in this way requires glibc. The program is built using
+
+    python setup.py build_tests
+
+  against the same dependencies as the extension, and run by
+  tests/test_allocations.py. It exits with a non-zero status if a check
+  fails.
+*****************************************************************************/
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <igraph/igraph.h>
+#include <libleidenalg/GraphHelper.h>
+#include <libleidenalg/CPMVertexPartition.h>
+#include <libleidenalg/ModularityVertexPartition.h>
+#include <libleidenalg/RBConfigurationVertexPartition.h>
+#include <libleidenalg/RBERVertexPartition.h>
+
+#include "BatchDiffMove.h"
+#include "CSRGraph.h"
+#include "NativeGraph.h"
+#include "SparseAccumulator.h"
+
+#include "../benchmarks/graph_generators.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+extern "C"
+{
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t n, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+  void __libc_free(void* ptr);
+}
+
+static std::atomic<bool> is_counting(false);
+static std::atomic<size_t> n_allocations(0);
+
+extern "C"
+{
+  void* malloc(size_t size)
+  {
+    if (is_counting.load(std::memory_order_relaxed))
+      n_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+  }
+
+  void* calloc(size_t n, size_t size)
+  {
+    if (is_counting.load(std::memory_order_relaxed))
+      n_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+  }
+
+  void* realloc(void* ptr, size_t size)
+  {
+    if (is_counting.load(std::memory_order_relaxed))
+      n_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+  }
+
+  void free(void* ptr)
+  {
+    __libc_free(ptr);
+  }
+}
+
+static int n_failures = 0;
+
+/*****************************************************************************
+  Visit all nodes, scoring all neighbouring communities except the own one
+  and an empty community, and return the number of allocations. If check is
+  set, the scores are compared to diff_move.
+*****************************************************************************/
+template <class DiffMoves>
+static size_t visit_nodes(MutableVertexPartition* partition, DiffMoves* batch_diff_move,
+                          CSRGraph const& out_graph, CSRGraph const& in_graph,
+                          NeighbourCommunities& neighbours,
+                          vector<size_t>& comms, vector<double>& diffs, bool check)
+{
+  size_t n = partition->get_graph()->vcount();
+  size_t empty_comm = partition->get_empty_community();
+  double max_error = 0.0;
+
+  n_allocations = 0;
+  is_counting = true;
+  for (size_t v = 0; v < n; v++)
+  {
+    neighbours.compute(v, partition->get_membership(), out_graph, in_graph);
+    comms.clear();
+    for (size_t comm : neighbours.comms())
+      if (comm != partition->membership(v))
+        comms.push_back(comm);
+    comms.push_back(empty_comm);
+    batch_diff_move->diff_moves(v, neighbours, comms.data(), comms.size(), diffs.data());
+
+    if (check)
+    {
+      is_counting = false;
+      for (size_t idx = 0; idx < comms.size(); idx++)
+      {
+        double diff = partition->diff_move(v, comms[idx]);
+        max_error = std::max(max_error, std::abs(diffs[idx] - diff)/std::max(1.0, std::abs(diff)));
+      }
+      is_counting = true;
+    }
+  }
+  is_counting = false;
+
+  if (max_error > 1e-10)
+  {
+    cerr << "diff_moves differs from diff_move by " << max_error << endl;
+    n_failures += 1;
+  }
+  return n_allocations;
+}
+
+template <class Partition, int NULL_MODEL>
+static void check(string const& name, Partition* partition,
+                  CSRGraph const& all_graph, CSRGraph const& out_graph, CSRGraph const& in_graph)
+{
+  Graph* graph = partition->get_graph();
+  size_t n = graph->vcount();
+  size_t max_comms = all_graph.max_degree() + 1;
+
+  NeighbourCommunities neighbours(n + 1, all_graph.max_degree(), graph->is_directed());
+  vector<size_t> comms;
+  comms.reserve(max_comms);
+  vector<double> diffs(max_comms);
+
+  BatchDiffMove* batch_diff_move = BatchDiffMove::create(partition);
+  batch_diff_move->reserve(max_comms);
+  visit_nodes(partition, batch_diff_move, out_graph, in_graph, neighbours, comms, diffs, true);
+  size_t n_virtual = visit_nodes(partition, batch_diff_move, out_graph, in_graph, neighbours, comms, diffs, false);
+  delete batch_diff_move;
+
+  StaticLinearBatchDiffMove<Partition, NULL_MODEL> static_diff_move(partition);
+  static_diff_move.reserve(max_comms);
+  visit_nodes(partition, &static_diff_move, out_graph, in_graph, neighbours, comms, diffs, true);
+  size_t n_static = visit_nodes(partition, &static_diff_move, out_graph, in_graph, neighbours, comms, diffs, false);
+
+  cout << name << ": " << n_virtual << " allocations (virtual), "
+       << n_static << " allocations (static) for " << n << " node visits" << endl;
+  if (n_virtual > 0 || n_static > 0)
+    n_failures += 1;
+}
+
+/*****************************************************************************
+  Check all linear quality functions on an LFR-style graph with a self-loop
+  on every tenth node, and random integer weights if is_weighted is set.
+*****************************************************************************/
+static void check_graph(bool is_directed, bool is_weighted, bool correct_self_loops)
+{
+  EdgeList edges = lfr_edges(10000, 5, 50, 20, 200, 0.3, 42);
+  for (size_t v = 0; v < edges.n; v += 10)
+  {
+    edges.from.push_back(v);
+    edges.to.push_back(v);
+  }
+
+  BenchmarkRng rng(42);
+  vector<double> weights;
+  if (is_weighted)
+  {
+    weights.resize(edges.from.size());
+    for (double& w : weights)
+      w = 1 + rng.index(10);
+  }
+  vector<double> none;
+  Graph* graph = create_graph_from_edges(edges.n, edges.from, edges.to, weights, none,
+                                         is_directed, correct_self_loops);
+  CSRGraph all_graph(graph, IGRAPH_ALL);
+  CSRGraph out_graph(graph, is_directed ? IGRAPH_OUT : IGRAPH_ALL);
+  CSRGraph in_graph(graph, is_directed ? IGRAPH_IN : IGRAPH_ALL);
+
+  // Communities from a moderate number of random labels, so that nodes have
+  // neighbours in several communities, including their own
+  vector<size_t> membership(edges.n);
+  for (size_t& comm : membership)
+    comm = rng.index(500);
+
+  string kind = string(" (") + (is_directed ? "directed" : "undirected") +
+                (is_weighted ? ", weighted" : "") +
+                (correct_self_loops ? ", corrected self-loops" : "") + ")";
+
+  ModularityVertexPartition modularity(graph, membership);
+  check<ModularityVertexPartition, LinearBatchDiffMove::CONFIGURATION>("Modularity" + kind, &modularity, all_graph, out_graph, in_graph);
+  RBConfigurationVertexPartition rb_configuration(graph, membership, 0.5);
+  check<RBConfigurationVertexPartition, LinearBatchDiffMove::CONFIGURATION>("RBConfiguration" + kind, &rb_configuration, all_graph, out_graph, in_graph);
+  RBERVertexPartition rber(graph, membership, 2.0);
+  check<RBERVertexPartition, LinearBatchDiffMove::CONSTANT_POTTS>("RBER" + kind, &rber, all_graph, out_graph, in_graph);
+  CPMVertexPartition cpm(graph, membership, 0.01);
+  check<CPMVertexPartition, LinearBatchDiffMove::CONSTANT_POTTS>("CPM" + kind, &cpm, all_graph, out_graph, in_graph);
+
+  delete_native_graph(graph);
+}
+
+int main()
+{
+  check_graph(false, false, false);
+  check_graph(false, true, true);
+  check_graph(true, false, false);
+  check_graph(true, true, false);
+
+  if (n_failures > 0)
+  {
+    cerr << n_failures << " checks failed" << endl;
+    return 1;
+  }
+  return 0;
+}
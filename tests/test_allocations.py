@@ -0,0 +1,39 @@
+import unittest
+import os
+import platform
+import subprocess
+import sys
+
+# The C++ test programs are built from a source checkout in which the
+# dependencies have been built (see scripts/build_libleidenalg.sh)
+project_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+build_dir = os.path.join(project_dir, 'build', 'tests')
+
+def has_dependencies():
+  return (os.path.exists(os.path.join(project_dir, 'setup.py')) and
+          os.path.isdir(os.path.join(project_dir, 'build-deps', 'install', 'include')))
+
+@unittest.skipUnless(sys.platform.startswith('linux') and platform.libc_ver()[0] == 'glibc',
+                     'Counting allocations requires glibc')
+@unittest.skipUnless(has_dependencies(), 'Requires a source checkout with the dependencies built')
+class AllocationsTest(unittest.TestCase):
+
+  @classmethod
+  def setUpClass(cls):
+    build = subprocess.run([sys.executable, 'setup.py', 'build_tests', '--build-dir', build_dir],
+                           cwd=project_dir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                           universal_newlines=True)
+    if build.returncode != 0:
+      raise RuntimeError('Building the C++ tests failed:\n' + build.stdout)
+
+  def test_visiting_nodes_does_not_allocate(self):
+    result = subprocess.run([os.path.join(build_dir, 'test_allocations')],
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                            universal_newlines=True)
+    self.assertEqual(result.returncode, 0, msg=result.stdout)
+
+if __name__ == '__main__':
+  #%%
+  unittest.main(verbosity=3)
+  suite = unittest.TestLoader().discover('.')
+  unittest.TextTestRunner(verbosity=1).run(suite)
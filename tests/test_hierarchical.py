@@ -46,6 +46,15 @@ class HierarchicalTest(unittest.TestCase):
                 self.assertLessEqual(len(partition), len(prev_partition),
                                      "Number of communities should be non-increasing.")
 
+    def test_hierarchy_membership(self):
+        _, hierarchy = la.find_partition_hierarchical(self.G, la.ModularityVertexPartition)
+        for level in range(len(hierarchy)):
+            self.assertListEqual(hierarchy.membership(level).tolist(), hierarchy[level].membership,
+                                 "Membership of level not equal to membership of partition at level.")
+        self.assertListEqual(hierarchy.membership(-1).tolist(), hierarchy[len(hierarchy) - 1].membership)
+        self.assertLessEqual(hierarchy.memory_usage, 8*len(hierarchy)*self.G.vcount(),
+                             "Hierarchy should not use more memory than storing each level.")
+
     def test_find_partition_hierarchical_undirected(self):
         self._test_hierarchy_properties(self.G, la.ModularityVertexPartition)
 